@@ -0,0 +1,76 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "AI/EnvQueryGenerator_CoverPoints.h"
+#include "EnvironmentQuery/Items/EnvQueryItemType_Point.h"
+#include "EnvironmentQuery/Contexts/EnvQueryContext_Querier.h"
+#include "CoverSystem/CoverSystem.h"
+
+#define LOCTEXT_NAMESPACE "EnvQueryGenerator"
+
+UEnvQueryGenerator_CoverPoints::UEnvQueryGenerator_CoverPoints()
+{
+	ItemType = UEnvQueryItemType_Point::StaticClass();
+	Center = UEnvQueryContext_Querier::StaticClass();
+	MinDistance.DefaultValue = 100.0f;
+	MaxDistance.DefaultValue = 1000.0f;
+}
+
+void UEnvQueryGenerator_CoverPoints::GenerateItems(FEnvQueryInstance& QueryInstance) const
+{
+	UObject* queryOwner = QueryInstance.Owner.Get();
+	if (!queryOwner || UCoverSystem::bShutdown)
+		return;
+
+	MinDistance.BindData(queryOwner, QueryInstance.QueryID);
+	MaxDistance.BindData(queryOwner, QueryInstance.QueryID);
+	const float minDistanceSquared = FMath::Square(MinDistance.GetValue());
+	const float maxDistance = MaxDistance.GetValue();
+
+	TArray<FVector> centerLocations;
+	if (!QueryInstance.PrepareContext(Center, centerLocations))
+		return;
+
+	UCoverSystem* coverSystem = UCoverSystem::GetInstance(QueryInstance.World);
+	TSet<FVector> addedCoverLocations;
+	TArray<FCoverPointOctreeElement> coverPoints;
+	for (const FVector& centerLocation : centerLocations)
+	{
+		coverPoints.Reset();
+		coverSystem->FindCoverPoints(coverPoints, FSphere(centerLocation, maxDistance));
+		QueryInstance.ReserveItemData(coverPoints.Num());
+
+		for (const FCoverPointOctreeElement& coverPoint : coverPoints)
+		{
+			const FVector coverLocation = coverPoint.Data->Location;
+			if ((bExcludeTaken && coverPoint.Data->bTaken)
+				|| FVector::DistSquared(centerLocation, coverLocation) < minDistanceSquared)
+				continue;
+
+			// the annuli of multiple centers may overlap
+			if (centerLocations.Num() > 1)
+			{
+				bool bAlreadyAdded;
+				addedCoverLocations.Add(coverLocation, &bAlreadyAdded);
+				if (bAlreadyAdded)
+					continue;
+			}
+
+			QueryInstance.AddItemData<UEnvQueryItemType_Point>(FNavLocation(coverLocation, coverPoint.Data->NavPolyRef));
+		}
+	}
+}
+
+FText UEnvQueryGenerator_CoverPoints::GetDescriptionTitle() const
+{
+	return FText::Format(LOCTEXT("CoverPointsDescriptionGenerateAroundContext", "{0}: generate around {1}"),
+		Super::GetDescriptionTitle(), UEnvQueryTypes::DescribeContext(Center));
+}
+
+FText UEnvQueryGenerator_CoverPoints::GetDescriptionDetails() const
+{
+	return FText::Format(LOCTEXT("CoverPointsDescriptionDetails", "distance: {0} to {1}, {2}"),
+		FText::FromString(MinDistance.ToString()), FText::FromString(MaxDistance.ToString()),
+		bExcludeTaken ? LOCTEXT("CoverPointsExcludeTaken", "excluding taken") : LOCTEXT("CoverPointsIncludeTaken", "including taken"));
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,50 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "AI/EnvQueryTest_Cover.h"
+#include "EnvironmentQuery/Items/EnvQueryItemType_VectorBase.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/Controller.h"
+
+UEnvQueryTest_Cover::UEnvQueryTest_Cover()
+{
+	Cost = EEnvTestCost::High;
+	ValidItemType = UEnvQueryItemType_VectorBase::StaticClass();
+	SetWorkOnFloatValues(false);
+}
+
+const ACharacter* UEnvQueryTest_Cover::GetQuerierCharacter(FEnvQueryInstance& QueryInstance, float& OutEyeHeight) const
+{
+	UObject* queryOwner = QueryInstance.Owner.Get();
+	const ACharacter* character = Cast<ACharacter>(queryOwner);
+	if (!character)
+		if (const AController* controller = Cast<AController>(queryOwner))
+			character = Cast<ACharacter>(controller->GetPawn());
+
+	if (!IsValid(character))
+		return nullptr;
+
+	const float capsuleHalfHeight = character->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	OutEyeHeight = capsuleHalfHeight + (bCrouched ? character->CrouchedEyeHeight : character->BaseEyeHeight);
+	return character;
+}
+
+void UEnvQueryTest_Cover::FindItemCoverPoints(TMap<FVector, FCoverPointOctreeElement>& OutCoverPoints, FEnvQueryInstance& QueryInstance) const
+{
+	if (UCoverSystem::bShutdown)
+		return;
+
+	// time sliced tests pick up where their previous run left off, only the items that are still to be tested are looked up
+	FBox itemBounds(ForceInit);
+	for (int32 iItem = FMath::Max(0, QueryInstance.CurrentTestStartingItem); iItem < QueryInstance.Items.Num(); iItem++)
+		if (QueryInstance.Items[iItem].IsValid())
+			itemBounds += GetItemLocation(QueryInstance, iItem);
+
+	if (!itemBounds.IsValid)
+		return;
+
+	TArray<FCoverPointOctreeElement> coverPoints;
+	UCoverSystem::GetInstance(QueryInstance.World)->FindCoverPoints(coverPoints, itemBounds.ExpandBy(1.0f));
+	OutCoverPoints.Reserve(coverPoints.Num());
+	for (const FCoverPointOctreeElement& coverPoint : coverPoints)
+		OutCoverPoints.Add(coverPoint.Data->Location, coverPoint);
+}
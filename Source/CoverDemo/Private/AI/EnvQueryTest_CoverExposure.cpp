@@ -0,0 +1,63 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "AI/EnvQueryTest_CoverExposure.h"
+
+#define LOCTEXT_NAMESPACE "EnvQueryTest"
+
+UEnvQueryTest_CoverExposure::UEnvQueryTest_CoverExposure()
+{
+}
+
+void UEnvQueryTest_CoverExposure::RunTest(FEnvQueryInstance& QueryInstance) const
+{
+	UObject* queryOwner = QueryInstance.Owner.Get();
+	if (!queryOwner || !Threats || UCoverSystem::bShutdown)
+		return;
+
+	BoolValue.BindData(queryOwner, QueryInstance.QueryID);
+	const bool bWantsHidden = BoolValue.GetValue();
+
+	float charEyeHeight = 0.0f;
+	const ACharacter* character = GetQuerierCharacter(QueryInstance, charEyeHeight);
+	if (!character)
+		return;
+
+	TArray<AActor*> threatActors;
+	if (!QueryInstance.PrepareContext(Threats, threatActors))
+		return;
+
+	TArray<FCoverThreat> threats;
+	threats.Reserve(threatActors.Num());
+	for (const AActor* threatActor : threatActors)
+		if (IsValid(threatActor) && threatActor != character)
+			threats.Add(FCoverThreat(threatActor, threatActor->GetActorLocation()));
+
+	TMap<FVector, FCoverPointOctreeElement> coverPoints;
+	FindItemCoverPoints(coverPoints, QueryInstance);
+
+	// the item iterator stops once the time slice of the query runs out, the rest of the items are tested on its next run
+	const FCoverEvaluationSettings evaluationSettings = GetEvaluationSettings();
+	for (FEnvQueryInstance::ItemIterator It(this, QueryInstance); It; ++It)
+	{
+		const FCoverPointOctreeElement* coverPoint = coverPoints.Find(GetItemLocation(QueryInstance, It.GetIndex()));
+		int32 sweepCount = 0;
+		const bool bHidden = coverPoint
+			&& FCoverPointEvaluator::IsHiddenFromThreats(evaluationSettings, *coverPoint, character, charEyeHeight, nullptr, threats, QueryInstance.World, sweepCount);
+		INC_DWORD_STAT_BY(STAT_FindCoverSweepCount, sweepCount);
+
+		It.SetScore(TestPurpose, FilterType, bHidden, bWantsHidden);
+	}
+}
+
+FText UEnvQueryTest_CoverExposure::GetDescriptionTitle() const
+{
+	return FText::Format(LOCTEXT("CoverExposureDescriptionTitle", "{0}: from {1}"),
+		Super::GetDescriptionTitle(), UEnvQueryTypes::DescribeContext(Threats));
+}
+
+FText UEnvQueryTest_CoverExposure::GetDescriptionDetails() const
+{
+	return DescribeBoolTestParams("hidden");
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,61 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "AI/EnvQueryTest_CoverLean.h"
+
+#define LOCTEXT_NAMESPACE "EnvQueryTest"
+
+UEnvQueryTest_CoverLean::UEnvQueryTest_CoverLean()
+{
+}
+
+void UEnvQueryTest_CoverLean::RunTest(FEnvQueryInstance& QueryInstance) const
+{
+	UObject* queryOwner = QueryInstance.Owner.Get();
+	if (!queryOwner || !Enemy || UCoverSystem::bShutdown)
+		return;
+
+	BoolValue.BindData(queryOwner, QueryInstance.QueryID);
+	const bool bWantsGoodCover = BoolValue.GetValue();
+
+	float charEyeHeight = 0.0f;
+	const ACharacter* character = GetQuerierCharacter(QueryInstance, charEyeHeight);
+	if (!character)
+		return;
+
+	TArray<AActor*> enemies;
+	if (!QueryInstance.PrepareContext(Enemy, enemies) || enemies.Num() == 0 || !IsValid(enemies[0]))
+		return;
+	const AActor* targetEnemy = enemies[0];
+	const FVector enemyLocation = targetEnemy->GetActorLocation();
+
+	TMap<FVector, FCoverPointOctreeElement> coverPoints;
+	FindItemCoverPoints(coverPoints, QueryInstance);
+
+	// the item iterator stops once the time slice of the query runs out, the rest of the items are tested on its next run
+	const FCoverEvaluationSettings evaluationSettings = GetEvaluationSettings();
+	TMap<FVector, bool> clusterOutcomes;
+	for (FEnvQueryInstance::ItemIterator It(this, QueryInstance); It; ++It)
+	{
+		const FCoverPointOctreeElement* coverPoint = coverPoints.Find(GetItemLocation(QueryInstance, It.GetIndex()));
+		int32 sweepCount = 0;
+		const bool bGoodCover = coverPoint
+			&& FCoverPointEvaluator::CheckCluster(evaluationSettings, *coverPoint, character, charEyeHeight, targetEnemy, enemyLocation, QueryInstance.World, clusterOutcomes, sweepCount)
+			&& FCoverPointEvaluator::EvaluateCoverPointCached(evaluationSettings, *coverPoint, character, charEyeHeight, targetEnemy, enemyLocation, QueryInstance.World, sweepCount);
+		INC_DWORD_STAT_BY(STAT_FindCoverSweepCount, sweepCount);
+
+		It.SetScore(TestPurpose, FilterType, bGoodCover, bWantsGoodCover);
+	}
+}
+
+FText UEnvQueryTest_CoverLean::GetDescriptionTitle() const
+{
+	return FText::Format(LOCTEXT("CoverLeanDescriptionTitle", "{0}: from {1}"),
+		Super::GetDescriptionTitle(), UEnvQueryTypes::DescribeContext(Enemy));
+}
+
+FText UEnvQueryTest_CoverLean::GetDescriptionDetails() const
+{
+	return DescribeBoolTestParams("able to lean out of cover");
+}
+
+#undef LOCTEXT_NAMESPACE
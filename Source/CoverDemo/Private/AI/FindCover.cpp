@@ -5,17 +5,37 @@
 #include "Components/CapsuleComponent.h"
 #include "NavigationSystem.h"
 
-FVector UFindCover::GetPerpendicularVector(const FVector& Vector)
+uint64 UFindCover::FrameBudgetFrameNumber = 0;
+double UFindCover::FrameBudgetSpent = 0.0;
+
+UFindCover::UFindCover()
+{
+	bNotifyTick = true;
+	bNotifyTaskFinished = true;
+}
+
+uint16 UFindCover::GetInstanceMemorySize() const
+{
+	return sizeof(FFindCoverMemory);
+}
+
+void UFindCover::InitializeMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryInit::Type InitType) const
 {
-	return FVector(Vector.Y, -Vector.X, Vector.Z);
+	new (NodeMemory) FFindCoverMemory();
+}
+
+void UFindCover::CleanupMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryClear::Type CleanupType) const
+{
+	reinterpret_cast<FFindCoverMemory*>(NodeMemory)->~FFindCoverMemory();
 }
 
 const void UFindCover::GetCoverPoints(
 	TArray<FCoverPointOctreeElement>& OutCoverPoints,
+	TArray<FVector>& OutTakenCoverLocations,
 	UWorld* World,
 	const FVector& CharacterLocation,
 	const FVector& EnemyLocation,
-	UCoverFinderVisData& DebugData,
+	UCoverFinderVisData* DebugData,
 	const bool bUnitDebug) const
 {
 	const float minAttackRangeSquared = FMath::Square(MinAttackRange);
@@ -29,6 +49,10 @@ const void UFindCover::GetCoverPoints(
 
 	// filter out cover points that are too close to the enemy based on our min attack range, or already taken; populate a new array with the remaining, valid cover points only
 	for (FCoverPointOctreeElement coverPoint : coverPoints)
+	{
+		if (coverPoint.Data->bTaken)
+			OutTakenCoverLocations.Add(coverPoint.Data->Location);
+
 		if (!coverPoint.Data->bTaken
 			&& FVector::DistSquared(EnemyLocation, coverPoint.Data->Location) >= minAttackRangeSquared)
 		{
@@ -36,141 +60,46 @@ const void UFindCover::GetCoverPoints(
 
 #if DEBUG_RENDERING
 			if (bUnitDebug)
-				DebugData.DebugPoints.Add(FDebugPoint(coverPoint.Data->Location, FColor::Yellow, false));
+				DebugData->AddDebugPoint(FDebugPoint(coverPoint.Data->Location, FColor::Yellow, false));
 #endif
 		}
 #if DEBUG_RENDERING
 		else
 			if (bUnitDebug)
 				if (FVector::DistSquared(EnemyLocation, coverPoint.Data->Location) < minAttackRangeSquared)
-					DebugData.DebugPoints.Add(FDebugPoint(coverPoint.Data->Location, FColor::Black, false));
+					DebugData->AddDebugPoint(FDebugPoint(coverPoint.Data->Location, FColor::Black, false));
 #endif
-
-	// sort cover points by their distance to our unit
-	OutCoverPoints.Sort([CharacterLocation](const FCoverPointOctreeElement cp1, const FCoverPointOctreeElement cp2) {
-		return FVector::DistSquared(CharacterLocation, cp1.Data->Location) < FVector::DistSquared(CharacterLocation, cp2.Data->Location);
-	});
+	}
 }
 
 
 
-const bool UFindCover::CheckHitByLeaning(
-	const FVector& CoverLocation,
-	const ACharacter* OurUnit,
-	const AActor* TargetEnemy,
-	UWorld* World,
-	UCoverFinderVisData& DebugData,
-	bool bUnitDebug) const
-{
-	const FVector enemyLocation = TargetEnemy->GetActorLocation();
-
-	FHitResult hit;
-	FCollisionShape sphereColl;
-	sphereColl.SetSphere(5.0f);
-	FCollisionQueryParams collQueryParamsExclCharacter;
-	collQueryParamsExclCharacter.AddIgnoredActor(OurUnit);
-	collQueryParamsExclCharacter.TraceTag = "CoverPointFinder_CheckHitByLeaning";
-
-	// check leaning left and right
-	for (int directionMultiplier = 1; directionMultiplier > -2; directionMultiplier -= 2)
-	{
-		// calculate our reach for when leaning out of cover
-		const FVector coverEdge = enemyLocation - CoverLocation;
-		const FVector coverEdgeDir = coverEdge.GetUnsafeNormal();
-		FVector2D coverLean2D = FVector2D(GetPerpendicularVector(coverEdgeDir)) * directionMultiplier;
-		coverLean2D *= WeaponLeanOffset;
-		const FVector coverLean = FVector(CoverLocation.X + coverLean2D.X, CoverLocation.Y + coverLean2D.Y, CoverLocation.Z);
-
-		// check if we can hit our target by leaning out of cover
-		World->SweepSingleByChannel(hit, coverLean, enemyLocation, FQuat::Identity, ECollisionChannel::ECC_Camera, sphereColl, collQueryParamsExclCharacter);
-		if (hit.GetActor() == TargetEnemy)
-		{
-#if DEBUG_RENDERING
-			if (bUnitDebug)
-			{
-				DebugData.DebugArrows.Add(FDebugArrow(CoverLocation, coverLean, FColor::Orange, false));
-				DebugData.DebugArrows.Add(FDebugArrow(coverLean, hit.Location, FColor::Orange, false));
-			}
-#endif
-
-			return true;
-		}
-
-#if DEBUG_RENDERING
-		if (bUnitDebug)
-		{
-			DebugData.DebugArrows.Add(FDebugArrow(CoverLocation, coverLean, FColor::Cyan, false));
-			DebugData.DebugArrows.Add(FDebugArrow(coverLean, hit.Location, FColor::Cyan, false));
-		}
-#endif
-	}
-
-	// can't hit the enemy by leaning out of cover
-	return false;
-}
-
-const bool UFindCover::EvaluateCoverPoint(
-	const FCoverPointOctreeElement coverPoint,
+const bool UFindCover::IsCoverPointReachable(
+	const FCoverPointOctreeElement& CoverPoint,
 	const ACharacter* Character,
-	const float CharEyeHeight,
-	const AActor* TargetEnemy,
-	const FVector& EnemyLocation,
-	UWorld* World,
-	UCoverFinderVisData& DebugData,
-	bool bUnitDebug) const
+	const FVector& CharacterLocation,
+	const NavNodeRef CharacterPolyRef,
+	UWorld* World) const
 {
-	const FVector coverLocation = coverPoint.Data->Location;
-	const FVector coverLocationInEyeHeight = FVector(coverLocation.X, coverLocation.Y, coverLocation.Z - CoverPointGroundOffset + CharEyeHeight);
-
-	FHitResult hit;
-	FCollisionShape sphereColl;
-	sphereColl.SetSphere(5.0f);
-	FCollisionQueryParams collQueryParamsExclCharacter;
-	collQueryParamsExclCharacter.AddIgnoredActor(Character);
-	collQueryParamsExclCharacter.TraceTag = "CoverPointFinder_EvaluateCoverPoint";
-
-	// check if we can hit the enemy straight from the cover point. if we can, then the cover point is no good
-	if (!World->SweepSingleByChannel(hit, coverLocationInEyeHeight, EnemyLocation, FQuat::Identity, ECollisionChannel::ECC_Camera, sphereColl, collQueryParamsExclCharacter))
+	if (UCoverSystem::bShutdown)
 		return false;
 
-	// if the cover point is behind a shield then we shouldn't do any leaning checks, however we must be able to hit the enemy directly and through the shield
-	// for this, we will need a second raycast to determine if we're hitting the shield, which has a different collision response than regular objects
-	const AActor* hitActor = hit.GetActor();
-	if (coverPoint.Data->bForceField // cover is a force field (shield)
-		&& hitActor == TargetEnemy) // should be able to hit the enemy directly
+	switch (UCoverSystem::GetInstance(World)->GetReachability(CharacterPolyRef, CoverPoint.Data->NavPolyRef))
 	{
-		collQueryParamsExclCharacter.TraceTag = "CoverPointFinder_HitShieldFromCover";
-		FHitResult shieldHit;
-		bool bHitShield = World->SweepSingleByChannel(shieldHit, coverLocationInEyeHeight, EnemyLocation, FQuat::Identity, ECollisionChannel::ECC_GameTraceChannel2, sphereColl, collQueryParamsExclCharacter);
-		if (bHitShield // we must hit the shield
-			&& shieldHit.Distance <= CoverPointMaxObjectHitDistance) // cover point and cover object must be close to one another
-			return true;
-
-#if DEBUG_RENDERING
-		if (bUnitDebug)
-			if (!bHitShield)
-				DebugData.DebugArrows.Add(FDebugArrow(coverLocationInEyeHeight, EnemyLocation, FColor::Red, false));
-			else if (shieldHit.Distance > CoverPointMaxObjectHitDistance)
-				DebugData.DebugArrows.Add(FDebugArrow(coverLocationInEyeHeight, EnemyLocation, FColor::Black, false));
-#endif
-	}
-	// if the cover point is not behind a shield then check if we can hit the enemy by leaning out of cover
-	else if (!coverPoint.Data->bForceField // cover is not a force field (shield)
-		&& hit.Distance <= CoverPointMaxObjectHitDistance // cover point and cover object must be close to one another
-		&& hitActor != TargetEnemy // shouldn't be able to hit the enemy directly
-		&& !hitActor->IsA<APawn>() // can't hide behind other units, for now
-		&& CheckHitByLeaning(coverLocationInEyeHeight, Character, TargetEnemy, World, DebugData, bUnitDebug)) // we should only be able to hit the enemy by leaning out of cover
+	case ENavmeshReachability::Reachable:
 		return true;
+	case ENavmeshReachability::Unreachable:
+		INC_DWORD_STAT(STAT_FindCoverIslandRejectCount);
+		return false;
+	default:
+		break;
+	}
 
-#if DEBUG_RENDERING
-	if (bUnitDebug && !coverPoint.Data->bForceField)
-		if (hitActor == TargetEnemy)
-			DebugData.DebugArrows.Add(FDebugArrow(coverLocationInEyeHeight, EnemyLocation, FColor::Purple, false));
-		else if (hit.Distance > CoverPointMaxObjectHitDistance)
-			DebugData.DebugArrows.Add(FDebugArrow(coverLocationInEyeHeight, EnemyLocation, FColor::Blue, false));
-#endif
-
-	return false;
+	// the islands don't know about one of the polys, e.g. because its tile has just been rebuilt
+	INC_DWORD_STAT(STAT_FindCoverPathfindingCount);
+	const UNavigationSystemV1* navsys = UNavigationSystemV1::GetCurrent(World);
+	const ANavigationData* navdata = navsys->GetDefaultNavDataInstance();
+	return navsys->TestPathSync(FPathFindingQuery(Character, *navdata, CharacterLocation, CoverPoint.Data->Location));
 }
 
 EBTNodeResult::Type UFindCover::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
@@ -180,20 +109,26 @@ EBTNodeResult::Type UFindCover::ExecuteTask(UBehaviorTreeComponent& OwnerComp, u
 	INC_DWORD_STAT(STAT_FindCoverHistoricalCount);
 	SCOPE_SECONDS_ACCUMULATOR(STAT_FindCoverTotalTimeSpent);
 
+	FFindCoverMemory& memory = *reinterpret_cast<FFindCoverMemory*>(NodeMemory);
+	memory.Reset();
+
 	UWorld* world = GetWorld();
 	UBlackboardComponent* blackBoardComp = OwnerComp.GetBlackboardComponent();
 	const AActor* targetEnemy = Cast<AActor>(blackBoardComp->GetValue<UBlackboardKeyType_Object>(Enemy.SelectedKeyName));
 	const ACharacter* character = Cast<ACharacter>(OwnerComp.GetAIOwner()->GetPawn());
+	if (!IsValid(targetEnemy) || !IsValid(character))
+		return EBTNodeResult::Type::Failed;
+
 	const FVector characterLocation = character->GetActorLocation();
 	const FVector enemyLocation = targetEnemy->GetActorLocation();
-	UCoverFinderVisData* debugData = NewObject<UCoverFinderVisData>(this);
-	const bool bDrawDebug =
+	memory.TargetEnemy = targetEnemy;
+	memory.bDrawDebug =
 #if DEBUG_RENDERING
 		blackBoardComp->GetValueAsBool(DrawDebug.SelectedKeyName);
 #else
 		false;
 #endif
-	const bool bUnitDebug =
+	memory.bUnitDebug =
 #if DEBUG_RENDERING
 		blackBoardComp->GetValueAsBool(FName("bDebug"));
 #else
@@ -201,11 +136,19 @@ EBTNodeResult::Type UFindCover::ExecuteTask(UBehaviorTreeComponent& OwnerComp, u
 #endif
 
 #if DEBUG_RENDERING
-	blackBoardComp->SetValueAsObject(Key_VisData, debugData);
+	// the visualization data is only allocated once a debug flag is set, then reused by every execution
+	if (memory.bDrawDebug || memory.bUnitDebug)
+	{
+		if (!memory.DebugData.IsValid())
+			memory.DebugData.Reset(NewObject<UCoverFinderVisData>(&OwnerComp));
+
+		memory.DebugData->Reset();
+		blackBoardComp->SetValueAsObject(Key_VisData, memory.DebugData.Get());
+	}
 
 	// draw an arrow from our character to the enemy, in red, if the generic debug flag is set
-	if (bDrawDebug)
-		debugData->DebugArrows.Add(FDebugArrow(characterLocation, enemyLocation, FColor::Red, true));
+	if (memory.bDrawDebug)
+		memory.DebugData->AddDebugArrow(FDebugArrow(characterLocation, enemyLocation, FColor::Red, true));
 #endif
 
 	// release the former cover point, if any
@@ -219,62 +162,164 @@ EBTNodeResult::Type UFindCover::ExecuteTask(UBehaviorTreeComponent& OwnerComp, u
 	}
 
 	// get the cover points
-	TArray<FCoverPointOctreeElement> coverPoints;
-	GetCoverPoints(coverPoints, world, characterLocation, enemyLocation, *debugData, bUnitDebug);
+	TArray<FVector> takenCoverLocations;
+	GetCoverPoints(memory.CoverPoints, takenCoverLocations, world, characterLocation, enemyLocation, memory.DebugData.Get(), memory.bUnitDebug);
 
-	// get navigation data
-	const UNavigationSystemV1* navsys = UNavigationSystemV1::GetCurrent(GetWorld());
+	// find out how far our unit has to walk to get to them, with a single navmesh flood instead of pathfinding to each of them
+	const UNavigationSystemV1* navsys = UNavigationSystemV1::GetCurrent(world);
 	const ANavigationData* navdata = navsys->GetDefaultNavDataInstance();
+	FNavLocation characterNavLocation;
+	navdata->ProjectPoint(characterLocation, characterNavLocation, navdata->GetConfig().DefaultQueryExtent);
+	if (UCoverSystem::bShutdown)
+		return EBTNodeResult::Type::Failed;
+	UCoverSystem::GetInstance(world)->RankCoverPointsByPathCost(memory.CoverPoints, memory.CoverPointPathCosts, characterLocation, characterNavLocation.NodeRef, MaxCoverPathCost, false);
+
+	// rank them and only keep the best ones for evaluation
+	FCoverPointScorer::SelectBest(memory.CoverPoints, memory.CoverPointPathCosts, takenCoverLocations, characterLocation, enemyLocation, MaxCoverPathCost, ScoringSettings, MaxScoredCandidates);
 
 	// calculate the character's standing and crouched eye height offsets
 	const float capsuleHalfHeight = character->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
-	const float charEyeHeightStanding = capsuleHalfHeight + character->BaseEyeHeight;
-	const float charEyeHeightCrouched = capsuleHalfHeight + character->CrouchedEyeHeight;
+	memory.CharEyeHeightStanding = capsuleHalfHeight + character->BaseEyeHeight;
+	memory.CharEyeHeightCrouched = capsuleHalfHeight + character->CrouchedEyeHeight;
+
+	// the other enemies around our unit that it has to stay hidden from
+	FCoverPointEvaluator::GatherThreats(memory.Threats, world, ThreatClass, characterLocation, ThreatRadius, targetEnemy, MaxThreats);
+
+	// start evaluating right away, continue in TickTask() if we run out of time
+	return EvaluateCoverPoints(OwnerComp, memory);
+}
+
+void UFindCover::TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds)
+{
+	// profiling
+	SCOPE_CYCLE_COUNTER(STAT_FindCover);
+	SCOPE_SECONDS_ACCUMULATOR(STAT_FindCoverTotalTimeSpent);
+	INC_DWORD_STAT(STAT_FindCoverLatentTickCount);
+
+	const EBTNodeResult::Type result = EvaluateCoverPoints(OwnerComp, *reinterpret_cast<FFindCoverMemory*>(NodeMemory));
+	if (result != EBTNodeResult::Type::InProgress)
+		FinishLatentTask(OwnerComp, result);
+}
+
+EBTNodeResult::Type UFindCover::AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	reinterpret_cast<FFindCoverMemory*>(NodeMemory)->Reset();
+	return EBTNodeResult::Type::Aborted;
+}
+
+void UFindCover::OnTaskFinished(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTNodeResult::Type TaskResult)
+{
+	// don't hold on to the cover points until the next execution
+	reinterpret_cast<FFindCoverMemory*>(NodeMemory)->Reset();
+
+	Super::OnTaskFinished(OwnerComp, NodeMemory, TaskResult);
+}
+
+EBTNodeResult::Type UFindCover::EvaluateCoverPoints(UBehaviorTreeComponent& OwnerComp, FFindCoverMemory& Memory) const
+{
+	UWorld* world = GetWorld();
+	UBlackboardComponent* blackBoardComp = OwnerComp.GetBlackboardComponent();
+	const AActor* targetEnemy = Memory.TargetEnemy.Get();
+	const ACharacter* character = Cast<ACharacter>(OwnerComp.GetAIOwner()->GetPawn());
+	if (!IsValid(targetEnemy) || !IsValid(character))
+	{
+		blackBoardComp->ClearValue(OutputVector.SelectedKeyName);
+		return EBTNodeResult::Type::Failed;
+	}
+
+	// both of us may have moved since the last frame
+	const FVector characterLocation = character->GetActorLocation();
+	const FVector enemyLocation = targetEnemy->GetActorLocation();
+	UCoverFinderVisData* debugData = Memory.DebugData.Get();
+	FCoverPointEvaluator::UpdateThreats(Memory.Threats);
+
+	// find the navmesh poly our unit is on, for checking the reachability of cover points that the flood didn't know about
+	const UNavigationSystemV1* navsys = UNavigationSystemV1::GetCurrent(world);
+	const ANavigationData* navdata = navsys->GetDefaultNavDataInstance();
+	FNavLocation characterNavLocation;
+	navdata->ProjectPoint(characterLocation, characterNavLocation, navdata->GetConfig().DefaultQueryExtent);
+
+	// the budget is shared by all agents, reset it at the start of every frame
+	if (FrameBudgetFrameNumber != GFrameCounter)
+	{
+		FrameBudgetFrameNumber = GFrameCounter;
+		FrameBudgetSpent = 0.0;
+	}
+	const double frameBudget = FrameBudgetMicroseconds * 1e-6;
 
 	// find the first adequate cover point
-	for (const FCoverPointOctreeElement coverPoint : coverPoints)
+	bool bEvaluatedAny = false;
+	while (Memory.NextCoverPoint < Memory.CoverPoints.Num())
 	{
+		// always evaluate at least one cover point so that agents that tick late in the frame don't starve
+		if (bEvaluatedAny && FrameBudgetSpent >= frameBudget)
+			return EBTNodeResult::Type::InProgress;
+
+		const double evaluationStartTime = FPlatformTime::Seconds();
+		const bool bPathCostKnown = Memory.CoverPointPathCosts[Memory.NextCoverPoint] != UCoverSystem::UnknownPathCost;
+		const FCoverPointOctreeElement coverPoint = Memory.CoverPoints[Memory.NextCoverPoint++];
 		const FVector coverLocation = coverPoint.Data->Location;
-		
+		bEvaluatedAny = true;
+
 		// our unit must be able to reach the cover point
-		// TODO: this is a relatively expensive operation, consider implementing an async query instead?
-		if (!navsys->TestPathSync(FPathFindingQuery(character, *navdata, characterLocation, coverLocation)))
+		// the cover point may also have been taken by someone else since we've gathered it
+		bool bFoundCover = false;
+		if (!coverPoint.Data->bTaken)
 		{
+			// skip the whole cluster of the cover point if it doesn't provide cover from the enemy even when crouching
+			const FCoverEvaluationSettings evaluationSettings = GetEvaluationSettings();
+			int32 sweepCount = 0;
+			if (!FCoverPointEvaluator::CheckCluster(evaluationSettings, coverPoint, character, Memory.CharEyeHeightCrouched, targetEnemy, enemyLocation, world, Memory.ClusterOutcomes, sweepCount))
+			{
+				INC_DWORD_STAT(STAT_FindCoverClusterRejectCount);
+
 #if DEBUG_RENDERING
-			if (bUnitDebug)
-				debugData->DebugPoints.Add(FDebugPoint(coverPoint.Data->Location, FColor::Red, false));
+				if (Memory.bUnitDebug)
+					debugData->AddDebugPoint(FDebugPoint(coverPoint.Data->Location, FColor::Blue, false));
+#endif
+			}
+			// our unit must be able to reach the cover point
+			// the navmesh flood has already proven that for the ones it knows the path cost of, the rest need to be checked via the islands or pathfinding
+			else if (bPathCostKnown || IsCoverPointReachable(coverPoint, character, characterLocation, characterNavLocation.NodeRef, world))
+			{
+				// check from a standing position and if that fails then from a crouched one
+				bFoundCover = FCoverPointEvaluator::EvaluateCoverPointAgainstThreats(evaluationSettings, coverPoint, character, Memory.CharEyeHeightStanding, targetEnemy, enemyLocation, Memory.Threats, world, sweepCount, debugData, Memory.bUnitDebug)
+					|| FCoverPointEvaluator::EvaluateCoverPointAgainstThreats(evaluationSettings, coverPoint, character, Memory.CharEyeHeightCrouched, targetEnemy, enemyLocation, Memory.Threats, world, sweepCount, debugData, Memory.bUnitDebug);
+			}
+#if DEBUG_RENDERING
+			else if (Memory.bUnitDebug)
+				debugData->AddDebugPoint(FDebugPoint(coverPoint.Data->Location, FColor::Red, false));
 #endif
 
-			continue;
+			INC_DWORD_STAT_BY(STAT_FindCoverSweepCount, sweepCount);
 		}
 
-		// check from a standing position and if that fails then from a crouched one
-		bool bFoundCover = EvaluateCoverPoint(coverPoint, character, charEyeHeightStanding, targetEnemy, enemyLocation, world, *debugData, bUnitDebug)
-			|| EvaluateCoverPoint(coverPoint, character, charEyeHeightCrouched, targetEnemy, enemyLocation, world, *debugData, bUnitDebug);
+		FrameBudgetSpent += FPlatformTime::Seconds() - evaluationStartTime;
 
-		if (bFoundCover)
-		{
-			// mark the cover point as taken
-			if (UCoverSystem::bShutdown)
-				return EBTNodeResult::Type::Failed;
-			UCoverSystem::GetInstance(world)->HoldCover(coverLocation);
+		if (!bFoundCover)
+			continue;
 
-			// draw an arrow from the cover point to the enemy, in green (success), if the unit debug flag is set
+		// mark the cover point as taken, unless someone else has beaten us to it
+		if (UCoverSystem::bShutdown)
+			return EBTNodeResult::Type::Failed;
+		if (!UCoverSystem::GetInstance(world)->HoldCover(coverLocation))
+			continue;
+
+		// draw an arrow from the cover point to the enemy, in green (success), if the unit debug flag is set
 #if DEBUG_RENDERING
-			if (bUnitDebug)
-				debugData->DebugArrows.Add(FDebugArrow(coverLocation, enemyLocation, FColor::Green, false));
+		if (Memory.bUnitDebug)
+			debugData->AddDebugArrow(FDebugArrow(coverLocation, enemyLocation, FColor::Green, false));
 #endif
 
-			// set the cover location in the BB
-			blackBoardComp->SetValueAsVector(OutputVector.SelectedKeyName, coverLocation);
-			return EBTNodeResult::Type::Succeeded;
-		}
+		// set the cover location in the BB
+		blackBoardComp->SetValueAsVector(OutputVector.SelectedKeyName, coverLocation);
+		return EBTNodeResult::Type::Succeeded;
 	}
 
 	// draw a red marker above units that can't find any cover
 #if DEBUG_RENDERING
-	if (bDrawDebug)
-		debugData->DebugPoints.Add(FDebugPoint(characterLocation + FVector(0.0f, 0.0f, 200.0f), FColor::Red, true));
+	if (Memory.bDrawDebug)
+		debugData->AddDebugPoint(FDebugPoint(characterLocation + FVector(0.0f, 0.0f, 200.0f), FColor::Red, true));
 #endif
 
 	// no cover found: unset the cover location in the BB
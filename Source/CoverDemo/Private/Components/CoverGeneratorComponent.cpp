@@ -8,7 +8,9 @@ UCoverGeneratorComponent::UCoverGeneratorComponent()
 {
 	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
 	// off to improve performance if you don't need them.
-	PrimaryComponentTick.bCanEverTick = false;
+	// Only movable cover ticks, see BeginPlay().
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
 }
 
 // Called when the game starts
@@ -16,15 +18,82 @@ void UCoverGeneratorComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
+	UNavigationSystemV1* navsys = UNavigationSystemV1::GetCurrent(GetWorld());
+	if (IsValid(navsys))
+		Navmesh = Cast<AChangeNotifyingRecastNavMesh>(navsys->MainNavData);
+
+	UpdateOverlappingTiles();
+
+	// generate cover points NEAR begin play, if requested
+	// have to wait for the navmesh to finish generation, first
+	// afterwards, only regenerate when the navmesh gets rebuilt around the owner
+	if (bGenerateOnBeginPlay)
+	{
+		if (Navmesh.IsValid())
+			Navmesh->NavmeshTilesUpdatedUntilFinishedDelegate.AddDynamic(this, &UCoverGeneratorComponent::OnNavmeshTilesUpdatedUntilFinished);
+		else if (IsValid(navsys))
+			navsys->OnNavigationGenerationFinishedDelegate.AddDynamic(this, &UCoverGeneratorComponent::OnNavmeshGenerationFinished);
+	}
+
+	// movable cover keeps checking whether its owner has moved
+	if (bMovableCover)
+	{
+		SetComponentTickInterval(MovementCheckInterval);
+		SetComponentTickEnabled(true);
+	}
+}
+
+void UCoverGeneratorComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UnbindNavmeshDelegates();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UCoverGeneratorComponent::UnbindNavmeshDelegates()
+{
+	if (Navmesh.IsValid())
+		Navmesh->NavmeshTilesUpdatedUntilFinishedDelegate.RemoveDynamic(this, &UCoverGeneratorComponent::OnNavmeshTilesUpdatedUntilFinished);
+
+	UNavigationSystemV1* navsys = UNavigationSystemV1::GetCurrent(GetWorld());
+	if (IsValid(navsys))
+		navsys->OnNavigationGenerationFinishedDelegate.RemoveDynamic(this, &UCoverGeneratorComponent::OnNavmeshGenerationFinished);
+}
+
+void UCoverGeneratorComponent::UpdateOverlappingTiles()
+{
 	FVector origin;
 	FVector extent;
 	GetOwner()->GetActorBounds(false, origin, extent);
 	OwnerBounds = FBoxCenterAndExtent(origin, extent).GetBox();
 
-	// generate cover points NEAR begin play, if requested
-	// have to wait for the navmesh to finish generation, first
-	if (bGenerateOnBeginPlay)
-		UNavigationSystemV1::GetCurrent(GetWorld())->OnNavigationGenerationFinishedDelegate.AddDynamic(this, &UCoverGeneratorComponent::OnNavmeshGenerationFinished);
+	if (!Navmesh.IsValid())
+		return;
+
+	// the generator task expands the scanned area, so do the same here
+	const FBox scanBounds = OwnerBounds.ExpandBy(ScanGridUnit * BoundingBoxExpansion);
+	FIntPoint cornerA, cornerB;
+	if (!Navmesh->GetNavMeshTileXY(scanBounds.Min, cornerA.X, cornerA.Y)
+		|| !Navmesh->GetNavMeshTileXY(scanBounds.Max, cornerB.X, cornerB.Y))
+		return;
+
+	// recast's axes don't match ours, so the corners may come back swapped
+	OverlappingTilesMin = FIntPoint(FMath::Min(cornerA.X, cornerB.X), FMath::Min(cornerA.Y, cornerB.Y));
+	OverlappingTilesMax = FIntPoint(FMath::Max(cornerA.X, cornerB.X), FMath::Max(cornerA.Y, cornerB.Y));
+}
+
+bool UCoverGeneratorComponent::AreOverlappingTilesUpdated() const
+{
+	if (!Navmesh.IsValid())
+		return true;
+
+	const TSet<FIntPoint>& updatedTileCoordinates = Navmesh->GetLastFinishedTileCoordinates();
+	for (int32 tileX = OverlappingTilesMin.X; tileX <= OverlappingTilesMax.X; tileX++)
+		for (int32 tileY = OverlappingTilesMin.Y; tileY <= OverlappingTilesMax.Y; tileY++)
+			if (updatedTileCoordinates.Contains(FIntPoint(tileX, tileY)))
+				return true;
+
+	return false;
 }
 
 void UCoverGeneratorComponent::OnNavmeshGenerationFinished(ANavigationData* NavData)
@@ -32,12 +101,27 @@ void UCoverGeneratorComponent::OnNavmeshGenerationFinished(ANavigationData* NavD
 	GenerateCoverPoints();
 }
 
+void UCoverGeneratorComponent::OnNavmeshTilesUpdatedUntilFinished(const TSet<uint32>& UpdatedTiles)
+{
+	// always generate after the first navmesh build, then only if the navmesh has been rebuilt around the owner
+	if (!bFirstNavmeshGeneration && !AreOverlappingTilesUpdated())
+		return;
+
+	bFirstNavmeshGeneration = false;
+	UpdateOverlappingTiles();
+	GenerateCoverPoints();
+}
+
 void UCoverGeneratorComponent::OnComponentDestroyed(bool bDestroyingHierarchy)
 {
+	UnbindNavmeshDelegates();
+
 	// remove owner's cover points from the map upon destroy
 	if (UCoverSystem::bShutdown)
 		return;
 	UCoverSystem::GetInstance(GetWorld())->RemoveCoverPointsOfObject(GetOwner());
+	if (bMovableCover)
+		UCoverSystem::GetInstance(GetWorld())->UnregisterMovableCoverObject(GetOwner());
 
 	Super::OnComponentDestroyed(bDestroyingHierarchy);
 }
@@ -46,6 +130,29 @@ void UCoverGeneratorComponent::OnComponentDestroyed(bool bDestroyingHierarchy)
 void UCoverGeneratorComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (!bMovableCover || !bCoverGenerated || UCoverSystem::bShutdown)
+		return;
+
+	const FTransform ownerTransform = GetOwner()->GetActorTransform();
+
+	// rotating or scaling the owner changes the shape of its cover, so regenerate it from scratch
+	if (ownerTransform.GetRotation().AngularDistance(GenerationTransform.GetRotation()) > FMath::DegreesToRadians(RotationTolerance)
+		|| !ownerTransform.GetScale3D().Equals(GenerationTransform.GetScale3D(), ScaleTolerance))
+	{
+		INC_DWORD_STAT(STAT_MoveCoverRegenerationCount);
+		UCoverSystem::GetInstance(GetWorld())->RemoveCoverPointsOfObject(GetOwner());
+		GenerateCoverPoints();
+		return;
+	}
+
+	// otherwise just move the existing cover points along with the owner once it has moved far enough
+	if (FVector::DistSquared(ownerTransform.GetLocation(), LastCoverTransform.GetLocation()) > FMath::Square(MovementThreshold))
+	{
+		UCoverSystem::GetInstance(GetWorld())->MoveCoverPointsOfObject(GetOwner(), ownerTransform);
+		LastCoverTransform = ownerTransform;
+		UpdateOverlappingTiles();
+	}
 }
 
 void UCoverGeneratorComponent::GenerateCoverPoints()
@@ -56,6 +163,17 @@ void UCoverGeneratorComponent::GenerateCoverPoints()
 	bDebugDraw = UCoverSystem::GetInstance(GetWorld())->bDebugDraw;
 #endif
 
+	// movable cover: the cover points about to be generated will be stored relative to the owner's current transform
+	if (bMovableCover)
+	{
+		if (UCoverSystem::bShutdown)
+			return;
+		GenerationTransform = GetOwner()->GetActorTransform();
+		LastCoverTransform = GenerationTransform;
+		bCoverGenerated = true;
+		UCoverSystem::GetInstance(GetWorld())->RegisterMovableCoverObject(GetOwner(), GenerationTransform);
+	}
+
 	// spawn the cover generator task
 #if DEBUG_RENDERING
 	if (bDebugDraw)
@@ -65,16 +183,35 @@ void UCoverGeneratorComponent::GenerateCoverPoints()
 			BoundingBoxExpansion,
 			ScanGridUnit,
 			SmallestAgentHeight,
-			bGeneratePerStaticMesh
+			bGeneratePerStaticMesh,
+			bUseMeshCoverTemplates,
+			bGeneratePerInstance
 			))->StartSynchronousTask();
 	else
 #endif
+	if (bUseGenerationScheduler)
+	{
+		if (UCoverSystem::bShutdown)
+			return;
+		UCoverSystem::GetInstance(GetWorld())->QueueActorCoverGeneration(FActorCoverGenerationRequest(
+			GetOwner(),
+			BoundingBoxExpansion,
+			ScanGridUnit,
+			SmallestAgentHeight,
+			bGeneratePerStaticMesh,
+			bUseMeshCoverTemplates,
+			bGeneratePerInstance
+		));
+	}
+	else
 		(new FAutoDeleteAsyncTask<FActorCoverPointGeneratorTask>(
 			GetOwner(),
 			GetWorld(),
 			BoundingBoxExpansion,
 			ScanGridUnit,
 			SmallestAgentHeight,
-			bGeneratePerStaticMesh
+			bGeneratePerStaticMesh,
+			bUseMeshCoverTemplates,
+			bGeneratePerInstance
 		))->StartBackgroundTask();
 }
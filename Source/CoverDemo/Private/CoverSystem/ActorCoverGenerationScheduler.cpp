@@ -0,0 +1,167 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "CoverSystem/ActorCoverGenerationScheduler.h"
+#include "Tasks/ActorCoverPointGeneratorTask.h"
+
+FThreadSafeCounter FActorCoverGenerationScheduler::TasksInFlight;
+
+FActorCoverGenerationScheduler::FActorCoverGenerationScheduler(UWorld* _World)
+	: World(_World)
+{}
+
+FActorCoverGenerationScheduler::~FActorCoverGenerationScheduler()
+{
+	if (World.IsValid())
+		World->GetTimerManager().ClearTimer(FlushTimerHandle);
+
+	PendingRequests.Empty();
+	SET_DWORD_STAT(STAT_ActorGenerationQueueDepth, 0);
+}
+
+void FActorCoverGenerationScheduler::QueueRequest(const FActorCoverGenerationRequest& Request)
+{
+	INC_DWORD_STAT(STAT_ActorGenerationRequestCount);
+
+	// the same actor is already waiting for generation
+	for (const FActorCoverGenerationRequest& pendingRequest : PendingRequests)
+		if (pendingRequest.Owner == Request.Owner)
+		{
+			INC_DWORD_STAT(STAT_ActorGenerationDuplicateCount);
+			return;
+		}
+
+	PendingRequests.Add(Request);
+	SET_DWORD_STAT(STAT_ActorGenerationQueueDepth, PendingRequests.Num());
+
+	ScheduleFlush();
+}
+
+void FActorCoverGenerationScheduler::ScheduleFlush()
+{
+	if (!World.IsValid())
+		return;
+
+	FTimerManager& timerManager = World->GetTimerManager();
+	if (!timerManager.IsTimerActive(FlushTimerHandle))
+		timerManager.SetTimer(FlushTimerHandle, FTimerDelegate::CreateRaw(this, &FActorCoverGenerationScheduler::Flush), CoalescingWindow, false);
+}
+
+void FActorCoverGenerationScheduler::Flush()
+{
+	if (UCoverSystem::bShutdown || !World.IsValid())
+		return;
+
+	// drop the requests of actors that have been destroyed in the meantime
+	PendingRequests.RemoveAllSwap([](const FActorCoverGenerationRequest& Request) { return !Request.Owner.IsValid(); });
+
+	TArray<FBox> requestBounds;
+	requestBounds.Reserve(PendingRequests.Num());
+	for (const FActorCoverGenerationRequest& request : PendingRequests)
+		requestBounds.Add(request.Owner->GetComponentsBoundingBox());
+
+	TBitArray<> bDispatched(false, PendingRequests.Num());
+	for (int32 iRequest = 0; iRequest < PendingRequests.Num() && TasksInFlight.GetValue() < MaxTasksInFlight; iRequest++)
+	{
+		if (bDispatched[iRequest])
+			continue;
+
+		const FActorCoverGenerationRequest& request = PendingRequests[iRequest];
+		bDispatched[iRequest] = true;
+		TasksInFlight.Increment();
+
+		if (!request.CanBeMerged())
+		{
+			(new FAutoDeleteAsyncTask<FActorCoverPointGeneratorTask>(
+				request.Owner.Get(),
+				World.Get(),
+				request.BoundingBoxExpansion,
+				request.ScanGridUnit,
+				request.SmallestAgentHeight,
+				request.bGeneratePerStaticMesh,
+				request.bUseMeshCoverTemplates,
+				request.bGeneratePerInstance,
+				true
+			))->StartBackgroundTask();
+			continue;
+		}
+
+		// grow the group's bounds by any mergeable request that overlaps or is adjacent to it, until there's nothing left to merge
+		TArray<AActor*> mergedOwners = { request.Owner.Get() };
+		TArray<FBox> mergedOwnerBounds = { requestBounds[iRequest] };
+		FBox mergedBounds = requestBounds[iRequest];
+		float mergedVolumeSum = mergedBounds.GetVolume();
+		const float adjacencyTolerance = request.ScanGridUnit * AdjacencyTolerance;
+
+		bool bMerged = true;
+		while (bMerged)
+		{
+			bMerged = false;
+			for (int32 iOtherRequest = iRequest + 1; iOtherRequest < PendingRequests.Num(); iOtherRequest++)
+			{
+				const FActorCoverGenerationRequest& otherRequest = PendingRequests[iOtherRequest];
+				if (bDispatched[iOtherRequest]
+					|| !otherRequest.CanBeMerged()
+					|| !otherRequest.HasSameScanSettings(request))
+					continue;
+
+				const FBox& otherBounds = requestBounds[iOtherRequest];
+				if (!mergedBounds.ExpandBy(adjacencyTolerance).Intersect(otherBounds))
+					continue;
+
+				const FBox newMergedBounds = mergedBounds + otherBounds;
+				const float newMergedVolumeSum = mergedVolumeSum + otherBounds.GetVolume();
+				if (newMergedBounds.GetVolume() > newMergedVolumeSum * MaxMergedVolumeRatio)
+					continue;
+
+				mergedBounds = newMergedBounds;
+				mergedVolumeSum = newMergedVolumeSum;
+				mergedOwners.Add(otherRequest.Owner.Get());
+				mergedOwnerBounds.Add(otherBounds);
+				bDispatched[iOtherRequest] = true;
+				bMerged = true;
+
+				INC_DWORD_STAT(STAT_ActorGenerationMergedCount);
+			}
+		}
+
+		if (mergedOwners.Num() > 1)
+			(new FAutoDeleteAsyncTask<FActorCoverPointGeneratorTask>(
+				mergedOwners,
+				mergedOwnerBounds,
+				mergedBounds,
+				World.Get(),
+				request.BoundingBoxExpansion,
+				request.ScanGridUnit,
+				request.SmallestAgentHeight
+			))->StartBackgroundTask();
+		else
+			(new FAutoDeleteAsyncTask<FActorCoverPointGeneratorTask>(
+				request.Owner.Get(),
+				World.Get(),
+				request.BoundingBoxExpansion,
+				request.ScanGridUnit,
+				request.SmallestAgentHeight,
+				request.bGeneratePerStaticMesh,
+				request.bUseMeshCoverTemplates,
+				request.bGeneratePerInstance,
+				true
+			))->StartBackgroundTask();
+	}
+
+	// keep the requests that didn't fit for the next window
+	for (int32 iRequest = PendingRequests.Num() - 1; iRequest >= 0; iRequest--)
+		if (bDispatched[iRequest])
+			PendingRequests.RemoveAt(iRequest, 1, false);
+
+	SET_DWORD_STAT(STAT_ActorGenerationQueueDepth, PendingRequests.Num());
+	SET_DWORD_STAT(STAT_ActorGenerationTasksInFlight, TasksInFlight.GetValue());
+
+	if (PendingRequests.Num() > 0)
+		ScheduleFlush();
+}
+
+void FActorCoverGenerationScheduler::OnTaskFinished()
+{
+	TasksInFlight.Decrement();
+	SET_DWORD_STAT(STAT_ActorGenerationTasksInFlight, TasksInFlight.GetValue());
+}
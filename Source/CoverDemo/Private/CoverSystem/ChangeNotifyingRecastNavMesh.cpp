@@ -8,17 +8,23 @@ DECLARE_LOG_CATEGORY_EXTERN(OurNavMesh, Log, All);
 DEFINE_LOG_CATEGORY(OurNavMesh)
 
 AChangeNotifyingRecastNavMesh::AChangeNotifyingRecastNavMesh() : Super()
-{}
+{
+	for (std::atomic<uint32>& queuedTileWord : QueuedTileBits)
+		queuedTileWord.store(0, std::memory_order_relaxed);
+}
 
 AChangeNotifyingRecastNavMesh::AChangeNotifyingRecastNavMesh(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
-{}
+{
+	for (std::atomic<uint32>& queuedTileWord : QueuedTileBits)
+		queuedTileWord.store(0, std::memory_order_relaxed);
+}
 
 void AChangeNotifyingRecastNavMesh::BeginPlay()
 {
 	Super::BeginPlay();
 
-	GetWorld()->GetTimerManager().SetTimer(TileUpdateTimerHandle, this, &AChangeNotifyingRecastNavMesh::ProcessQueuedTiles, TileBufferInterval, true);
+	ScheduleProcessQueuedTiles();
 	//TODO: remove? started getting double registrations after the mission selector integration
 	UNavigationSystemV1::GetCurrent(GetWorld())->OnNavigationGenerationFinishedDelegate.RemoveDynamic(this, &AChangeNotifyingRecastNavMesh::OnNavmeshGenerationFinishedHandler);
 	UNavigationSystemV1::GetCurrent(GetWorld())->OnNavigationGenerationFinishedDelegate.AddDynamic(this, &AChangeNotifyingRecastNavMesh::OnNavmeshGenerationFinishedHandler); // avoid a name clash with OnNavMeshGenerationFinished()
@@ -31,37 +37,155 @@ void AChangeNotifyingRecastNavMesh::EndPlay(const EEndPlayReason::Type EndPlayRe
 	Super::EndPlay(EndPlayReason);
 }
 
+void AChangeNotifyingRecastNavMesh::RebuildDirtyAreas(const TArray<FNavigationDirtyArea>& DirtyAreas)
+{
+	for (const FNavigationDirtyArea& dirtyArea : DirtyAreas)
+		if (dirtyArea.HasFlag(ENavigationDirtyFlags::NavigationBounds))
+			RecentWholeTileAreas.Add(dirtyArea.Bounds);
+		else
+			RecentDirtyAreas.Add(dirtyArea.Bounds);
+
+	Super::RebuildDirtyAreas(DirtyAreas);
+}
+
+void AChangeNotifyingRecastNavMesh::RebuildAll()
+{
+	NavmeshRebuildAllDelegate.Broadcast();
+	bRebuildingAll = true;
+
+	Super::RebuildAll();
+}
+
 void AChangeNotifyingRecastNavMesh::OnNavMeshTilesUpdated(const TArray<FNavTileRef>& ChangedTiles)
 {
 	Super::OnNavMeshTilesUpdated(ChangedTiles);
 	TArray<uint32> ChangedTilesIDs;
 	FNavTileRef::DeprecatedGetTileIdsFromNavTileRefs(GetRecastNavMeshImpl(), ChangedTiles, ChangedTilesIDs);
-	TSet<uint32> updatedTiles;
+
+	const double updateTime = FPlatformTime::Seconds();
 	for (uint32 changedTile : ChangedTilesIDs)
 	{
-		updatedTiles.Add(changedTile);
-		UpdatedTilesIntervalBuffer.Add(changedTile);
-		UpdatedTilesUntilFinishedBuffer.Add(changedTile);
+		// only queue the tile if it isn't queued already
+		// the first update is the one that's kept so that the latency of cover generation includes the time spent in buffers
+		if (changedTile < MaxDeduplicatedTiles)
+		{
+			const uint32 tileBit = 1u << (changedTile % 32);
+			if (QueuedTileBits[changedTile / 32].fetch_or(tileBit, std::memory_order_acq_rel) & tileBit)
+				continue;
+		}
+
+		QueuedTiles.Enqueue({ changedTile, updateTime });
 	}
 
 	// fire the immediate delegate
-	NavmeshTilesUpdatedImmediateDelegate.Broadcast(updatedTiles);
+	if (NavmeshTilesUpdatedImmediateDelegate.IsBound())
+		NavmeshTilesUpdatedImmediateDelegate.Broadcast(TSet<uint32>(ChangedTilesIDs));
+}
+
+void AChangeNotifyingRecastNavMesh::DrainQueuedTiles(int32 MaxTiles)
+{
+	FQueuedTile queuedTile;
+	for (int32 iTile = 0; iTile < MaxTiles && QueuedTiles.Dequeue(queuedTile); iTile++)
+	{
+		// clear the tile's bit first so that an update that comes in from now on queues it again
+		if (queuedTile.TileIdx < MaxDeduplicatedTiles)
+			QueuedTileBits[queuedTile.TileIdx / 32].fetch_and(~(1u << (queuedTile.TileIdx % 32)), std::memory_order_acq_rel);
+
+		UpdatedTilesIntervalBuffer.Add(queuedTile.TileIdx);
+		UpdatedTilesUntilFinishedBuffer.Add(queuedTile.TileIdx);
+		if (!TileUpdateTimes.Contains(queuedTile.TileIdx))
+			TileUpdateTimes.Add(queuedTile.TileIdx, queuedTile.UpdateTime);
+
+		// once a tile has been rebuilt as a whole, any dirty areas it overlaps are only part of what has changed
+		if (bRebuildingAll)
+			WholeRebuiltTiles.Add(queuedTile.TileIdx);
+		else if (RecentWholeTileAreas.Num() > 0)
+		{
+			const FBox tileBounds = GetNavMeshTileBounds(static_cast<int32>(queuedTile.TileIdx));
+			const FBox2D tileBounds2D(FVector2D(tileBounds.Min), FVector2D(tileBounds.Max));
+			for (const FBox& wholeTileArea : RecentWholeTileAreas)
+				if (tileBounds2D.Intersect(FBox2D(FVector2D(wholeTileArea.Min), FVector2D(wholeTileArea.Max))))
+				{
+					WholeRebuiltTiles.Add(queuedTile.TileIdx);
+					break;
+				}
+		}
+	}
 }
 
 void AChangeNotifyingRecastNavMesh::ProcessQueuedTiles()
 {
-	FScopeLock TileUpdateLock(&TileUpdateLockObject);
+	DrainQueuedTiles(TileDrainBatchSize);
+
 	if (UpdatedTilesIntervalBuffer.Num() > 0)
 	{
 		UE_LOG(OurNavMesh, Log, TEXT("OnNavMeshTilesUpdated - tile count: %d"), UpdatedTilesIntervalBuffer.Num());
 		NavmeshTilesUpdatedBufferedDelegate.Broadcast(UpdatedTilesIntervalBuffer);
-		UpdatedTilesIntervalBuffer.Empty();
+		UpdatedTilesIntervalBuffer.Reset();
+		TileUpdateTimes.Reset();
+		WholeRebuiltTiles.Reset();
 	}
+
+	// the dirty areas can go once every tile they've caused to be rebuilt has been broadcast, and so can a full rebuild
+	const UNavigationSystemV1* navsys = UNavigationSystemV1::GetCurrent(GetWorld());
+	if (QueuedTiles.IsEmpty() && IsValid(navsys) && !navsys->IsNavigationBuildInProgress())
+	{
+		RecentDirtyAreas.Reset();
+		RecentWholeTileAreas.Reset();
+		bRebuildingAll = false;
+	}
+
+	ScheduleProcessQueuedTiles();
+}
+
+void AChangeNotifyingRecastNavMesh::ScheduleProcessQueuedTiles()
+{
+	UWorld* world = GetWorld();
+	if (!IsValid(world))
+		return;
+
+	const float interval = TileBufferIntervalDelegate.IsBound() ? TileBufferIntervalDelegate.Execute() : TileBufferInterval;
+	world->GetTimerManager().SetTimer(TileUpdateTimerHandle, this, &AChangeNotifyingRecastNavMesh::ProcessQueuedTiles, interval, false);
+}
+
+double AChangeNotifyingRecastNavMesh::GetTileUpdateTime(uint32 TileIdx) const
+{
+	const double* updateTime = TileUpdateTimes.Find(TileIdx);
+	return updateTime ? *updateTime : FPlatformTime::Seconds();
+}
+
+bool AChangeNotifyingRecastNavMesh::GetDirtyAreasInTile(TArray<FBox>& OutDirtyAreas, uint32 TileIdx) const
+{
+	if (WholeRebuiltTiles.Contains(TileIdx))
+		return false;
+
+	// tiles span the whole height of the navmesh, so only compare the XY-planes
+	const FBox tileBounds = GetNavMeshTileBounds(static_cast<int32>(TileIdx));
+	const FBox2D tileBounds2D(FVector2D(tileBounds.Min), FVector2D(tileBounds.Max));
+
+	bool bFound = false;
+	for (const FBox& dirtyArea : RecentDirtyAreas)
+		if (tileBounds2D.Intersect(FBox2D(FVector2D(dirtyArea.Min), FVector2D(dirtyArea.Max))))
+		{
+			OutDirtyAreas.Add(dirtyArea);
+			bFound = true;
+		}
+
+	return bFound;
 }
 
 void AChangeNotifyingRecastNavMesh::OnNavmeshGenerationFinishedHandler(ANavigationData* NavData)
 {
-	FScopeLock TileUpdateLock(&TileUpdateLockObject);
+	// everything that's been updated until now belongs to this build
+	DrainQueuedTiles(MAX_int32);
+
+	// resolve the tile coordinates once so that listeners can cheaply check whether their area has been touched
+	LastFinishedTileCoordinates.Reset();
+	int32 tileX, tileY, tileLayer;
+	for (uint32 tileIdx : UpdatedTilesUntilFinishedBuffer)
+		if (GetNavMeshTileXY(static_cast<int32>(tileIdx), tileX, tileY, tileLayer))
+			LastFinishedTileCoordinates.Add(FIntPoint(tileX, tileY));
+
 	NavmeshTilesUpdatedUntilFinishedDelegate.Broadcast(UpdatedTilesUntilFinishedBuffer);
-	UpdatedTilesUntilFinishedBuffer.Empty();
+	UpdatedTilesUntilFinishedBuffer.Reset();
 }
@@ -0,0 +1,155 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "CoverSystem/CoverChangeNotifier.h"
+#include "CoverSystem/CoverSystem.h"
+#include "Async/Async.h"
+
+FCoverChangeNotifier::FCoverChangeNotifier(UWorld* _World)
+	: World(_World)
+{}
+
+FCoverChangeNotifier::~FCoverChangeNotifier()
+{
+	if (World.IsValid())
+		World->GetTimerManager().ClearTimer(FlushTimerHandle);
+
+	Subscriptions.Empty();
+	SET_DWORD_STAT(STAT_CoverSubscriptionCount, 0);
+}
+
+int32 FCoverChangeNotifier::Subscribe(const FBox& Box, const FCoverChangesDelegate& Delegate)
+{
+	FRWScopeLock SubscriptionLock(SubscriptionLockObject, FRWScopeLockType::SLT_Write);
+	const int32 subscriptionID = NextSubscriptionID++;
+	Subscriptions.Add(subscriptionID, FCoverSubscription(Box, Delegate));
+	SET_DWORD_STAT(STAT_CoverSubscriptionCount, Subscriptions.Num());
+	return subscriptionID;
+}
+
+int32 FCoverChangeNotifier::Subscribe(const FSphere& Sphere, const FCoverChangesDelegate& Delegate)
+{
+	FRWScopeLock SubscriptionLock(SubscriptionLockObject, FRWScopeLockType::SLT_Write);
+	const int32 subscriptionID = NextSubscriptionID++;
+	Subscriptions.Add(subscriptionID, FCoverSubscription(Sphere, Delegate));
+	SET_DWORD_STAT(STAT_CoverSubscriptionCount, Subscriptions.Num());
+	return subscriptionID;
+}
+
+void FCoverChangeNotifier::UpdateSubscription(int32 SubscriptionID, const FBox& Box)
+{
+	FRWScopeLock SubscriptionLock(SubscriptionLockObject, FRWScopeLockType::SLT_Write);
+	if (FCoverSubscription* subscription = Subscriptions.Find(SubscriptionID))
+	{
+		subscription->Box = Box;
+		subscription->bSphere = false;
+	}
+}
+
+void FCoverChangeNotifier::UpdateSubscription(int32 SubscriptionID, const FSphere& Sphere)
+{
+	FRWScopeLock SubscriptionLock(SubscriptionLockObject, FRWScopeLockType::SLT_Write);
+	if (FCoverSubscription* subscription = Subscriptions.Find(SubscriptionID))
+	{
+		subscription->Sphere = Sphere;
+		subscription->Box = FBox(Sphere.Center - FVector(Sphere.W), Sphere.Center + FVector(Sphere.W));
+		subscription->bSphere = true;
+	}
+}
+
+void FCoverChangeNotifier::Unsubscribe(int32 SubscriptionID)
+{
+	FRWScopeLock SubscriptionLock(SubscriptionLockObject, FRWScopeLockType::SLT_Write);
+	Subscriptions.Remove(SubscriptionID);
+	SET_DWORD_STAT(STAT_CoverSubscriptionCount, Subscriptions.Num());
+}
+
+bool FCoverChangeNotifier::HasSubscriptions() const
+{
+	FRWScopeLock SubscriptionLock(SubscriptionLockObject, FRWScopeLockType::SLT_ReadOnly);
+	return Subscriptions.Num() > 0;
+}
+
+void FCoverChangeNotifier::RecordChanges(const TArray<FCoverChange>& Changes)
+{
+	if (Changes.Num() == 0)
+		return;
+
+	FBox changeBounds(ForceInit);
+	for (const FCoverChange& change : Changes)
+		changeBounds += change.Location;
+
+	bool bAnyPending = false;
+	{
+		FRWScopeLock SubscriptionLock(SubscriptionLockObject, FRWScopeLockType::SLT_Write);
+		for (TPair<int32, FCoverSubscription>& subscription : Subscriptions)
+		{
+			// most batches are a single tile or object, far away from most subscribers
+			if (!subscription.Value.Box.Intersect(changeBounds))
+				continue;
+
+			for (const FCoverChange& change : Changes)
+				if (subscription.Value.Contains(change.Location))
+				{
+					subscription.Value.PendingChanges.Add(change);
+					bAnyPending = true;
+				}
+		}
+	}
+
+	if (!bAnyPending || bFlushScheduled.AtomicSet(true))
+		return;
+
+	// timers can only be set on the game thread
+	if (IsInGameThread())
+		ScheduleFlush();
+	else
+	{
+		TWeakPtr<FCoverChangeNotifier, ESPMode::ThreadSafe> weakNotifier = AsShared();
+		AsyncTask(ENamedThreads::GameThread, [weakNotifier]()
+		{
+			if (TSharedPtr<FCoverChangeNotifier, ESPMode::ThreadSafe> notifier = weakNotifier.Pin())
+				notifier->ScheduleFlush();
+		});
+	}
+}
+
+void FCoverChangeNotifier::ScheduleFlush()
+{
+	check(IsInGameThread());
+
+	if (!World.IsValid())
+	{
+		bFlushScheduled = false;
+		return;
+	}
+
+	// wait for the next tick so that everything that changes this frame is delivered together, the timer is dropped if the notifier is gone by then
+	FlushTimerHandle = World->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateSP(AsShared(), &FCoverChangeNotifier::Flush));
+}
+
+void FCoverChangeNotifier::Flush()
+{
+	// changes recorded from here on schedule another flush
+	bFlushScheduled = false;
+	if (UCoverSystem::bShutdown)
+		return;
+
+	// take the pending changes out first so that subscribers may (un)subscribe from their callbacks
+	TArray<TPair<FCoverChangesDelegate, TArray<FCoverChange>>> notifications;
+	{
+		FRWScopeLock SubscriptionLock(SubscriptionLockObject, FRWScopeLockType::SLT_Write);
+		for (TPair<int32, FCoverSubscription>& subscription : Subscriptions)
+			if (subscription.Value.PendingChanges.Num() > 0)
+			{
+				notifications.Emplace(subscription.Value.Delegate, MoveTemp(subscription.Value.PendingChanges));
+				subscription.Value.PendingChanges.Reset();
+			}
+	}
+
+	for (const TPair<FCoverChangesDelegate, TArray<FCoverChange>>& notification : notifications)
+	{
+		INC_DWORD_STAT(STAT_CoverChangeNotificationCount);
+		INC_DWORD_STAT_BY(STAT_CoverChangeDeliveredCount, notification.Value.Num());
+		notification.Key.ExecuteIfBound(notification.Value);
+	}
+}
@@ -0,0 +1,197 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "CoverSystem/CoverClusters.h"
+#include "CoverSystem/CoverSystem.h"
+
+// Union-find root lookup with path halving.
+static int32 FindClusterRoot(TArray<int32>& Parents, int32 CoverPointIdx)
+{
+	while (Parents[CoverPointIdx] != CoverPointIdx)
+	{
+		Parents[CoverPointIdx] = Parents[Parents[CoverPointIdx]];
+		CoverPointIdx = Parents[CoverPointIdx];
+	}
+
+	return CoverPointIdx;
+}
+
+FVector FCoverClusters::CalculateFacing(const AActor* CoverObject, const FVector& CoverLocation)
+{
+	if (!IsValid(CoverObject))
+		return FVector::ZeroVector;
+
+	FVector closestPoint;
+	if (CoverObject->ActorGetDistanceToCollision(CoverLocation, ECollisionChannel::ECC_Camera, closestPoint) <= 0.0f)
+	{
+		// no collision on the channel or the cover point is inside of it
+		FVector boundsExtent;
+		CoverObject->GetActorBounds(true, closestPoint, boundsExtent);
+	}
+
+	return (closestPoint - CoverLocation).GetSafeNormal2D();
+}
+
+void FCoverClusters::MarkDirty(const TWeakObjectPtr<const AActor>& CoverObject)
+{
+	FRWScopeLock ClusterLock(ClusterLockObject, FRWScopeLockType::SLT_Write);
+	DirtyCoverObjects.Add(CoverObject);
+}
+
+bool FCoverClusters::HasDirtyCoverObjects() const
+{
+	FRWScopeLock ClusterLock(ClusterLockObject, FRWScopeLockType::SLT_ReadOnly);
+	return DirtyCoverObjects.Num() > 0;
+}
+
+void FCoverClusters::PopDirtyCoverObjects(TArray<TWeakObjectPtr<const AActor>>& OutCoverObjects)
+{
+	FRWScopeLock ClusterLock(ClusterLockObject, FRWScopeLockType::SLT_Write);
+	OutCoverObjects = DirtyCoverObjects.Array();
+	DirtyCoverObjects.Reset();
+}
+
+void FCoverClusters::RemoveClustersOfObjectUnsafe(const TWeakObjectPtr<const AActor>& CoverObject)
+{
+	TArray<int32> clusterIndices;
+	CoverObjectToClusters.MultiFind(CoverObject, clusterIndices);
+	CoverObjectToClusters.Remove(CoverObject);
+	for (const int32 clusterIdx : clusterIndices)
+		Clusters.RemoveAt(clusterIdx);
+
+	TArray<FVector> coverPointLocations;
+	CoverObjectToCoverPoints.MultiFind(CoverObject, coverPointLocations);
+	CoverObjectToCoverPoints.Remove(CoverObject);
+	for (const FVector& coverPointLocation : coverPointLocations)
+		CoverPointToCluster.Remove(coverPointLocation);
+}
+
+void FCoverClusters::Rebuild(const TWeakObjectPtr<const AActor>& CoverObject, const TArray<FCoverPointOctreeElement>& CoverPoints)
+{
+	// profiling
+	SCOPE_CYCLE_COUNTER(STAT_RebuildCoverClusters);
+
+	check(IsInGameThread());
+
+	// figure out which way each cover point faces before taking the lock
+	const AActor* coverObject = CoverObject.Get();
+	const int32 nCoverPoints = CoverPoints.Num();
+	TArray<FVector> facings;
+	facings.SetNumUninitialized(nCoverPoints);
+	for (int32 iCoverPoint = 0; iCoverPoint < nCoverPoints; iCoverPoint++)
+		facings[iCoverPoint] = CalculateFacing(coverObject, CoverPoints[iCoverPoint].Data->Location);
+
+	// join contiguous cover points that face the same way
+	TArray<int32> parents;
+	parents.SetNumUninitialized(nCoverPoints);
+	for (int32 iCoverPoint = 0; iCoverPoint < nCoverPoints; iCoverPoint++)
+		parents[iCoverPoint] = iCoverPoint;
+
+	// bucket the cover points into cells of LinkDistance so that only neighbouring cells need to be checked, as some cover objects, e.g. landscapes, have lots of cover points
+	auto getCell = [this](const FVector& Location) {
+		return FIntVector(
+			FMath::FloorToInt(Location.X / LinkDistance),
+			FMath::FloorToInt(Location.Y / LinkDistance),
+			FMath::FloorToInt(Location.Z / LinkDistance));
+	};
+	TMultiMap<FIntVector, int32> cells;
+	for (int32 iCoverPoint = 0; iCoverPoint < nCoverPoints; iCoverPoint++)
+		cells.Add(getCell(CoverPoints[iCoverPoint].Data->Location), iCoverPoint);
+
+	const float linkDistanceSquared = FMath::Square(LinkDistance);
+	TArray<int32> neighbours;
+	for (int32 iCoverPoint = 0; iCoverPoint < nCoverPoints; iCoverPoint++)
+	{
+		const FVector coverLocation = CoverPoints[iCoverPoint].Data->Location;
+		const FIntVector cell = getCell(coverLocation);
+		for (int32 z = -1; z <= 1; z++)
+			for (int32 y = -1; y <= 1; y++)
+				for (int32 x = -1; x <= 1; x++)
+				{
+					neighbours.Reset();
+					cells.MultiFind(cell + FIntVector(x, y, z), neighbours);
+					for (const int32 iNeighbour : neighbours)
+						if (iNeighbour > iCoverPoint
+							&& FVector::DistSquared(coverLocation, CoverPoints[iNeighbour].Data->Location) <= linkDistanceSquared
+							&& FVector::DotProduct(facings[iCoverPoint], facings[iNeighbour]) >= MinLinkFacingDot)
+							parents[FindClusterRoot(parents, iCoverPoint)] = FindClusterRoot(parents, iNeighbour);
+				}
+	}
+
+	// aggregate the cover points of each cluster
+	TMap<int32, FCoverCluster> newClusters;
+	TMap<int32, FVector> centroids;
+	for (int32 iCoverPoint = 0; iCoverPoint < nCoverPoints; iCoverPoint++)
+	{
+		const FCoverPointOctreeData& coverPoint = *CoverPoints[iCoverPoint].Data;
+		const int32 root = FindClusterRoot(parents, iCoverPoint);
+		FCoverCluster& cluster = newClusters.FindOrAdd(root);
+		if (cluster.CoverPointCount == 0)
+			cluster.RepresentativeLocation = coverPoint.Location;
+		cluster.CoverObject = CoverObject;
+		cluster.Bounds += coverPoint.Location;
+		cluster.Facing += facings[iCoverPoint];
+		cluster.CoverPointCount++;
+		cluster.bForceField |= coverPoint.bForceField;
+		centroids.FindOrAdd(root, FVector::ZeroVector) += coverPoint.Location;
+	}
+
+	for (TPair<int32, FCoverCluster>& newCluster : newClusters)
+	{
+		newCluster.Value.Facing = newCluster.Value.Facing.GetSafeNormal2D();
+		centroids[newCluster.Key] /= newCluster.Value.CoverPointCount;
+	}
+
+	// the cover point closest to the centroid represents the cluster
+	for (int32 iCoverPoint = 0; iCoverPoint < nCoverPoints; iCoverPoint++)
+	{
+		const int32 root = FindClusterRoot(parents, iCoverPoint);
+		const FVector& centroid = centroids[root];
+		FCoverCluster& cluster = newClusters[root];
+		const FVector coverLocation = CoverPoints[iCoverPoint].Data->Location;
+		if (FVector::DistSquared(coverLocation, centroid) < FVector::DistSquared(cluster.RepresentativeLocation, centroid))
+			cluster.RepresentativeLocation = coverLocation;
+	}
+
+	FRWScopeLock ClusterLock(ClusterLockObject, FRWScopeLockType::SLT_Write);
+
+	RemoveClustersOfObjectUnsafe(CoverObject);
+
+	TMap<int32, int32> rootToClusterIdx;
+	for (TPair<int32, FCoverCluster>& newCluster : newClusters)
+	{
+		const int32 clusterIdx = Clusters.Add(MoveTemp(newCluster.Value));
+		rootToClusterIdx.Add(newCluster.Key, clusterIdx);
+		CoverObjectToClusters.Add(CoverObject, clusterIdx);
+	}
+
+	for (int32 iCoverPoint = 0; iCoverPoint < nCoverPoints; iCoverPoint++)
+	{
+		CoverPointToCluster.Add(CoverPoints[iCoverPoint].Data->Location, rootToClusterIdx[FindClusterRoot(parents, iCoverPoint)]);
+		CoverObjectToCoverPoints.Add(CoverObject, CoverPoints[iCoverPoint].Data->Location);
+	}
+
+	SET_DWORD_STAT(STAT_CoverClusterCount, Clusters.Num());
+}
+
+bool FCoverClusters::FindCluster(FCoverCluster& OutCluster, const FVector& CoverLocation) const
+{
+	FRWScopeLock ClusterLock(ClusterLockObject, FRWScopeLockType::SLT_ReadOnly);
+
+	const int32* clusterIdx = CoverPointToCluster.Find(CoverLocation);
+	if (!clusterIdx)
+		return false;
+
+	OutCluster = Clusters[*clusterIdx];
+	return true;
+}
+
+void FCoverClusters::Reset()
+{
+	FRWScopeLock ClusterLock(ClusterLockObject, FRWScopeLockType::SLT_Write);
+	Clusters.Empty();
+	CoverPointToCluster.Empty();
+	CoverObjectToClusters.Empty();
+	CoverObjectToCoverPoints.Empty();
+	DirtyCoverObjects.Empty();
+	SET_DWORD_STAT(STAT_CoverClusterCount, 0);
+}
@@ -0,0 +1,233 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "CoverSystem/CoverCrowdProcessor.h"
+#include "CoverSystem/CoverSystem.h"
+#include "Components/CapsuleComponent.h"
+#include "Async/ParallelFor.h"
+
+void FCoverCrowdProcessor::Gather(UCoverSystem* CoverSystem, const TArray<FSquadCoverRequest>& Requests, const FSquadCoverQuerySettings& Settings)
+{
+	RequestIndices.Reset(Requests.Num());
+	Characters.Reset(Requests.Num());
+	Enemies.Reset(Requests.Num());
+	Locations.Reset(Requests.Num());
+	EnemyLocations.Reset(Requests.Num());
+	StandingEyeHeights.Reset(Requests.Num());
+	CrouchedEyeHeights.Reset(Requests.Num());
+	CandidateSetIndices.Reset(Requests.Num());
+	CandidateSets.Reset();
+
+	// gather the candidates of each enemy only once
+	const float minAttackRangeSquared = FMath::Square(Settings.MinAttackRange);
+	TMap<const AActor*, int32> enemyCandidateSets;
+	for (int32 iRequest = 0; iRequest < Requests.Num(); iRequest++)
+	{
+		const ACharacter* character = Requests[iRequest].Agent.Get();
+		const AActor* enemy = Requests[iRequest].Enemy.Get();
+		if (!IsValid(character) || !IsValid(enemy))
+			continue;
+
+		const FVector enemyLocation = enemy->GetActorLocation();
+		int32* candidateSetIdx = enemyCandidateSets.Find(enemy);
+		if (!candidateSetIdx)
+		{
+			TArray<FCoverPointOctreeElement> foundCoverPoints;
+			CoverSystem->FindCoverPoints(foundCoverPoints, FBoxCenterAndExtent(enemyLocation, FVector(Settings.AttackRange * 0.5f)).GetBox());
+
+			candidateSetIdx = &enemyCandidateSets.Add(enemy, CandidateSets.Num());
+			TArray<FCoverPointOctreeElement>& candidates = CandidateSets.AddDefaulted_GetRef();
+			for (const FCoverPointOctreeElement& coverPoint : foundCoverPoints)
+				if (!coverPoint.Data->bTaken
+					&& FVector::DistSquared(enemyLocation, coverPoint.Data->Location) >= minAttackRangeSquared)
+					candidates.Add(coverPoint);
+		}
+
+		const float capsuleHalfHeight = character->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+		RequestIndices.Add(iRequest);
+		Characters.Add(character);
+		Enemies.Add(enemy);
+		Locations.Add(character->GetActorLocation());
+		EnemyLocations.Add(enemyLocation);
+		StandingEyeHeights.Add(capsuleHalfHeight + character->BaseEyeHeight);
+		CrouchedEyeHeights.Add(capsuleHalfHeight + character->CrouchedEyeHeight);
+		CandidateSetIndices.Add(*candidateSetIdx);
+	}
+
+	Proposals.Init({ -1.0f, FVector::ZeroVector }, RequestIndices.Num() * ProposalsPerAgent);
+}
+
+void FCoverCrowdProcessor::EvaluateChunk(int32 ChunkIdx, UCoverSystem* CoverSystem, const ANavigationData* NavData, const FSquadCoverQuerySettings& Settings)
+{
+	UWorld* world = CoverSystem->GetWorld();
+	const float maxCoverDistanceSquared = FMath::Square(Settings.MaxCoverPathCost);
+	const int32 firstAgent = ChunkIdx * ChunkSize;
+	const int32 lastAgent = FMath::Min(firstAgent + ChunkSize, RequestIndices.Num());
+
+	int32 sweepCount = 0;
+	TArray<FCoverExposureDeferredEntry>& exposureEntries = ChunkExposureEntries[ChunkIdx];
+	TArray<TPair<float, int32>> rankedCandidates;
+	for (int32 iAgent = firstAgent; iAgent < lastAgent; iAgent++)
+	{
+		const FVector& location = Locations[iAgent];
+		FNavLocation agentNavLocation;
+		NavData->ProjectPoint(location, agentNavLocation, NavData->GetConfig().DefaultQueryExtent);
+
+		// rank the candidates by their straight-line distance, a flood per agent would cost more than the evaluations it saves
+		const TArray<FCoverPointOctreeElement>& candidates = CandidateSets[CandidateSetIndices[iAgent]];
+		rankedCandidates.Reset();
+		for (int32 iCandidate = 0; iCandidate < candidates.Num(); iCandidate++)
+		{
+			const float distanceSquared = FVector::DistSquared(location, candidates[iCandidate].Data->Location);
+			if (distanceSquared <= maxCoverDistanceSquared)
+				rankedCandidates.Add(TPair<float, int32>(distanceSquared, iCandidate));
+		}
+		rankedCandidates.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) {
+			return A.Key < B.Key || (A.Key == B.Key && A.Value < B.Value);
+		});
+
+		// evaluations of earlier batches are served by the exposure cache, the ones of this batch are only added to it once every worker is done
+		int32 nProposals = 0;
+		int32 nEvaluations = 0;
+		for (const TPair<float, int32>& rankedCandidate : rankedCandidates)
+		{
+			if (nProposals == ProposalsPerAgent || nEvaluations == MaxEvaluationsPerAgent)
+				break;
+
+			// only the islands are consulted here as pathfinding isn't safe off the game thread, cover points of unknown reachability are let through
+			const FCoverPointOctreeElement& coverPoint = candidates[rankedCandidate.Value];
+			if (CoverSystem->GetReachability(agentNavLocation.NodeRef, coverPoint.Data->NavPolyRef) == ENavmeshReachability::Unreachable)
+				continue;
+
+			nEvaluations++;
+			if (FCoverPointEvaluator::EvaluateCoverPointAgainstThreats(Settings.EvaluationSettings, coverPoint, Characters[iAgent], StandingEyeHeights[iAgent], Enemies[iAgent], EnemyLocations[iAgent], Settings.Threats, world, sweepCount, nullptr, false, &exposureEntries)
+				|| FCoverPointEvaluator::EvaluateCoverPointAgainstThreats(Settings.EvaluationSettings, coverPoint, Characters[iAgent], CrouchedEyeHeights[iAgent], Enemies[iAgent], EnemyLocations[iAgent], Settings.Threats, world, sweepCount, nullptr, false, &exposureEntries))
+				Proposals[iAgent * ProposalsPerAgent + nProposals++] = { FMath::Sqrt(rankedCandidate.Key), coverPoint.Data->Location };
+		}
+	}
+
+	ChunkSweepCounts[ChunkIdx] = sweepCount;
+}
+
+int32 FCoverCrowdProcessor::Merge(UCoverSystem* CoverSystem, TArray<FSquadCoverAssignment>& OutAssignments)
+{
+	// the cheapest proposal goes first, ties are broken by agent and then by the agent's own preference so that the outcome doesn't depend on the workers
+	TArray<int32> proposalOrder;
+	proposalOrder.Reserve(Proposals.Num());
+	for (int32 iProposal = 0; iProposal < Proposals.Num(); iProposal++)
+		if (Proposals[iProposal].Cost >= 0.0f)
+			proposalOrder.Add(iProposal);
+	proposalOrder.Sort([this](const int32 A, const int32 B) {
+		return Proposals[A].Cost < Proposals[B].Cost || (Proposals[A].Cost == Proposals[B].Cost && A < B);
+	});
+
+	TBitArray<> bAgentAssigned(false, RequestIndices.Num());
+	TSet<FVector> claimedCoverLocations;
+	TArray<int32> assignedAgents;
+	TArray<FVector> assignedCoverLocations;
+	int32 nConflicts = 0;
+	for (const int32 iProposal : proposalOrder)
+	{
+		const int32 iAgent = iProposal / ProposalsPerAgent;
+		if (bAgentAssigned[iAgent])
+			continue;
+
+		const FVector& coverLocation = Proposals[iProposal].CoverLocation;
+		bool bAlreadyClaimed;
+		claimedCoverLocations.Add(coverLocation, &bAlreadyClaimed);
+		if (bAlreadyClaimed)
+		{
+			nConflicts++;
+			continue;
+		}
+
+		bAgentAssigned[iAgent] = true;
+		assignedAgents.Add(iAgent);
+		assignedCoverLocations.Add(coverLocation);
+	}
+
+	// reserve all the chosen cover points at once
+	TArray<bool> bHeld;
+	CoverSystem->HoldCovers(bHeld, assignedCoverLocations);
+
+	int32 nAssigned = 0;
+	for (int32 iAssigned = 0; iAssigned < assignedAgents.Num(); iAssigned++)
+		if (bHeld[iAssigned])
+		{
+			FSquadCoverAssignment& assignment = OutAssignments[RequestIndices[assignedAgents[iAssigned]]];
+			assignment.bFoundCover = true;
+			assignment.CoverLocation = assignedCoverLocations[iAssigned];
+			nAssigned++;
+		}
+
+	INC_DWORD_STAT_BY(STAT_CrowdCoverConflictCount, nConflicts);
+
+	return nAssigned;
+}
+
+int32 FCoverCrowdProcessor::Process(UCoverSystem* CoverSystem, TArray<FSquadCoverAssignment>& OutAssignments, const TArray<FSquadCoverRequest>& Requests, const FSquadCoverQuerySettings& Settings)
+{
+	OutAssignments.Reset();
+	OutAssignments.SetNum(Requests.Num());
+	if (UCoverSystem::bShutdown)
+		return 0;
+
+	// profiling
+	SCOPE_CYCLE_COUNTER(STAT_CrowdCover);
+	const double startTime = FPlatformTime::Seconds();
+
+	check(IsInGameThread());
+
+	const UNavigationSystemV1* navsys = UNavigationSystemV1::GetCurrent(CoverSystem->GetWorld());
+	const ANavigationData* navData = IsValid(navsys) ? navsys->MainNavData : nullptr;
+	if (!IsValid(navData))
+		return 0;
+
+	Gather(CoverSystem, Requests, Settings);
+
+	const int32 nChunks = FMath::DivideAndRoundUp(RequestIndices.Num(), ChunkSize);
+	ChunkSweepCounts.Init(0, nChunks);
+	ChunkExposureEntries.SetNum(nChunks);
+	for (TArray<FCoverExposureDeferredEntry>& exposureEntries : ChunkExposureEntries)
+		exposureEntries.Reset();
+	ParallelFor(nChunks, [this, CoverSystem, navData, &Settings](int32 ChunkIdx) {
+		EvaluateChunk(ChunkIdx, CoverSystem, navData, Settings);
+	});
+
+	const int32 nAssigned = Merge(CoverSystem, OutAssignments);
+
+	// share the evaluations of this batch with later ones
+	FCoverExposureCache& exposureCache = CoverSystem->GetExposureCache();
+	const double now = CoverSystem->GetWorld()->GetTimeSeconds();
+	for (const TArray<FCoverExposureDeferredEntry>& exposureEntries : ChunkExposureEntries)
+		exposureCache.Add(exposureEntries, now);
+
+	// profiling
+	int32 sweepCount = 0;
+	for (const int32 chunkSweepCount : ChunkSweepCounts)
+		sweepCount += chunkSweepCount;
+	INC_DWORD_STAT_BY(STAT_CrowdCoverAgentCount, RequestIndices.Num());
+	INC_DWORD_STAT_BY(STAT_CrowdCoverAssignedCount, nAssigned);
+	INC_DWORD_STAT_BY(STAT_CrowdCoverSweepCount, sweepCount);
+	const float elapsedMs = static_cast<float>((FPlatformTime::Seconds() - startTime) * 1000.0);
+	SET_DWORD_STAT(STAT_CrowdCoverLastBatchSize, RequestIndices.Num());
+	SET_FLOAT_STAT(STAT_CrowdCoverLastBatchTime, elapsedMs);
+	SET_FLOAT_STAT(STAT_CrowdCoverThroughput, elapsedMs > 0.0f ? RequestIndices.Num() / elapsedMs : 0.0f);
+
+	return nAssigned;
+}
+
+void FCoverCrowdProcessor::Reset()
+{
+	RequestIndices.Empty();
+	Characters.Empty();
+	Enemies.Empty();
+	Locations.Empty();
+	EnemyLocations.Empty();
+	StandingEyeHeights.Empty();
+	CrouchedEyeHeights.Empty();
+	CandidateSetIndices.Empty();
+	Proposals.Empty();
+	CandidateSets.Empty();
+	ChunkSweepCounts.Empty();
+	ChunkExposureEntries.Empty();
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "CoverSystem/CoverExposureCache.h"
+#include "CoverSystem/CoverSystem.h"
+
+bool FCoverExposureCache::Find(bool& bOutGoodCover, const FCoverExposureKey& Key, double Now)
+{
+	bool bFound = false;
+	int32 sweepCount = 0;
+	{
+		FRWScopeLock ExposureCacheLock(ExposureCacheLockObject, FRWScopeLockType::SLT_ReadOnly);
+		const FCoverExposureEntry* entry = Entries.Find(Key);
+		if (entry && Now - entry->EvaluationTime <= EntryLifetime)
+		{
+			bOutGoodCover = entry->bGoodCover;
+			sweepCount = entry->SweepCount;
+			bFound = true;
+		}
+	}
+
+	if (bFound)
+	{
+		Hits.Increment();
+		INC_DWORD_STAT_BY(STAT_ExposureCacheSweepsAvoided, sweepCount);
+	}
+	else
+		Misses.Increment();
+
+	UpdateStats();
+	return bFound;
+}
+
+void FCoverExposureCache::Add(const FCoverExposureKey& Key, bool bGoodCover, int32 SweepCount, double Now)
+{
+	FRWScopeLock ExposureCacheLock(ExposureCacheLockObject, FRWScopeLockType::SLT_Write);
+	if (Entries.Num() >= PurgeThreshold)
+		PurgeExpiredEntries(Now);
+
+	Entries.Add(Key, FCoverExposureEntry(bGoodCover, SweepCount, Now));
+	SET_DWORD_STAT(STAT_ExposureCacheEntryCount, Entries.Num());
+}
+
+void FCoverExposureCache::Add(const TArray<FCoverExposureDeferredEntry>& DeferredEntries, double Now)
+{
+	if (DeferredEntries.Num() == 0)
+		return;
+
+	FRWScopeLock ExposureCacheLock(ExposureCacheLockObject, FRWScopeLockType::SLT_Write);
+	for (const FCoverExposureDeferredEntry& deferredEntry : DeferredEntries)
+	{
+		if (Entries.Num() >= PurgeThreshold)
+			PurgeExpiredEntries(Now);
+
+		Entries.Add(deferredEntry.Key, FCoverExposureEntry(deferredEntry.bGoodCover, deferredEntry.SweepCount, Now));
+	}
+	SET_DWORD_STAT(STAT_ExposureCacheEntryCount, Entries.Num());
+}
+
+void FCoverExposureCache::Invalidate(const TArray<FBox>& Areas)
+{
+	if (Areas.Num() == 0)
+		return;
+
+	// most entries are nowhere near any of the areas
+	FBox allAreas(ForceInit);
+	for (const FBox& area : Areas)
+		allAreas += area;
+
+	FRWScopeLock ExposureCacheLock(ExposureCacheLockObject, FRWScopeLockType::SLT_Write);
+	for (TMap<FCoverExposureKey, FCoverExposureEntry>::TIterator itEntry = Entries.CreateIterator(); itEntry; ++itEntry)
+	{
+		if (!allAreas.IsInsideOrOn(itEntry->Key.CoverLocation))
+			continue;
+
+		for (const FBox& area : Areas)
+			if (area.IsInsideOrOn(itEntry->Key.CoverLocation))
+			{
+				itEntry.RemoveCurrent();
+				break;
+			}
+	}
+
+	SET_DWORD_STAT(STAT_ExposureCacheEntryCount, Entries.Num());
+}
+
+void FCoverExposureCache::InvalidateAll()
+{
+	FRWScopeLock ExposureCacheLock(ExposureCacheLockObject, FRWScopeLockType::SLT_Write);
+	Entries.Empty();
+	SET_DWORD_STAT(STAT_ExposureCacheEntryCount, 0);
+}
+
+void FCoverExposureCache::PurgeExpiredEntries(double Now)
+{
+	for (TMap<FCoverExposureKey, FCoverExposureEntry>::TIterator itEntry = Entries.CreateIterator(); itEntry; ++itEntry)
+		if (Now - itEntry->Value.EvaluationTime > EntryLifetime)
+			itEntry.RemoveCurrent();
+
+	// every entry is still fresh: start over rather than grow without bounds
+	if (Entries.Num() >= PurgeThreshold)
+		Entries.Reset();
+}
+
+void FCoverExposureCache::UpdateStats() const
+{
+#if STATS
+	const int64 hits = Hits.GetValue();
+	const int64 lookups = hits + Misses.GetValue();
+	SET_DWORD_STAT(STAT_ExposureCacheHits, hits);
+	SET_FLOAT_STAT(STAT_ExposureCacheHitRate, lookups > 0 ? 100.0 * hits / lookups : 0.0);
+#endif
+}
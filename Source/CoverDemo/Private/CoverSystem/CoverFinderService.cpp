@@ -4,17 +4,28 @@
 #include "GameFramework/Character.h"
 #include "Components/CapsuleComponent.h"
 
-FVector UCoverFinderService::GetPerpendicularVector(const FVector& Vector)
+uint16 UCoverFinderService::GetInstanceMemorySize() const
 {
-	return FVector(Vector.Y, -Vector.X, Vector.Z);
+	return sizeof(FCoverFinderServiceMemory);
+}
+
+void UCoverFinderService::InitializeMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryInit::Type InitType) const
+{
+	new (NodeMemory) FCoverFinderServiceMemory();
+}
+
+void UCoverFinderService::CleanupMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryClear::Type CleanupType) const
+{
+	reinterpret_cast<FCoverFinderServiceMemory*>(NodeMemory)->~FCoverFinderServiceMemory();
 }
 
 const void UCoverFinderService::GetCoverPoints(
 	TArray<FCoverPointOctreeElement>& OutCoverPoints,
+	TArray<FVector>& OutTakenCoverLocations,
 	UWorld* World,
 	const FVector& CharacterLocation,
 	const FVector& EnemyLocation,
-	UCoverFinderVisData& DebugData,
+	UCoverFinderVisData* DebugData,
 	const bool bUnitDebug) const
 {
 	const float minAttackRangeSquared = FMath::Square(MinAttackRange);
@@ -28,6 +39,10 @@ const void UCoverFinderService::GetCoverPoints(
 
 	// filter out cover points that are too close to the enemy based on our min attack range, or already taken; populate a new array with the remaining, valid cover points only
 	for (FCoverPointOctreeElement coverPoint : coverPoints)
+	{
+		if (coverPoint.Data->bTaken)
+			OutTakenCoverLocations.Add(coverPoint.Data->Location);
+
 		if (!coverPoint.Data->bTaken
 			&& FVector::DistSquared(EnemyLocation, coverPoint.Data->Location) >= minAttackRangeSquared)
 		{
@@ -35,141 +50,85 @@ const void UCoverFinderService::GetCoverPoints(
 
 #if DEBUG_RENDERING
 			if (bUnitDebug)
-				DebugData.DebugPoints.Add(FDebugPoint(coverPoint.Data->Location, FColor::Yellow, false));
+				DebugData->AddDebugPoint(FDebugPoint(coverPoint.Data->Location, FColor::Yellow, false));
 #endif
 		}
 #if DEBUG_RENDERING
 		else
 			if (bUnitDebug)
 				if (FVector::DistSquared(EnemyLocation, coverPoint.Data->Location) < minAttackRangeSquared)
-					DebugData.DebugPoints.Add(FDebugPoint(coverPoint.Data->Location, FColor::Black, false));
+					DebugData->AddDebugPoint(FDebugPoint(coverPoint.Data->Location, FColor::Black, false));
 #endif
-
-	// sort cover points by their distance to our unit
-	OutCoverPoints.Sort([CharacterLocation](const FCoverPointOctreeElement cp1, const FCoverPointOctreeElement cp2) {
-		return FVector::DistSquared(CharacterLocation, cp1.Data->Location) < FVector::DistSquared(CharacterLocation, cp2.Data->Location);
-	});
+	}
 }
 
 
 
-const bool UCoverFinderService::CheckHitByLeaning(
-	const FVector& CoverLocation,
-	const ACharacter* OurUnit,
-	const AActor* TargetEnemy,
-	UWorld* World,
-	UCoverFinderVisData& DebugData,
-	bool bUnitDebug) const
+const bool UCoverFinderService::IsCoverPointReachable(
+	const FCoverPointOctreeElement& CoverPoint,
+	const ACharacter* Character,
+	const FVector& CharacterLocation,
+	const NavNodeRef CharacterPolyRef,
+	UWorld* World) const
 {
-	const FVector enemyLocation = TargetEnemy->GetActorLocation();
-
-	FHitResult hit;
-	FCollisionShape sphereColl;
-	sphereColl.SetSphere(5.0f);
-	FCollisionQueryParams collQueryParamsExclCharacter;
-	collQueryParamsExclCharacter.AddIgnoredActor(OurUnit);
-	collQueryParamsExclCharacter.TraceTag = "CoverPointFinder_CheckHitByLeaning";
+	if (UCoverSystem::bShutdown)
+		return false;
 
-	// check leaning left and right
-	for (int directionMultiplier = 1; directionMultiplier > -2; directionMultiplier -= 2)
+	switch (UCoverSystem::GetInstance(World)->GetReachability(CharacterPolyRef, CoverPoint.Data->NavPolyRef))
 	{
-		// calculate our reach for when leaning out of cover
-		const FVector coverEdge = enemyLocation - CoverLocation;
-		const FVector coverEdgeDir = coverEdge.GetUnsafeNormal();
-		FVector2D coverLean2D = FVector2D(GetPerpendicularVector(coverEdgeDir)) * directionMultiplier;
-		coverLean2D *= WeaponLeanOffset;
-		const FVector coverLean = FVector(CoverLocation.X + coverLean2D.X, CoverLocation.Y + coverLean2D.Y, CoverLocation.Z);
-
-		// check if we can hit our target by leaning out of cover
-		World->SweepSingleByChannel(hit, coverLean, enemyLocation, FQuat::Identity, ECollisionChannel::ECC_Camera, sphereColl, collQueryParamsExclCharacter);
-		if (hit.GetActor() == TargetEnemy)
-		{
-#if DEBUG_RENDERING
-			if (bUnitDebug)
-			{
-				DebugData.DebugArrows.Add(FDebugArrow(CoverLocation, coverLean, FColor::Orange, false));
-				DebugData.DebugArrows.Add(FDebugArrow(coverLean, hit.Location, FColor::Orange, false));
-			}
-#endif
-
-			return true;
-		}
-
-#if DEBUG_RENDERING
-		if (bUnitDebug)
-		{
-			DebugData.DebugArrows.Add(FDebugArrow(CoverLocation, coverLean, FColor::Cyan, false));
-			DebugData.DebugArrows.Add(FDebugArrow(coverLean, hit.Location, FColor::Cyan, false));
-		}
-#endif
+	case ENavmeshReachability::Reachable:
+		return true;
+	case ENavmeshReachability::Unreachable:
+		INC_DWORD_STAT(STAT_FindCoverIslandRejectCount);
+		return false;
+	default:
+		break;
 	}
 
-	// can't hit the enemy by leaning out of cover
-	return false;
+	// the islands don't know about one of the polys, e.g. because its tile has just been rebuilt
+	INC_DWORD_STAT(STAT_FindCoverPathfindingCount);
+	const UNavigationSystemV1* navsys = UNavigationSystemV1::GetCurrent(World);
+	const ANavigationData* navdata = navsys->MainNavData;
+	return navsys->TestPathSync(FPathFindingQuery(Character, *navdata, CharacterLocation, CoverPoint.Data->Location));
 }
 
-const bool UCoverFinderService::EvaluateCoverPoint(
-	const FCoverPointOctreeElement coverPoint,
+const bool UCoverFinderService::RevalidateHeldCover(
+	const FVector& HeldCoverLocation,
 	const ACharacter* Character,
-	const float CharEyeHeight,
+	const float CharEyeHeightStanding,
+	const float CharEyeHeightCrouched,
 	const AActor* TargetEnemy,
 	const FVector& EnemyLocation,
+	const TArray<FCoverThreat>& Threats,
 	UWorld* World,
-	UCoverFinderVisData& DebugData,
-	bool bUnitDebug) const
+	UCoverFinderVisData* DebugData,
+	const bool bUnitDebug) const
 {
-	const FVector coverLocation = coverPoint.Data->Location;
-	const FVector coverLocationInEyeHeight = FVector(coverLocation.X, coverLocation.Y, coverLocation.Z - CoverPointGroundOffset + CharEyeHeight);
-
-	FHitResult hit;
-	FCollisionShape sphereColl;
-	sphereColl.SetSphere(5.0f);
-	FCollisionQueryParams collQueryParamsExclCharacter;
-	collQueryParamsExclCharacter.AddIgnoredActor(Character);
-	collQueryParamsExclCharacter.TraceTag = "CoverPointFinder_EvaluateCoverPoint";
-
-	// check if we can hit the enemy straight from the cover point. if we can, then the cover point is no good
-	if (!World->SweepSingleByChannel(hit, coverLocationInEyeHeight, EnemyLocation, FQuat::Identity, ECollisionChannel::ECC_Camera, sphereColl, collQueryParamsExclCharacter))
+	// the enemy may have moved out of our attack range or too close to the cover point
+	const FVector attackRangeExtent = FVector(AttackRange * 0.5f);
+	if (!FBox(EnemyLocation - attackRangeExtent, EnemyLocation + attackRangeExtent).IsInsideOrOn(HeldCoverLocation)
+		|| FVector::DistSquared(EnemyLocation, HeldCoverLocation) < FMath::Square(MinAttackRange))
 		return false;
 
-	// if the cover point is behind a shield then we shouldn't do any leaning checks, however we must be able to hit the enemy directly and through the shield
-	// for this, we will need a second raycast to determine if we're hitting the shield, which has a different collision response than regular objects
-	const AActor* hitActor = hit.GetActor();
-	if (coverPoint.Data->bForceField // cover is a force field (shield)
-		&& hitActor == TargetEnemy) // should be able to hit the enemy directly
-	{
-		collQueryParamsExclCharacter.TraceTag = "CoverPointFinder_HitShieldFromCover";
-		FHitResult shieldHit;
-		bool bHitShield = World->SweepSingleByChannel(shieldHit, coverLocationInEyeHeight, EnemyLocation, FQuat::Identity, ECollisionChannel::ECC_GameTraceChannel2, sphereColl, collQueryParamsExclCharacter);
-		if (bHitShield // we must hit the shield
-			&& shieldHit.Distance <= CoverPointMaxObjectHitDistance) // cover point and cover object must be close to one another
-			return true;
+	// the cover point may have been removed or moved along with its cover object
+	if (UCoverSystem::bShutdown)
+		return false;
+	TArray<FCoverPointOctreeElement> coverPoints;
+	UCoverSystem::GetInstance(World)->FindCoverPoints(coverPoints, FBox(HeldCoverLocation, HeldCoverLocation).ExpandBy(1.0f));
+	const FCoverPointOctreeElement* heldCoverPoint = coverPoints.FindByPredicate([&HeldCoverLocation](const FCoverPointOctreeElement& CoverPoint) {
+		return CoverPoint.Data->Location == HeldCoverLocation;
+	});
+	if (!heldCoverPoint)
+		return false;
 
-#if DEBUG_RENDERING
-		if (bUnitDebug)
-			if (!bHitShield)
-				DebugData.DebugArrows.Add(FDebugArrow(coverLocationInEyeHeight, EnemyLocation, FColor::Red, false));
-			else if (shieldHit.Distance > CoverPointMaxObjectHitDistance)
-				DebugData.DebugArrows.Add(FDebugArrow(coverLocationInEyeHeight, EnemyLocation, FColor::Black, false));
-#endif
-	}
-	// if the cover point is not behind a shield then check if we can hit the enemy by leaning out of cover
-	else if (!coverPoint.Data->bForceField // cover is not a force field (shield)
-		&& hit.Distance <= CoverPointMaxObjectHitDistance // cover point and cover object must be close to one another
-		&& hitActor != TargetEnemy // shouldn't be able to hit the enemy directly
-		&& !hitActor->IsA<APawn>() // can't hide behind other units, for now
-		&& CheckHitByLeaning(coverLocationInEyeHeight, Character, TargetEnemy, World, DebugData, bUnitDebug)) // we should only be able to hit the enemy by leaning out of cover
-		return true;
+	// check from a standing position and if that fails then from a crouched one
+	const FCoverEvaluationSettings evaluationSettings = GetEvaluationSettings();
+	int32 sweepCount = 0;
+	const bool bGoodCover = FCoverPointEvaluator::EvaluateCoverPointAgainstThreats(evaluationSettings, *heldCoverPoint, Character, CharEyeHeightStanding, TargetEnemy, EnemyLocation, Threats, World, sweepCount, DebugData, bUnitDebug)
+		|| FCoverPointEvaluator::EvaluateCoverPointAgainstThreats(evaluationSettings, *heldCoverPoint, Character, CharEyeHeightCrouched, TargetEnemy, EnemyLocation, Threats, World, sweepCount, DebugData, bUnitDebug);
+	INC_DWORD_STAT_BY(STAT_FindCoverSweepCount, sweepCount);
 
-#if DEBUG_RENDERING
-	if (bUnitDebug && !coverPoint.Data->bForceField)
-		if (hitActor == TargetEnemy)
-			DebugData.DebugArrows.Add(FDebugArrow(coverLocationInEyeHeight, EnemyLocation, FColor::Purple, false));
-		else if (hit.Distance > CoverPointMaxObjectHitDistance)
-			DebugData.DebugArrows.Add(FDebugArrow(coverLocationInEyeHeight, EnemyLocation, FColor::Blue, false));
-#endif
-
-	return false;
+	return bGoodCover;
 }
 
 void UCoverFinderService::TickNode(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds)
@@ -187,7 +146,8 @@ void UCoverFinderService::TickNode(UBehaviorTreeComponent& OwnerComp, uint8* Nod
 	const ACharacter* character = Cast<ACharacter>(OwnerComp.GetAIOwner()->GetPawn());
 	const FVector characterLocation = character->GetActorLocation();
 	const FVector enemyLocation = targetEnemy->GetActorLocation();
-	UCoverFinderVisData* debugData = NewObject<UCoverFinderVisData>(this);
+	FCoverFinderServiceMemory& memory = *reinterpret_cast<FCoverFinderServiceMemory*>(NodeMemory);
+	UCoverFinderVisData* debugData = nullptr;
 	const bool bDrawDebug =
 #if DEBUG_RENDERING
 		blackBoardComp->GetValueAsBool(DrawDebug.SelectedKeyName);
@@ -202,68 +162,159 @@ void UCoverFinderService::TickNode(UBehaviorTreeComponent& OwnerComp, uint8* Nod
 #endif
 
 #if DEBUG_RENDERING
-	blackBoardComp->SetValueAsObject(Key_VisData, debugData);
+	// the visualization data is only allocated once a debug flag is set, then reused by every tick
+	if (bDrawDebug || bUnitDebug)
+	{
+		if (!memory.DebugData.IsValid())
+			memory.DebugData.Reset(NewObject<UCoverFinderVisData>(&OwnerComp));
+
+		debugData = memory.DebugData.Get();
+		debugData->Reset();
+		blackBoardComp->SetValueAsObject(Key_VisData, debugData);
+	}
 
 	// draw an arrow from our character to the enemy, in red, if the generic debug flag is set
 	if (bDrawDebug)
-		debugData->DebugArrows.Add(FDebugArrow(characterLocation, enemyLocation, FColor::Red, true));
+		debugData->AddDebugArrow(FDebugArrow(characterLocation, enemyLocation, FColor::Red, true));
 #endif
 
-	// release the former cover point, if any
+	// calculate the character's standing and crouched eye height offsets
+	const float capsuleHalfHeight = character->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	const float charEyeHeightStanding = capsuleHalfHeight + character->BaseEyeHeight;
+	const float charEyeHeightCrouched = capsuleHalfHeight + character->CrouchedEyeHeight;
+
+	// the other enemies around our unit that it has to stay hidden from
+	TArray<FCoverThreat> threats;
+	FCoverPointEvaluator::GatherThreats(threats, world, ThreatClass, characterLocation, ThreatRadius, targetEnemy, MaxThreats);
+
+	// follow the area that our cover points come from with our subscription
+	if (bSubscribeToCoverChanges && !UCoverSystem::bShutdown)
+	{
+		const FBox coverScanArea = FBoxCenterAndExtent(enemyLocation, FVector(AttackRange * 0.5f)).GetBox();
+		FCoverChangeNotifier& changeNotifier = UCoverSystem::GetInstance(world)->GetChangeNotifier();
+		if (memory.CoverSubscriptionID == INDEX_NONE)
+		{
+			memory.World = world;
+			memory.CoverSubscriptionID = changeNotifier.Subscribe(coverScanArea, FCoverChangesDelegate::CreateLambda(
+				[bWeakCoverChanged = TWeakPtr<bool>(memory.bCoverChanged)](const TArray<FCoverChange>& Changes)
+				{
+					// cover being taken or released doesn't make the held one any worse, we do most of that ourselves
+					const TSharedPtr<bool> bCoverChanged = bWeakCoverChanged.Pin();
+					if (bCoverChanged.IsValid())
+						for (const FCoverChange& change : Changes)
+							if (change.Type == ECoverChangeType::Added || change.Type == ECoverChangeType::Removed)
+								*bCoverChanged = true;
+				}));
+		}
+		else
+			changeNotifier.UpdateSubscription(memory.CoverSubscriptionID, coverScanArea);
+	}
+
+	const double now = world->GetTimeSeconds();
 	if (blackBoardComp->IsVectorValueSet(OutputVector.SelectedKeyName))
 	{
 		FVector formerCover = blackBoardComp->GetValueAsVector(OutputVector.SelectedKeyName);
 
+		// keep the cover point we're holding for as long as it's adequate, until it's time to look for a better one or cover around the enemy has changed
+		if (now < memory.NextFullSearchTime
+			&& !*memory.bCoverChanged
+			&& memory.TargetEnemy == targetEnemy
+			&& RevalidateHeldCover(formerCover, character, charEyeHeightStanding, charEyeHeightCrouched, targetEnemy, enemyLocation, threats, world, debugData, bUnitDebug))
+		{
+			INC_DWORD_STAT(STAT_FindCoverRevalidationCount);
+
+#if DEBUG_RENDERING
+			if (bUnitDebug)
+				debugData->AddDebugArrow(FDebugArrow(formerCover, enemyLocation, FColor::Green, false));
+#endif
+
+			return;
+		}
+
+		// release the former cover point
 		if (UCoverSystem::bShutdown)
 			return;
 		UCoverSystem::GetInstance(world)->ReleaseCover(formerCover);
 	}
+	memory.TargetEnemy = targetEnemy;
+	memory.NextFullSearchTime = now + FullSearchInterval;
+	*memory.bCoverChanged = false;
 
 	// get the cover points
 	TArray<FCoverPointOctreeElement> coverPoints;
-	GetCoverPoints(coverPoints, world, characterLocation, enemyLocation, *debugData, bUnitDebug);
+	TArray<FVector> takenCoverLocations;
+	GetCoverPoints(coverPoints, takenCoverLocations, world, characterLocation, enemyLocation, debugData, bUnitDebug);
 
-	// get navigation data
+	// find the navmesh poly our unit is on
 	const UNavigationSystemV1* navsys = UNavigationSystemV1::GetCurrent(world);
 	const ANavigationData* navdata = navsys->MainNavData;
+	FNavLocation characterNavLocation;
+	navdata->ProjectPoint(characterLocation, characterNavLocation, navdata->GetConfig().DefaultQueryExtent);
 
-	// calculate the character's standing and crouched eye height offsets
-	const float capsuleHalfHeight = character->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
-	const float charEyeHeightStanding = capsuleHalfHeight + character->BaseEyeHeight;
-	const float charEyeHeightCrouched = capsuleHalfHeight + character->CrouchedEyeHeight;
+	// find out how far our unit has to walk to get to the cover points, with a single navmesh flood instead of pathfinding to each of them
+	TArray<float> coverPointPathCosts;
+	if (UCoverSystem::bShutdown)
+		return;
+	UCoverSystem::GetInstance(world)->RankCoverPointsByPathCost(coverPoints, coverPointPathCosts, characterLocation, characterNavLocation.NodeRef, MaxCoverPathCost, false);
+
+	// rank them and only keep the best ones for evaluation
+	FCoverPointScorer::SelectBest(coverPoints, coverPointPathCosts, takenCoverLocations, characterLocation, enemyLocation, MaxCoverPathCost, ScoringSettings, MaxScoredCandidates);
 
 	// find the first adequate cover point
-	for (const FCoverPointOctreeElement coverPoint : coverPoints)
+	const FCoverEvaluationSettings evaluationSettings = GetEvaluationSettings();
+	TMap<FVector, bool> clusterOutcomes;
+	for (int32 iCoverPoint = 0; iCoverPoint < coverPoints.Num(); iCoverPoint++)
 	{
+		const FCoverPointOctreeElement coverPoint = coverPoints[iCoverPoint];
 		const FVector coverLocation = coverPoint.Data->Location;
-		
+
+		// skip the whole cluster of the cover point if it doesn't provide cover from the enemy even when crouching
+		int32 sweepCount = 0;
+		const bool bClusterPassed = FCoverPointEvaluator::CheckCluster(evaluationSettings, coverPoint, character, charEyeHeightCrouched, targetEnemy, enemyLocation, world, clusterOutcomes, sweepCount);
+		INC_DWORD_STAT_BY(STAT_FindCoverSweepCount, sweepCount);
+		if (!bClusterPassed)
+		{
+			INC_DWORD_STAT(STAT_FindCoverClusterRejectCount);
+
+#if DEBUG_RENDERING
+			if (bUnitDebug)
+				debugData->AddDebugPoint(FDebugPoint(coverPoint.Data->Location, FColor::Blue, false));
+#endif
+
+			continue;
+		}
+
 		// our unit must be able to reach the cover point
-		// TODO: this is a relatively expensive operation, consider implementing an async query instead?
-		if (!navsys->TestPathSync(FPathFindingQuery(character, *navdata, characterLocation, coverLocation)))
+		// the navmesh flood has already proven that for the ones it knows the path cost of, the rest need to be checked via the islands or pathfinding
+		if (coverPointPathCosts[iCoverPoint] == UCoverSystem::UnknownPathCost
+			&& !IsCoverPointReachable(coverPoint, character, characterLocation, characterNavLocation.NodeRef, world))
 		{
 #if DEBUG_RENDERING
 			if (bUnitDebug)
-				debugData->DebugPoints.Add(FDebugPoint(coverPoint.Data->Location, FColor::Red, false));
+				debugData->AddDebugPoint(FDebugPoint(coverPoint.Data->Location, FColor::Red, false));
 #endif
 
 			continue;
 		}
 
 		// check from a standing position and if that fails then from a crouched one
-		bool bFoundCover = EvaluateCoverPoint(coverPoint, character, charEyeHeightStanding, targetEnemy, enemyLocation, world, *debugData, bUnitDebug)
-			|| EvaluateCoverPoint(coverPoint, character, charEyeHeightCrouched, targetEnemy, enemyLocation, world, *debugData, bUnitDebug);
+		sweepCount = 0;
+		bool bFoundCover = FCoverPointEvaluator::EvaluateCoverPointAgainstThreats(evaluationSettings, coverPoint, character, charEyeHeightStanding, targetEnemy, enemyLocation, threats, world, sweepCount, debugData, bUnitDebug)
+			|| FCoverPointEvaluator::EvaluateCoverPointAgainstThreats(evaluationSettings, coverPoint, character, charEyeHeightCrouched, targetEnemy, enemyLocation, threats, world, sweepCount, debugData, bUnitDebug);
+		INC_DWORD_STAT_BY(STAT_FindCoverSweepCount, sweepCount);
 
 		if (bFoundCover)
 		{
-			// mark the cover point as taken
+			// mark the cover point as taken, unless someone else has beaten us to it
 			if (UCoverSystem::bShutdown)
 				return;
-			UCoverSystem::GetInstance(world)->HoldCover(coverLocation);
+			if (!UCoverSystem::GetInstance(world)->HoldCover(coverLocation))
+				continue;
 
 			// draw an arrow from the cover point to the enemy, in green (success), if the unit debug flag is set
 #if DEBUG_RENDERING
 			if (bUnitDebug)
-				debugData->DebugArrows.Add(FDebugArrow(coverLocation, enemyLocation, FColor::Green, false));
+				debugData->AddDebugArrow(FDebugArrow(coverLocation, enemyLocation, FColor::Green, false));
 #endif
 
 			// set the cover location in the BB
@@ -275,7 +326,7 @@ void UCoverFinderService::TickNode(UBehaviorTreeComponent& OwnerComp, uint8* Nod
 	// draw a red marker above units that can't find any cover
 #if DEBUG_RENDERING
 	if (bDrawDebug)
-		debugData->DebugPoints.Add(FDebugPoint(characterLocation + FVector(0.0f, 0.0f, 200.0f), FColor::Red, true));
+		debugData->AddDebugPoint(FDebugPoint(characterLocation + FVector(0.0f, 0.0f, 200.0f), FColor::Red, true));
 #endif
 
 	// no cover found: unset the cover location in the BB
@@ -0,0 +1,160 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "CoverSystem/CoverOcclusionGrid.h"
+#include "CoverSystem/CoverSystem.h"
+
+void FCoverOcclusionGrid::VoxelizeArea(TBitArray<>& OutSolid, UWorld* World, const FIntVector& MinVoxel, const FIntVector& MaxVoxel) const
+{
+	const FIntVector voxelCounts = MaxVoxel - MinVoxel + FIntVector(1, 1, 1);
+	OutSolid.Init(false, voxelCounts.X * voxelCounts.Y * voxelCounts.Z);
+
+	// anything that can move is left out, it's checked for by the evaluator instead
+	FCollisionQueryParams collQueryParams;
+	collQueryParams.TraceTag = "CoverOcclusionGrid_Voxelize";
+	collQueryParams.MobilityType = EQueryMobilityType::Static;
+
+	// voxels are dilated by the radius of the sight sweeps so that lines of sight that merely graze geometry cross a solid voxel, too
+	const float halfVoxelSize = VoxelSize * 0.5f;
+	const float dilation = FCoverPointEvaluator::SightSweepRadius;
+	const FCollisionShape voxelShape = FCollisionShape::MakeBox(FVector(halfVoxelSize + dilation));
+
+	for (int32 y = 0; y < voxelCounts.Y; y++)
+		for (int32 x = 0; x < voxelCounts.X; x++)
+			for (int32 columnStart = 0; columnStart < voxelCounts.Z; columnStart += MaxColumnHeight)
+			{
+				// skip empty columns with a single overlap test, most of the air above the navmesh is empty
+				const int32 columnHeight = FMath::Min(MaxColumnHeight, voxelCounts.Z - columnStart);
+				const FVector columnMin = FVector(MinVoxel.X + x, MinVoxel.Y + y, MinVoxel.Z + columnStart) * VoxelSize;
+				const FVector columnExtent = FVector(halfVoxelSize, halfVoxelSize, columnHeight * halfVoxelSize);
+				if (!World->OverlapBlockingTestByChannel(columnMin + columnExtent, FQuat::Identity, ECollisionChannel::ECC_Camera, FCollisionShape::MakeBox(columnExtent + FVector(dilation)), collQueryParams))
+					continue;
+
+				for (int32 z = columnStart; z < columnStart + columnHeight; z++)
+				{
+					const FVector voxelCenter = FVector(MinVoxel.X + x, MinVoxel.Y + y, MinVoxel.Z + z) * VoxelSize + FVector(halfVoxelSize);
+					if (World->OverlapBlockingTestByChannel(voxelCenter, FQuat::Identity, ECollisionChannel::ECC_Camera, voxelShape, collQueryParams))
+						OutSolid[x + voxelCounts.X * (y + voxelCounts.Y * z)] = true;
+				}
+			}
+}
+
+void FCoverOcclusionGrid::Voxelize(UWorld* World, const TArray<FBox>& Areas)
+{
+	// profiling
+	SCOPE_CYCLE_COUNTER(STAT_VoxelizeOcclusionGrid);
+
+	if (!IsValid(World))
+		return;
+
+	for (const FBox& area : Areas)
+	{
+		// query the physics scene without holding the lock
+		const FIntVector minVoxel = GetVoxel(area.Min);
+		const FIntVector maxVoxel = GetVoxel(area.Max);
+		const FIntVector voxelCounts = maxVoxel - minVoxel + FIntVector(1, 1, 1);
+		TBitArray<> solid;
+		VoxelizeArea(solid, World, minVoxel, maxVoxel);
+
+		FRWScopeLock OcclusionGridLock(OcclusionGridLockObject, FRWScopeLockType::SLT_Write);
+
+		FIntVector chunkCoords = FIntVector(MAX_int32);
+		FOcclusionChunk* chunk = nullptr;
+		for (int32 z = 0; z < voxelCounts.Z; z++)
+			for (int32 y = 0; y < voxelCounts.Y; y++)
+				for (int32 x = 0; x < voxelCounts.X; x++)
+				{
+					const FIntVector voxel = minVoxel + FIntVector(x, y, z);
+					const FIntVector voxelChunkCoords = GetChunk(voxel);
+					if (voxelChunkCoords != chunkCoords)
+					{
+						chunkCoords = voxelChunkCoords;
+						chunk = &Chunks.FindOrAdd(chunkCoords);
+					}
+
+					chunk->SetVoxel(FOcclusionChunk::GetVoxelIdx(voxel), solid[x + voxelCounts.X * (y + voxelCounts.Y * z)]);
+				}
+
+		SET_DWORD_STAT(STAT_OcclusionGridChunkCount, Chunks.Num());
+	}
+}
+
+EOcclusionGridResult FCoverOcclusionGrid::TraceLineOfSight(const FVector& Start, const FVector& End, float& OutBlockDistance) const
+{
+	INC_DWORD_STAT(STAT_OcclusionGridTraceCount);
+
+	// 3D DDA: step from voxel to voxel along the line, always crossing the closest voxel boundary next
+	const FVector line = End - Start;
+	const float lineLength = line.Size();
+	const FVector lineDir = lineLength > KINDA_SMALL_NUMBER ? line / lineLength : FVector::ZeroVector;
+
+	FIntVector voxel = GetVoxel(Start);
+	const FIntVector endVoxel = GetVoxel(End);
+	int32 steps[3];
+	float nextBoundaryDistances[3];
+	float boundaryDistanceSteps[3];
+	for (int32 axis = 0; axis < 3; axis++)
+	{
+		if (FMath::IsNearlyZero(lineDir[axis]))
+		{
+			steps[axis] = 0;
+			nextBoundaryDistances[axis] = BIG_NUMBER;
+			boundaryDistanceSteps[axis] = BIG_NUMBER;
+			continue;
+		}
+
+		steps[axis] = lineDir[axis] > 0.0f ? 1 : -1;
+		const float nextBoundary = (voxel[axis] + (steps[axis] > 0 ? 1 : 0)) * VoxelSize;
+		nextBoundaryDistances[axis] = (nextBoundary - Start[axis]) / lineDir[axis];
+		boundaryDistanceSteps[axis] = VoxelSize / FMath::Abs(lineDir[axis]);
+	}
+
+	FRWScopeLock OcclusionGridLock(OcclusionGridLockObject, FRWScopeLockType::SLT_ReadOnly);
+
+	FIntVector chunkCoords = FIntVector(MAX_int32);
+	const FOcclusionChunk* chunk = nullptr;
+	float distance = 0.0f;
+	while (true)
+	{
+		// neighbouring voxels are usually in the same chunk, only look it up when leaving it
+		const FIntVector voxelChunkCoords = GetChunk(voxel);
+		if (voxelChunkCoords != chunkCoords)
+		{
+			chunkCoords = voxelChunkCoords;
+			chunk = Chunks.Find(chunkCoords);
+		}
+
+		const int32 voxelIdx = FOcclusionChunk::GetVoxelIdx(voxel);
+		if (!chunk || !chunk->IsKnown(voxelIdx))
+			return EOcclusionGridResult::Unknown;
+
+		if (chunk->IsSolid(voxelIdx))
+		{
+			OutBlockDistance = distance;
+			return EOcclusionGridResult::Blocked;
+		}
+
+		if (voxel == endVoxel)
+			break;
+
+		// cross into the next voxel
+		int32 axis = nextBoundaryDistances[0] < nextBoundaryDistances[1] ? 0 : 1;
+		if (nextBoundaryDistances[2] < nextBoundaryDistances[axis])
+			axis = 2;
+
+		distance = nextBoundaryDistances[axis];
+		if (distance > lineLength)
+			break;
+
+		voxel[axis] += steps[axis];
+		nextBoundaryDistances[axis] += boundaryDistanceSteps[axis];
+	}
+
+	return EOcclusionGridResult::Clear;
+}
+
+void FCoverOcclusionGrid::Reset()
+{
+	FRWScopeLock OcclusionGridLock(OcclusionGridLockObject, FRWScopeLockType::SLT_Write);
+	Chunks.Empty();
+	SET_DWORD_STAT(STAT_OcclusionGridChunkCount, 0);
+}
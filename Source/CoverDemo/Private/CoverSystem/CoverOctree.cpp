@@ -38,9 +38,25 @@ bool TCoverOctree::AnyCoverPointsWithinBounds(const FBoxCenterAndExtent& QueryBo
 	return result;
 }
 
-void TCoverOctree::FindCoverPoints(TArray<FCoverPointOctreeElement>& OutCoverPoints, const FBox& QueryBox) const
+int32 TCoverOctree::FindCoverPoints(TArray<FCoverPointOctreeElement>& OutCoverPoints, const FBox& QueryBox) const
 {
-	FindElementsWithBoundsTest(QueryBox, [&OutCoverPoints](const FCoverPointOctreeElement& CoverPoint) { OutCoverPoints.Add(CoverPoint); });
+	// same as FindElementsWithBoundsTest() but walks the nodes itself so that they can be counted
+	const FBoxCenterAndExtent queryBounds(QueryBox);
+	int32 nVisitedNodes = 0;
+	FindNodesWithPredicate(
+		[&queryBounds](auto ParentNodeIndex, auto NodeIndex, const FBoxCenterAndExtent& NodeBounds)
+		{
+			return Intersect(NodeBounds, queryBounds);
+		},
+		[this, &OutCoverPoints, &queryBounds, &nVisitedNodes](auto ParentNodeIndex, auto NodeIndex, const FBoxCenterAndExtent& NodeBounds)
+		{
+			nVisitedNodes++;
+			for (const FCoverPointOctreeElement& coverPoint : GetElementsForNode(NodeIndex))
+				if (Intersect(FBoxCenterAndExtent(coverPoint.Bounds), queryBounds))
+					OutCoverPoints.Add(coverPoint);
+		});
+
+	return nVisitedNodes;
 }
 
 void TCoverOctree::FindCoverPoints(TArray<FCoverPointOctreeElement>& OutCoverPoints, const FSphere& QuerySphere) const
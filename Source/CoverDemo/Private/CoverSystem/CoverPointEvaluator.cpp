@@ -0,0 +1,443 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "CoverSystem/CoverPointEvaluator.h"
+#include "CoverSystem/CoverSystem.h"
+#include "GameFramework/Character.h"
+#include "EngineUtils.h"
+
+FVector FCoverPointEvaluator::GetPerpendicularVector(const FVector& Vector)
+{
+	return FVector(Vector.Y, -Vector.X, Vector.Z);
+}
+
+bool FCoverPointEvaluator::CheckHitByLeaning(
+	const FCoverEvaluationSettings& Settings,
+	const FVector& CoverLocation,
+	const ACharacter* OurUnit,
+	const AActor* TargetEnemy,
+	UWorld* World,
+	int32& SweepCount,
+	UCoverFinderVisData* DebugData,
+	const bool bUnitDebug)
+{
+	const FVector enemyLocation = TargetEnemy->GetActorLocation();
+
+	FHitResult hit;
+	FCollisionShape sphereColl;
+	sphereColl.SetSphere(SightSweepRadius);
+	FCollisionQueryParams collQueryParamsExclCharacter;
+	collQueryParamsExclCharacter.AddIgnoredActor(OurUnit);
+	collQueryParamsExclCharacter.TraceTag = "CoverPointFinder_CheckHitByLeaning";
+
+	// check leaning left and right
+	for (int directionMultiplier = 1; directionMultiplier > -2; directionMultiplier -= 2)
+	{
+		// calculate our reach for when leaning out of cover
+		const FVector coverEdge = enemyLocation - CoverLocation;
+		const FVector coverEdgeDir = coverEdge.GetUnsafeNormal();
+		FVector2D coverLean2D = FVector2D(GetPerpendicularVector(coverEdgeDir)) * directionMultiplier;
+		coverLean2D *= Settings.WeaponLeanOffset;
+		const FVector coverLean = FVector(CoverLocation.X + coverLean2D.X, CoverLocation.Y + coverLean2D.Y, CoverLocation.Z);
+
+		// check if we can hit our target by leaning out of cover
+		SweepCount++;
+		World->SweepSingleByChannel(hit, coverLean, enemyLocation, FQuat::Identity, ECollisionChannel::ECC_Camera, sphereColl, collQueryParamsExclCharacter);
+		if (hit.GetActor() == TargetEnemy)
+		{
+#if DEBUG_RENDERING
+			if (bUnitDebug)
+			{
+				DebugData->AddDebugArrow(FDebugArrow(CoverLocation, coverLean, FColor::Orange, false));
+				DebugData->AddDebugArrow(FDebugArrow(coverLean, hit.Location, FColor::Orange, false));
+			}
+#endif
+
+			return true;
+		}
+
+#if DEBUG_RENDERING
+		if (bUnitDebug)
+		{
+			DebugData->AddDebugArrow(FDebugArrow(CoverLocation, coverLean, FColor::Cyan, false));
+			DebugData->AddDebugArrow(FDebugArrow(coverLean, hit.Location, FColor::Cyan, false));
+		}
+#endif
+	}
+
+	// can't hit the enemy by leaning out of cover
+	return false;
+}
+
+bool FCoverPointEvaluator::EvaluateCoverPoint(
+	const FCoverEvaluationSettings& Settings,
+	const FCoverPointOctreeElement& CoverPoint,
+	const ACharacter* Character,
+	const float CharEyeHeight,
+	const AActor* TargetEnemy,
+	const FVector& EnemyLocation,
+	UWorld* World,
+	int32& SweepCount,
+	UCoverFinderVisData* DebugData,
+	const bool bUnitDebug)
+{
+	const FVector coverLocation = CoverPoint.Data->Location;
+	const FVector coverLocationInEyeHeight = FVector(coverLocation.X, coverLocation.Y, coverLocation.Z - Settings.CoverPointGroundOffset + CharEyeHeight);
+
+	FHitResult hit;
+	FCollisionShape sphereColl;
+	sphereColl.SetSphere(SightSweepRadius);
+	FCollisionQueryParams collQueryParamsExclCharacter;
+	collQueryParamsExclCharacter.AddIgnoredActor(Character);
+	collQueryParamsExclCharacter.TraceTag = "CoverPointFinder_EvaluateCoverPoint";
+
+	// reject the cover point without sweeping if nothing is close enough to hide behind: the occlusion grid shows that no static geometry is, and nothing dynamic overlaps
+	// the stretch of the line of sight within reach. the grid can only underestimate the distance of the first static hit, unknown voxels fall through to the sweeps
+	// other units are dynamic as well, so a unit standing close by makes the sweep happen even though it couldn't be hidden behind anyway
+	// force fields are skipped as they're not voxelized by the grid, debugged units are skipped so that their debug arrows are drawn
+	if (Settings.bUseOcclusionGrid && !CoverPoint.Data->bForceField && !bUnitDebug && !UCoverSystem::bShutdown)
+	{
+		float blockDistance;
+		const EOcclusionGridResult occlusion = UCoverSystem::GetInstance(World)->GetOcclusionGrid().TraceLineOfSight(coverLocationInEyeHeight, EnemyLocation, blockDistance);
+		if (occlusion == EOcclusionGridResult::Clear
+			|| (occlusion == EOcclusionGridResult::Blocked && blockDistance > Settings.CoverPointMaxObjectHitDistance))
+		{
+			const FVector sightDir = (EnemyLocation - coverLocationInEyeHeight).GetSafeNormal();
+			const float reach = Settings.CoverPointMaxObjectHitDistance;
+			FCollisionQueryParams collQueryParamsDynamic(collQueryParamsExclCharacter);
+			collQueryParamsDynamic.TraceTag = "CoverPointFinder_EvaluateCoverPointDynamic";
+			collQueryParamsDynamic.MobilityType = EQueryMobilityType::Dynamic;
+			if (!sightDir.IsZero()
+				&& !World->OverlapBlockingTestByChannel(coverLocationInEyeHeight + sightDir * (reach * 0.5f), FRotationMatrix::MakeFromZ(sightDir).ToQuat(), ECollisionChannel::ECC_Camera,
+					FCollisionShape::MakeCapsule(SightSweepRadius, reach * 0.5f + SightSweepRadius), collQueryParamsDynamic))
+			{
+				INC_DWORD_STAT(STAT_FindCoverOcclusionGridRejectCount);
+				return false;
+			}
+		}
+	}
+
+	// check if we can hit the enemy straight from the cover point. if we can, then the cover point is no good
+	SweepCount++;
+	if (!World->SweepSingleByChannel(hit, coverLocationInEyeHeight, EnemyLocation, FQuat::Identity, ECollisionChannel::ECC_Camera, sphereColl, collQueryParamsExclCharacter))
+		return false;
+
+	// if the cover point is behind a shield then we shouldn't do any leaning checks, however we must be able to hit the enemy directly and through the shield
+	// for this, we will need a second raycast to determine if we're hitting the shield, which has a different collision response than regular objects
+	const AActor* hitActor = hit.GetActor();
+	if (CoverPoint.Data->bForceField // cover is a force field (shield)
+		&& hitActor == TargetEnemy) // should be able to hit the enemy directly
+	{
+		collQueryParamsExclCharacter.TraceTag = "CoverPointFinder_HitShieldFromCover";
+		FHitResult shieldHit;
+		SweepCount++;
+		bool bHitShield = World->SweepSingleByChannel(shieldHit, coverLocationInEyeHeight, EnemyLocation, FQuat::Identity, ECollisionChannel::ECC_GameTraceChannel2, sphereColl, collQueryParamsExclCharacter);
+		if (bHitShield // we must hit the shield
+			&& shieldHit.Distance <= Settings.CoverPointMaxObjectHitDistance) // cover point and cover object must be close to one another
+			return true;
+
+#if DEBUG_RENDERING
+		if (bUnitDebug)
+			if (!bHitShield)
+				DebugData->AddDebugArrow(FDebugArrow(coverLocationInEyeHeight, EnemyLocation, FColor::Red, false));
+			else if (shieldHit.Distance > Settings.CoverPointMaxObjectHitDistance)
+				DebugData->AddDebugArrow(FDebugArrow(coverLocationInEyeHeight, EnemyLocation, FColor::Black, false));
+#endif
+	}
+	// if the cover point is not behind a shield then check if we can hit the enemy by leaning out of cover
+	else if (!CoverPoint.Data->bForceField // cover is not a force field (shield)
+		&& hit.Distance <= Settings.CoverPointMaxObjectHitDistance // cover point and cover object must be close to one another
+		&& hitActor != TargetEnemy // shouldn't be able to hit the enemy directly
+		&& !hitActor->IsA<APawn>() // can't hide behind other units, for now
+		&& CheckHitByLeaning(Settings, coverLocationInEyeHeight, Character, TargetEnemy, World, SweepCount, DebugData, bUnitDebug)) // we should only be able to hit the enemy by leaning out of cover
+		return true;
+
+#if DEBUG_RENDERING
+	if (bUnitDebug && !CoverPoint.Data->bForceField)
+		if (hitActor == TargetEnemy)
+			DebugData->AddDebugArrow(FDebugArrow(coverLocationInEyeHeight, EnemyLocation, FColor::Purple, false));
+		else if (hit.Distance > Settings.CoverPointMaxObjectHitDistance)
+			DebugData->AddDebugArrow(FDebugArrow(coverLocationInEyeHeight, EnemyLocation, FColor::Blue, false));
+#endif
+
+	return false;
+}
+
+bool FCoverPointEvaluator::EvaluateCoverPointCached(
+	const FCoverEvaluationSettings& Settings,
+	const FCoverPointOctreeElement& CoverPoint,
+	const ACharacter* Character,
+	const float CharEyeHeight,
+	const AActor* TargetEnemy,
+	const FVector& EnemyLocation,
+	UWorld* World,
+	int32& SweepCount,
+	UCoverFinderVisData* DebugData,
+	const bool bUnitDebug,
+	TArray<FCoverExposureDeferredEntry>* DeferredExposureEntries)
+{
+	if (bUnitDebug || UCoverSystem::bShutdown)
+		return EvaluateCoverPoint(Settings, CoverPoint, Character, CharEyeHeight, TargetEnemy, EnemyLocation, World, SweepCount, DebugData, bUnitDebug);
+
+	// searches are repeated every so often, e.g. by services and EQS tests, so chances are our unit has evaluated this cover point against the enemy already
+	FCoverExposureCache& exposureCache = UCoverSystem::GetInstance(World)->GetExposureCache();
+	const FCoverExposureKey exposureKey(CoverPoint.Data->Location, Character, TargetEnemy, EnemyLocation, CharEyeHeight, Settings.GetHash());
+	bool bGoodCover;
+	if (exposureCache.Find(bGoodCover, exposureKey, World->GetTimeSeconds()))
+		return bGoodCover;
+
+	int32 sweepCount = 0;
+	bGoodCover = EvaluateCoverPoint(Settings, CoverPoint, Character, CharEyeHeight, TargetEnemy, EnemyLocation, World, sweepCount, DebugData, bUnitDebug);
+	if (DeferredExposureEntries)
+		DeferredExposureEntries->Add(FCoverExposureDeferredEntry(exposureKey, bGoodCover, sweepCount));
+	else
+		exposureCache.Add(exposureKey, bGoodCover, sweepCount, World->GetTimeSeconds());
+	SweepCount += sweepCount;
+	return bGoodCover;
+}
+
+bool FCoverPointEvaluator::IsHiddenFrom(
+	const FVector& EyeLocation,
+	const AActor* Threat,
+	const FVector& ThreatLocation,
+	const ACharacter* Character,
+	UWorld* World,
+	int32& SweepCount,
+	float& OutBlockDistance)
+{
+	FHitResult hit;
+	FCollisionShape sphereColl;
+	sphereColl.SetSphere(SightSweepRadius);
+	FCollisionQueryParams collQueryParamsExclCharacter;
+	collQueryParamsExclCharacter.AddIgnoredActor(Character);
+	collQueryParamsExclCharacter.TraceTag = "CoverPointFinder_IsHiddenFromThreat";
+
+	SweepCount++;
+	if (!World->SweepSingleByChannel(hit, EyeLocation, ThreatLocation, FQuat::Identity, ECollisionChannel::ECC_Camera, sphereColl, collQueryParamsExclCharacter))
+		return false;
+
+	// other units don't count as cover, same as in EvaluateCoverPoint()
+	const AActor* hitActor = hit.GetActor();
+	if (hitActor == Threat || (IsValid(hitActor) && hitActor->IsA<APawn>()))
+		return false;
+
+	OutBlockDistance = hit.Distance;
+	return true;
+}
+
+bool FCoverPointEvaluator::EvaluateCoverPointAgainstThreats(
+	const FCoverEvaluationSettings& Settings,
+	const FCoverPointOctreeElement& CoverPoint,
+	const ACharacter* Character,
+	const float CharEyeHeight,
+	const AActor* TargetEnemy,
+	const FVector& EnemyLocation,
+	const TArray<FCoverThreat>& Threats,
+	UWorld* World,
+	int32& SweepCount,
+	UCoverFinderVisData* DebugData,
+	const bool bUnitDebug,
+	TArray<FCoverExposureDeferredEntry>* DeferredExposureEntries)
+{
+	// the enemy we're fighting comes first: it's the one the cover point is most likely to fail against
+	return EvaluateCoverPointCached(Settings, CoverPoint, Character, CharEyeHeight, TargetEnemy, EnemyLocation, World, SweepCount, DebugData, bUnitDebug, DeferredExposureEntries)
+		&& IsHiddenFromThreats(Settings, CoverPoint, Character, CharEyeHeight, TargetEnemy, Threats, World, SweepCount, DebugData, bUnitDebug, DeferredExposureEntries);
+}
+
+bool FCoverPointEvaluator::IsHiddenFromThreats(
+	const FCoverEvaluationSettings& Settings,
+	const FCoverPointOctreeElement& CoverPoint,
+	const ACharacter* Character,
+	const float CharEyeHeight,
+	const AActor* IgnoredThreat,
+	const TArray<FCoverThreat>& Threats,
+	UWorld* World,
+	int32& SweepCount,
+	UCoverFinderVisData* DebugData,
+	const bool bUnitDebug,
+	TArray<FCoverExposureDeferredEntry>* DeferredExposureEntries)
+{
+	if (Threats.Num() == 0 || UCoverSystem::bShutdown)
+		return true;
+
+	const FVector coverLocation = CoverPoint.Data->Location;
+	const FVector coverLocationInEyeHeight = FVector(coverLocation.X, coverLocation.Y, coverLocation.Z - Settings.CoverPointGroundOffset + CharEyeHeight);
+
+	// closest threats first
+	struct FThreatToCheck
+	{
+		const AActor* Actor;
+		FVector Location;
+		FVector Direction;
+		float Distance;
+	};
+	TArray<FThreatToCheck, TInlineAllocator<16>> threatsToCheck;
+	for (const FCoverThreat& threat : Threats)
+	{
+		const AActor* threatActor = threat.Actor.Get();
+		if (!IsValid(threatActor) || threatActor == IgnoredThreat)
+			continue;
+
+		const FVector toThreat = threat.Location - coverLocationInEyeHeight;
+		threatsToCheck.Add({ threatActor, threat.Location, toThreat.GetSafeNormal(), static_cast<float>(toThreat.Size()) });
+	}
+	threatsToCheck.Sort([](const FThreatToCheck& A, const FThreatToCheck& B) {
+		return A.Distance < B.Distance;
+	});
+
+	// directions in which the line of sight has been found to be blocked and how far away
+	struct FBlockedSightLine
+	{
+		FVector Direction;
+		float BlockDistance;
+	};
+	TArray<FBlockedSightLine, TInlineAllocator<16>> blockedSightLines;
+
+	FCoverExposureCache& exposureCache = UCoverSystem::GetInstance(World)->GetExposureCache();
+	const uint32 protectionHash = HashCombine(Settings.GetHash(), ProtectionHashSalt);
+	for (const FThreatToCheck& threat : threatsToCheck)
+	{
+		// a threat right behind a blocked sight line towards a closer one is blocked by the same cover, as long as both lines of sight pass through the spot where it was blocked
+		// i.e. they're no further apart than the sweep radius at the block distance, otherwise they may well pass either side of a thin cover object
+		bool bSharesSweep = false;
+		for (const FBlockedSightLine& blockedSightLine : blockedSightLines)
+		{
+			const float cosAngle = FVector::DotProduct(threat.Direction, blockedSightLine.Direction);
+			if (threat.Distance > blockedSightLine.BlockDistance
+				&& cosAngle > 0.0f
+				&& FMath::Square(blockedSightLine.BlockDistance) * (1.0f - FMath::Square(cosAngle)) <= FMath::Square(SightSweepRadius))
+			{
+				bSharesSweep = true;
+				break;
+			}
+		}
+
+		if (bSharesSweep)
+		{
+			INC_DWORD_STAT(STAT_FindCoverSharedThreatSweepCount);
+			continue;
+		}
+
+		// our unit may have checked this threat from here already during a previous search
+		const FCoverExposureKey exposureKey(coverLocation, Character, threat.Actor, threat.Location, CharEyeHeight, protectionHash);
+		bool bHidden;
+		if (!bUnitDebug && exposureCache.Find(bHidden, exposureKey, World->GetTimeSeconds()))
+		{
+			if (bHidden)
+				continue;
+
+			INC_DWORD_STAT(STAT_FindCoverThreatRejectCount);
+			return false;
+		}
+
+		int32 sweepCount = 0;
+		float blockDistance = 0.0f;
+		bHidden = IsHiddenFrom(coverLocationInEyeHeight, threat.Actor, threat.Location, Character, World, sweepCount, blockDistance);
+		if (DeferredExposureEntries)
+			DeferredExposureEntries->Add(FCoverExposureDeferredEntry(exposureKey, bHidden, sweepCount));
+		else
+			exposureCache.Add(exposureKey, bHidden, sweepCount, World->GetTimeSeconds());
+		SweepCount += sweepCount;
+
+		if (!bHidden)
+		{
+#if DEBUG_RENDERING
+			if (bUnitDebug)
+				DebugData->AddDebugArrow(FDebugArrow(coverLocationInEyeHeight, threat.Location, FColor::Magenta, false));
+#endif
+
+			INC_DWORD_STAT(STAT_FindCoverThreatRejectCount);
+			return false;
+		}
+
+		blockedSightLines.Add({ threat.Direction, blockDistance });
+	}
+
+	return true;
+}
+
+bool FCoverPointEvaluator::CheckCluster(
+	const FCoverEvaluationSettings& Settings,
+	const FCoverPointOctreeElement& CoverPoint,
+	const ACharacter* Character,
+	const float CharEyeHeight,
+	const AActor* TargetEnemy,
+	const FVector& EnemyLocation,
+	UWorld* World,
+	TMap<FVector, bool>& ClusterOutcomes,
+	int32& SweepCount)
+{
+	// the clusters are rebuilt here if they're dirty, which mustn't race the cover point evaluations of worker threads
+	check(IsInGameThread());
+
+	if (UCoverSystem::bShutdown)
+		return true;
+
+	FCoverCluster cluster;
+	if (!UCoverSystem::GetInstance(World)->FindCoverCluster(cluster, CoverPoint.Data->Location) || cluster.CoverPointCount < MinPrunedClusterSize)
+		return true;
+
+	if (const bool* bClusterOutcome = ClusterOutcomes.Find(cluster.RepresentativeLocation))
+		return *bClusterOutcome;
+
+	// the cover object must be between the cluster and the enemy
+	bool bClusterOutcome = cluster.Facing.IsZero()
+		|| FVector::DotProduct(cluster.Facing, (EnemyLocation - cluster.RepresentativeLocation).GetSafeNormal2D()) >= MinClusterFacingDot;
+
+	// and block the line of sight to the enemy, except for force fields which are supposed to be seen through
+	if (bClusterOutcome && !cluster.bForceField)
+	{
+		const FVector representativeLocationInEyeHeight = FVector(cluster.RepresentativeLocation.X, cluster.RepresentativeLocation.Y, cluster.RepresentativeLocation.Z - Settings.CoverPointGroundOffset + CharEyeHeight);
+
+		FHitResult hit;
+		FCollisionShape sphereColl;
+		sphereColl.SetSphere(SightSweepRadius);
+		FCollisionQueryParams collQueryParamsExclCharacter;
+		collQueryParamsExclCharacter.AddIgnoredActor(Character);
+		collQueryParamsExclCharacter.TraceTag = "CoverPointFinder_CheckCluster";
+
+		SweepCount++;
+		bClusterOutcome = World->SweepSingleByChannel(hit, representativeLocationInEyeHeight, EnemyLocation, FQuat::Identity, ECollisionChannel::ECC_Camera, sphereColl, collQueryParamsExclCharacter)
+			&& hit.GetActor() != TargetEnemy;
+	}
+
+	ClusterOutcomes.Add(cluster.RepresentativeLocation, bClusterOutcome);
+	return bClusterOutcome;
+}
+
+void FCoverPointEvaluator::GatherThreats(
+	TArray<FCoverThreat>& OutThreats,
+	UWorld* World,
+	TSubclassOf<AActor> ThreatClass,
+	const FVector& Center,
+	float Radius,
+	const AActor* TargetEnemy,
+	int32 MaxThreats)
+{
+	OutThreats.Reset();
+	if (!ThreatClass || MaxThreats <= 0)
+		return;
+
+	const float radiusSquared = FMath::Square(Radius);
+	for (TActorIterator<AActor> itActor(World, ThreatClass); itActor; ++itActor)
+	{
+		const AActor* threatActor = *itActor;
+		if (threatActor != TargetEnemy && FVector::DistSquared(Center, threatActor->GetActorLocation()) <= radiusSquared)
+			OutThreats.Add(FCoverThreat(threatActor, threatActor->GetActorLocation()));
+	}
+
+	// only keep the closest ones
+	OutThreats.Sort([&Center](const FCoverThreat& A, const FCoverThreat& B) {
+		return FVector::DistSquared(Center, A.Location) < FVector::DistSquared(Center, B.Location);
+	});
+	if (OutThreats.Num() > MaxThreats)
+		OutThreats.SetNum(MaxThreats);
+}
+
+void FCoverPointEvaluator::UpdateThreats(TArray<FCoverThreat>& Threats)
+{
+	for (int32 iThreat = Threats.Num() - 1; iThreat >= 0; iThreat--)
+		if (const AActor* threatActor = Threats[iThreat].Actor.Get())
+			Threats[iThreat].Location = threatActor->GetActorLocation();
+		else
+			Threats.RemoveAtSwap(iThreat);
+}
@@ -0,0 +1,183 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "CoverSystem/CoverPointScorer.h"
+#include "CoverSystem/CoverSystem.h"
+
+FCoverPointScorer::FAlignedFloatArray FCoverPointScorer::LocationsX;
+FCoverPointScorer::FAlignedFloatArray FCoverPointScorer::LocationsY;
+FCoverPointScorer::FAlignedFloatArray FCoverPointScorer::LocationsZ;
+FCoverPointScorer::FAlignedFloatArray FCoverPointScorer::TravelCosts;
+FCoverPointScorer::FAlignedFloatArray FCoverPointScorer::Utilities;
+
+void FCoverPointScorer::PackCandidates(const TArray<FCoverPointOctreeElement>& CoverPoints, const TArray<float>& PathCosts, const FVector& CharacterLocation)
+{
+	// pad with copies of the last candidate so that the last batch is scored on valid data
+	const int32 numPackedCandidates = Align(CoverPoints.Num(), LaneCount);
+	LocationsX.SetNumUninitialized(numPackedCandidates, false);
+	LocationsY.SetNumUninitialized(numPackedCandidates, false);
+	LocationsZ.SetNumUninitialized(numPackedCandidates, false);
+	TravelCosts.SetNumUninitialized(numPackedCandidates, false);
+	Utilities.SetNumUninitialized(numPackedCandidates, false);
+
+	for (int32 iCandidate = 0; iCandidate < numPackedCandidates; iCandidate++)
+	{
+		const int32 iCoverPoint = FMath::Min(iCandidate, CoverPoints.Num() - 1);
+		const FVector coverLocation = CoverPoints[iCoverPoint].Data->Location;
+		LocationsX[iCandidate] = coverLocation.X;
+		LocationsY[iCandidate] = coverLocation.Y;
+		LocationsZ[iCandidate] = coverLocation.Z;
+		TravelCosts[iCandidate] = PathCosts[iCoverPoint] != UCoverSystem::UnknownPathCost
+			? PathCosts[iCoverPoint]
+			: FVector::Dist(CharacterLocation, coverLocation);
+	}
+}
+
+void FCoverPointScorer::ScoreCandidates(
+	int32 NumPackedCandidates,
+	const TArray<FVector>& TakenCoverLocations,
+	const FVector& CharacterLocation,
+	const FVector& EnemyLocation,
+	float MaxPathCost,
+	const FCoverScoringSettings& Settings)
+{
+	const FVector toEnemyDir = (EnemyLocation - CharacterLocation).GetSafeNormal();
+
+	const VectorRegister4Float zero = GlobalVectorConstants::FloatZero;
+	const VectorRegister4Float one = GlobalVectorConstants::FloatOne;
+	const VectorRegister4Float half = VectorSetFloat1(0.5f);
+	const VectorRegister4Float minDistance = VectorSetFloat1(1.0f);
+
+	const VectorRegister4Float characterX = VectorSetFloat1(CharacterLocation.X);
+	const VectorRegister4Float characterY = VectorSetFloat1(CharacterLocation.Y);
+	const VectorRegister4Float characterZ = VectorSetFloat1(CharacterLocation.Z);
+	const VectorRegister4Float enemyX = VectorSetFloat1(EnemyLocation.X);
+	const VectorRegister4Float enemyY = VectorSetFloat1(EnemyLocation.Y);
+	const VectorRegister4Float enemyZ = VectorSetFloat1(EnemyLocation.Z);
+	const VectorRegister4Float toEnemyDirX = VectorSetFloat1(toEnemyDir.X);
+	const VectorRegister4Float toEnemyDirY = VectorSetFloat1(toEnemyDir.Y);
+	const VectorRegister4Float toEnemyDirZ = VectorSetFloat1(toEnemyDir.Z);
+
+	const VectorRegister4Float invMaxPathCost = VectorSetFloat1(1.0f / FMath::Max(MaxPathCost, 1.0f));
+	const VectorRegister4Float preferredEnemyDistance = VectorSetFloat1(Settings.PreferredEnemyDistance);
+	const VectorRegister4Float invPreferredEnemyDistance = VectorSetFloat1(1.0f / FMath::Max(Settings.PreferredEnemyDistance, 1.0f));
+	const VectorRegister4Float invHeightScale = VectorSetFloat1(1.0f / FMath::Max(Settings.HeightScale, 1.0f));
+	const VectorRegister4Float crowdingRadiusSquared = VectorSetFloat1(FMath::Square(Settings.CrowdingRadius));
+
+	const VectorRegister4Float pathCostWeight = VectorSetFloat1(Settings.PathCostWeight);
+	const VectorRegister4Float enemyDistanceWeight = VectorSetFloat1(Settings.EnemyDistanceWeight);
+	const VectorRegister4Float enemyAngleWeight = VectorSetFloat1(Settings.EnemyAngleWeight);
+	const VectorRegister4Float heightWeight = VectorSetFloat1(Settings.HeightWeight);
+	const VectorRegister4Float crowdingWeight = VectorSetFloat1(Settings.CrowdingWeight);
+	const bool bScoreCrowding = Settings.CrowdingWeight != 0.0f && TakenCoverLocations.Num() > 0;
+
+	for (int32 iCandidate = 0; iCandidate < NumPackedCandidates; iCandidate += LaneCount)
+	{
+		const VectorRegister4Float x = VectorLoadAligned(&LocationsX[iCandidate]);
+		const VectorRegister4Float y = VectorLoadAligned(&LocationsY[iCandidate]);
+		const VectorRegister4Float z = VectorLoadAligned(&LocationsZ[iCandidate]);
+
+		// how far we have to walk
+		VectorRegister4Float utility = VectorMultiply(VectorMultiply(VectorLoadAligned(&TravelCosts[iCandidate]), invMaxPathCost), pathCostWeight);
+
+		// how far the cover point is from where we'd like to fight from
+		const VectorRegister4Float fromEnemyX = VectorSubtract(x, enemyX);
+		const VectorRegister4Float fromEnemyY = VectorSubtract(y, enemyY);
+		const VectorRegister4Float fromEnemyZ = VectorSubtract(z, enemyZ);
+		const VectorRegister4Float enemyDistance = VectorSqrt(VectorMultiplyAdd(fromEnemyX, fromEnemyX, VectorMultiplyAdd(fromEnemyY, fromEnemyY, VectorMultiply(fromEnemyZ, fromEnemyZ))));
+		const VectorRegister4Float enemyDistanceTerm = VectorMultiply(VectorAbs(VectorSubtract(enemyDistance, preferredEnemyDistance)), invPreferredEnemyDistance);
+		utility = VectorMultiplyAdd(enemyDistanceTerm, enemyDistanceWeight, utility);
+
+		// whether we have to move towards the enemy: 1 straight at them, 0 straight away from them
+		const VectorRegister4Float fromCharacterX = VectorSubtract(x, characterX);
+		const VectorRegister4Float fromCharacterY = VectorSubtract(y, characterY);
+		const VectorRegister4Float fromCharacterZ = VectorSubtract(z, characterZ);
+		const VectorRegister4Float characterDistance = VectorMax(
+			VectorSqrt(VectorMultiplyAdd(fromCharacterX, fromCharacterX, VectorMultiplyAdd(fromCharacterY, fromCharacterY, VectorMultiply(fromCharacterZ, fromCharacterZ)))),
+			minDistance);
+		const VectorRegister4Float towardsEnemy = VectorMultiplyAdd(fromCharacterX, toEnemyDirX, VectorMultiplyAdd(fromCharacterY, toEnemyDirY, VectorMultiply(fromCharacterZ, toEnemyDirZ)));
+		const VectorRegister4Float enemyAngleTerm = VectorMultiply(VectorAdd(VectorDivide(towardsEnemy, characterDistance), one), half);
+		utility = VectorMultiplyAdd(enemyAngleTerm, enemyAngleWeight, utility);
+
+		// high ground: 0 well above the enemy, 1 well below them
+		const VectorRegister4Float relativeHeight = VectorMin(VectorMax(VectorMultiply(fromEnemyZ, invHeightScale), VectorNegate(one)), one);
+		const VectorRegister4Float heightTerm = VectorMultiply(VectorSubtract(one, relativeHeight), half);
+		utility = VectorMultiplyAdd(heightTerm, heightWeight, utility);
+
+		// number of taken cover points nearby
+		if (bScoreCrowding)
+		{
+			VectorRegister4Float crowding = zero;
+			for (const FVector& takenCoverLocation : TakenCoverLocations)
+			{
+				const VectorRegister4Float fromTakenX = VectorSubtract(x, VectorSetFloat1(takenCoverLocation.X));
+				const VectorRegister4Float fromTakenY = VectorSubtract(y, VectorSetFloat1(takenCoverLocation.Y));
+				const VectorRegister4Float fromTakenZ = VectorSubtract(z, VectorSetFloat1(takenCoverLocation.Z));
+				const VectorRegister4Float takenDistanceSquared = VectorMultiplyAdd(fromTakenX, fromTakenX, VectorMultiplyAdd(fromTakenY, fromTakenY, VectorMultiply(fromTakenZ, fromTakenZ)));
+				crowding = VectorAdd(crowding, VectorBitwiseAnd(VectorCompareLT(takenDistanceSquared, crowdingRadiusSquared), one));
+			}
+			utility = VectorMultiplyAdd(crowding, crowdingWeight, utility);
+		}
+
+		VectorStoreAligned(utility, &Utilities[iCandidate]);
+	}
+}
+
+void FCoverPointScorer::SelectBest(
+	TArray<FCoverPointOctreeElement>& CoverPoints,
+	TArray<float>& PathCosts,
+	const TArray<FVector>& TakenCoverLocations,
+	const FVector& CharacterLocation,
+	const FVector& EnemyLocation,
+	float MaxPathCost,
+	const FCoverScoringSettings& Settings,
+	int32 MaxCandidates)
+{
+	// profiling
+	SCOPE_CYCLE_COUNTER(STAT_CoverScoring);
+	INC_DWORD_STAT_BY(STAT_CoverScoringCandidateCount, CoverPoints.Num());
+
+	check(IsInGameThread());
+	if (CoverPoints.Num() == 0)
+		return;
+
+	PackCandidates(CoverPoints, PathCosts, CharacterLocation);
+	ScoreCandidates(LocationsX.Num(), TakenCoverLocations, CharacterLocation, EnemyLocation, MaxPathCost, Settings);
+
+	// keep the best ones in a max-heap so that the worst of them is the one to be replaced, then only sort those
+	typedef TPair<float, int32> FScoredCandidate;
+	auto isWorse = [](const FScoredCandidate& A, const FScoredCandidate& B) {
+		return A.Key > B.Key;
+	};
+
+	const int32 numKept = FMath::Clamp(MaxCandidates, 1, CoverPoints.Num());
+	TArray<FScoredCandidate> bestCandidates;
+	bestCandidates.Reserve(numKept + 1);
+	for (int32 iCoverPoint = 0; iCoverPoint < CoverPoints.Num(); iCoverPoint++)
+	{
+		const float utility = Utilities[iCoverPoint];
+		if (bestCandidates.Num() < numKept)
+			bestCandidates.HeapPush(FScoredCandidate(utility, iCoverPoint), isWorse);
+		else if (utility < bestCandidates.HeapTop().Key)
+		{
+			bestCandidates.HeapPopDiscard(isWorse, false);
+			bestCandidates.HeapPush(FScoredCandidate(utility, iCoverPoint), isWorse);
+		}
+	}
+
+	bestCandidates.Sort([](const FScoredCandidate& A, const FScoredCandidate& B) {
+		return A.Key < B.Key;
+	});
+
+	TArray<FCoverPointOctreeElement> bestCoverPoints;
+	TArray<float> bestPathCosts;
+	bestCoverPoints.Reserve(numKept);
+	bestPathCosts.Reserve(numKept);
+	for (const FScoredCandidate& bestCandidate : bestCandidates)
+	{
+		bestCoverPoints.Add(CoverPoints[bestCandidate.Value]);
+		bestPathCosts.Add(PathCosts[bestCandidate.Value]);
+	}
+
+	CoverPoints = MoveTemp(bestCoverPoints);
+	PathCosts = MoveTemp(bestPathCosts);
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "CoverSystem/CoverQueryCache.h"
+#include "CoverSystem/CoverSystem.h"
+
+bool FCoverQueryCache::Find(TArray<FCoverPointOctreeElement>& OutCoverPoints, const FCoverQueryKey& Key, const FBox& QueryBox, uint64 Version)
+{
+	// nothing to find in a cache of another frame or version, or in an empty one
+	if (!IsCurrent(Version) || EntryCount.load(std::memory_order_relaxed) == 0)
+		return false;
+
+	{
+		FRWScopeLock QueryCacheLock(QueryCacheLockObject, FRWScopeLockType::SLT_ReadOnly);
+		if (!IsCurrent(Version))
+			return false;
+
+		const TArray<FCoverPointOctreeElement>* entry = Entries.Find(Key);
+		if (!entry)
+			return false;
+
+		FilterByBox(OutCoverPoints, *entry, QueryBox);
+	}
+
+	Hits.Increment();
+	INC_DWORD_STAT(STAT_CoverQueryCacheHits);
+	UpdateStats();
+	return true;
+}
+
+void FCoverQueryCache::Add(const FCoverQueryKey& Key, uint64 Version, const TArray<FCoverPointOctreeElement>& CoverPoints)
+{
+	// a full cache of the current frame and version has no room left, there's no need to lock it
+	if (!IsCurrent(Version) || EntryCount.load(std::memory_order_relaxed) < MaxEntries)
+	{
+		FRWScopeLock QueryCacheLock(QueryCacheLockObject, FRWScopeLockType::SLT_Write);
+		if (!IsCurrent(Version))
+		{
+			if (FrameNumber.load(std::memory_order_relaxed) != GFrameCounter)
+			{
+				Hits.Reset();
+				Misses.Reset();
+			}
+
+			FrameNumber.store(GFrameCounter, std::memory_order_relaxed);
+			CoverDataVersion.store(Version, std::memory_order_relaxed);
+			Entries.Reset();
+		}
+
+		if (Entries.Num() < MaxEntries)
+			Entries.Add(Key, CoverPoints);
+		EntryCount.store(Entries.Num(), std::memory_order_relaxed);
+	}
+
+	// every miss is followed by an Add(), so this is where they're counted
+	Misses.Increment();
+	UpdateStats();
+}
+
+void FCoverQueryCache::FilterByBox(TArray<FCoverPointOctreeElement>& OutCoverPoints, const TArray<FCoverPointOctreeElement>& CoverPoints, const FBox& QueryBox)
+{
+	const FBoxCenterAndExtent queryBounds(QueryBox);
+	for (const FCoverPointOctreeElement& coverPoint : CoverPoints)
+		if (Intersect(FBoxCenterAndExtent(coverPoint.Bounds), queryBounds))
+			OutCoverPoints.Add(coverPoint);
+}
+
+void FCoverQueryCache::UpdateStats() const
+{
+#if STATS
+	const int32 hits = Hits.GetValue();
+	const int32 lookups = hits + Misses.GetValue();
+	SET_FLOAT_STAT(STAT_CoverQueryCacheHitRate, lookups > 0 ? 100.0 * hits / lookups : 0.0);
+#endif
+}
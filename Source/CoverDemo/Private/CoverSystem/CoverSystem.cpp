@@ -2,6 +2,9 @@
 
 #include "CoverSystem/CoverSystem.h"
 #include "Tasks/NavmeshCoverPointGeneratorTask.h"
+#include "Detour/DetourNavMesh.h"
+#include "Components/CapsuleComponent.h"
+#include "Async/Async.h"
 
 #if DEBUG_RENDERING
 #include "DrawDebugHelpers.h"
@@ -11,6 +14,15 @@
 DEFINE_STAT(STAT_GenerateCover);
 DEFINE_STAT(STAT_GenerateCoverInBounds);
 DEFINE_STAT(STAT_FindCover);
+DEFINE_STAT(STAT_MoveCover);
+DEFINE_STAT(STAT_TileGenerationPrioritize);
+DEFINE_STAT(STAT_RebuildNavmeshIslands);
+DEFINE_STAT(STAT_RebuildCoverClusters);
+DEFINE_STAT(STAT_VoxelizeOcclusionGrid);
+DEFINE_STAT(STAT_NavmeshDistanceFlood);
+DEFINE_STAT(STAT_SquadCover);
+DEFINE_STAT(STAT_CrowdCover);
+DEFINE_STAT(STAT_CoverScoring);
 
 UCoverSystem* UCoverSystem::MyInstance;
 bool UCoverSystem::bShutdown;
@@ -29,11 +41,30 @@ UCoverSystem::~UCoverSystem()
 		CoverOctree = nullptr;
 	}
 
+	TileDispatcher.Reset();
+	GenerationScheduler.Reset();
+	ChangeNotifier.Reset();
 	ElementToID.Empty();
 	CoverObjectToID.Empty();
+	MovableCoverObjects.Empty();
+	MeshCoverTemplates.Empty();
 	MyInstance = nullptr;
 }
 
+void UCoverSystem::BeginDestroy()
+{
+	if (Navmesh.IsValid())
+	{
+		Navmesh->NavmeshRebuildAllDelegate.Remove(NavMeshRebuildAllHandle);
+
+		// only unbind the navmesh's buffer interval if it's still ours, a newer instance may have bound its own dispatcher since
+		if (TileDispatcher.IsValid() && Navmesh->TileBufferIntervalDelegate.IsBoundToObject(TileDispatcher.Get()))
+			Navmesh->TileBufferIntervalDelegate.Unbind();
+	}
+
+	Super::BeginDestroy();
+}
+
 UCoverSystem* UCoverSystem::GetInstance(UWorld* World)
 {
 	if (bShutdown)
@@ -51,7 +82,48 @@ UCoverSystem* UCoverSystem::GetInstance(UWorld* World)
 		SET_FLOAT_STAT(STAT_GenerateCoverAverageTime, 0.0f);
 		SET_DWORD_STAT(STAT_FindCoverHistoricalCount, 0);
 		SET_FLOAT_STAT(STAT_FindCoverTotalTimeSpent, 0.0f);
+		SET_DWORD_STAT(STAT_FindCoverLatentTickCount, 0);
+		SET_DWORD_STAT(STAT_FindCoverIslandRejectCount, 0);
+		SET_DWORD_STAT(STAT_FindCoverPathfindingCount, 0);
+		SET_DWORD_STAT(STAT_FindCoverPathCostRejectCount, 0);
+		SET_DWORD_STAT(STAT_FindCoverRevalidationCount, 0);
+		SET_DWORD_STAT(STAT_FindCoverSweepCount, 0);
+		SET_DWORD_STAT(STAT_FindCoverThreatRejectCount, 0);
+		SET_DWORD_STAT(STAT_FindCoverSharedThreatSweepCount, 0);
+		SET_DWORD_STAT(STAT_FindCoverClusterRejectCount, 0);
+		SET_DWORD_STAT(STAT_FindCoverOcclusionGridRejectCount, 0);
+		SET_DWORD_STAT(STAT_OcclusionGridTraceCount, 0);
+		SET_DWORD_STAT(STAT_SquadCoverAssignedCount, 0);
+		SET_DWORD_STAT(STAT_CoverScoringCandidateCount, 0);
+		SET_DWORD_STAT(STAT_SquadCoverSweepCount, 0);
+		SET_DWORD_STAT(STAT_CrowdCoverAgentCount, 0);
+		SET_DWORD_STAT(STAT_CrowdCoverAssignedCount, 0);
+		SET_DWORD_STAT(STAT_CrowdCoverSweepCount, 0);
+		SET_DWORD_STAT(STAT_CrowdCoverConflictCount, 0);
+		SET_DWORD_STAT(STAT_CrowdCoverLastBatchSize, 0);
+		SET_FLOAT_STAT(STAT_CrowdCoverLastBatchTime, 0.0f);
+		SET_FLOAT_STAT(STAT_CrowdCoverThroughput, 0.0f);
+		SET_DWORD_STAT(STAT_NavmeshDistanceFloodPolyCount, 0);
+		SET_DWORD_STAT(STAT_ExposureCacheHits, 0);
+		SET_FLOAT_STAT(STAT_ExposureCacheHitRate, 0.0f);
+		SET_DWORD_STAT(STAT_ExposureCacheSweepsAvoided, 0);
+		SET_DWORD_STAT(STAT_ExposureCacheEntryCount, 0);
 		SET_DWORD_STAT(STAT_TaskCount, 0);
+		SET_DWORD_STAT(STAT_GenerateCoverSkippedEdgeCount, 0);
+		SET_DWORD_STAT(STAT_TileGenerationTasksInFlight, 0);
+		SET_FLOAT_STAT(STAT_TileGenerationAverageTaskCost, 0.0f);
+		SET_FLOAT_STAT(STAT_TileGenerationAverageLatency, 0.0f);
+		SET_FLOAT_STAT(STAT_TileGenerationMaxLatency, 0.0f);
+		SET_DWORD_STAT(STAT_TileGenerationWokenCount, 0);
+		SET_DWORD_STAT(STAT_ActorGenerationRequestCount, 0);
+		SET_DWORD_STAT(STAT_ActorGenerationDuplicateCount, 0);
+		SET_DWORD_STAT(STAT_ActorGenerationMergedCount, 0);
+		SET_DWORD_STAT(STAT_MoveCoverHistoricalCount, 0);
+		SET_DWORD_STAT(STAT_MoveCoverRegenerationCount, 0);
+		SET_DWORD_STAT(STAT_MeshCoverTemplateHits, 0);
+		SET_DWORD_STAT(STAT_MeshCoverTemplateMisses, 0);
+		SET_DWORD_STAT(STAT_CoverChangeNotificationCount, 0);
+		SET_DWORD_STAT(STAT_CoverChangeDeliveredCount, 0);
 	}
 
 	return MyInstance;
@@ -70,6 +142,10 @@ void UCoverSystem::OnBeginPlay()
 {
 	bShutdown = false;
 
+	GenerationScheduler = MakeUnique<FActorCoverGenerationScheduler>(GetWorld());
+	TileDispatcher = MakeUnique<FTileCoverGenerationDispatcher>(GetWorld(), CoverPointMinDistance, SmallestAgentHeight, CoverPointGroundOffset);
+	ChangeNotifier = MakeShared<FCoverChangeNotifier, ESPMode::ThreadSafe>(GetWorld());
+
 	UNavigationSystemV1* navsys = UNavigationSystemV1::GetCurrent(GetWorld());
 	if (!IsValid(navsys))
 		return;
@@ -80,6 +156,13 @@ void UCoverSystem::OnBeginPlay()
 	{
 		Navmesh = const_cast<AChangeNotifyingRecastNavMesh*>(Cast<AChangeNotifyingRecastNavMesh>(mainNavData));
 		Navmesh->NavmeshTilesUpdatedBufferedDelegate.AddDynamic(this, &UCoverSystem::OnNavMeshTilesUpdated);
+		NavMeshRebuildAllHandle = Navmesh->NavmeshRebuildAllDelegate.AddUObject(this, &UCoverSystem::OnNavMeshRebuildAll);
+
+		// buffer tile updates for longer while the dispatcher is backed up
+		Navmesh->TileBufferIntervalDelegate.BindRaw(TileDispatcher.Get(), &FTileCoverGenerationDispatcher::GetDispatchInterval);
+
+		// the navmesh may have been built already
+		NavmeshIslands.Rebuild(Navmesh.Get());
 	}
 }
 
@@ -124,38 +207,67 @@ bool UCoverSystem::RemoveIDToElementMapping(const FVector ElementLocation)
 
 void UCoverSystem::OnNavMeshTilesUpdated(const TSet<uint32>& UpdatedTiles)
 {
-	if (bShutdown)
+	if (bShutdown || !Navmesh.IsValid())
 		return;
 
-	// regenerate cover points within the updated navmesh tiles
-	TArray<const AActor*> dirtyCoverActors;
+	// keep the islands up-to-date before generating any cover points on the updated tiles
+	NavmeshIslands.Rebuild(Navmesh.Get());
+
+	// regenerate cover points within the updated navmesh tiles, throttled by the dispatcher
+	// only the dirty parts of the tiles get regenerated if they're known
+	TArray<FBox> dirtyAreas;
+	TArray<FBox> updatedTileBounds;
 	for (uint32 tileIdx : UpdatedTiles)
 	{
-		// get the bounding box of the updated tile
-		FBox tileBounds = Navmesh->GetNavMeshTileBounds(tileIdx);
-
-#if DEBUG_RENDERING
-		// DrawDebugXXX calls may crash UE4 when not called from the main thread, so start synchronous tasks in case we're planning on drawing debug shapes
-		if (bDebugDraw)
-			(new FAutoDeleteAsyncTask<FNavmeshCoverPointGeneratorTask>(
-				CoverPointMinDistance,
-				SmallestAgentHeight,
-				CoverPointGroundOffset,
-				MapBounds,
-				tileIdx,
-				GetWorld()
-			))->StartSynchronousTask();
-		else
-#endif
-			(new FAutoDeleteAsyncTask<FNavmeshCoverPointGeneratorTask>(
-				CoverPointMinDistance,
-				SmallestAgentHeight,
-				CoverPointGroundOffset,
-				MapBounds,
-				tileIdx,
-				GetWorld()
-			))->StartBackgroundTask();
+		dirtyAreas.Reset();
+		Navmesh->GetDirtyAreasInTile(dirtyAreas, tileIdx);
+		const FBox tileBounds = Navmesh->GetNavMeshTileBounds(tileIdx);
+		TileDispatcher->QueueTile(tileIdx, Navmesh->GetTileUpdateTime(tileIdx), tileBounds, dirtyAreas, bLazyTileGeneration);
+		updatedTileBounds.Add(tileBounds);
 	}
+
+	// whatever changed the navmesh may have changed the exposure of the cover points on it, too
+	ExposureCache.Invalidate(updatedTileBounds);
+
+	TileDispatcher->Dispatch();
+}
+
+void UCoverSystem::OnNavMeshRebuildAll()
+{
+	if (bShutdown || !TileDispatcher.IsValid())
+		return;
+
+	// the tiles may not even be where they used to be, they become cover pending again as they're rebuilt
+	TileDispatcher->ResetLazyTiles();
+}
+
+void UCoverSystem::DispatchQueuedTiles()
+{
+	if (bShutdown || !TileDispatcher.IsValid())
+		return;
+
+	TileDispatcher->Dispatch();
+}
+
+void UCoverSystem::QueueActorCoverGeneration(const FActorCoverGenerationRequest& Request)
+{
+	if (bShutdown || !GenerationScheduler.IsValid())
+		return;
+
+	GenerationScheduler->QueueRequest(Request);
+}
+
+void UCoverSystem::FindCoverPointsCachedUnsafe(TArray<FCoverPointOctreeElement>& OutCoverPoints, const FBox& QueryBox) const
+{
+	const FCoverQueryKey queryKey(QueryBox);
+	if (QueryCache.Find(OutCoverPoints, queryKey, QueryBox, CoverDataVersion))
+		return;
+
+	// query the quantized box so that the result can serve every box with the same key
+	TArray<FCoverPointOctreeElement> coverPoints;
+	INC_DWORD_STAT_BY(STAT_CoverQueryNodeCount, CoverOctree->FindCoverPoints(coverPoints, queryKey.GetBox()));
+	FCoverQueryCache::FilterByBox(OutCoverPoints, coverPoints, QueryBox);
+	QueryCache.Add(queryKey, CoverDataVersion, coverPoints);
 }
 
 void UCoverSystem::FindCoverPoints(TArray<FCoverPointOctreeElement>& OutCoverPoints, const FBox& QueryBox) const
@@ -163,8 +275,13 @@ void UCoverSystem::FindCoverPoints(TArray<FCoverPointOctreeElement>& OutCoverPoi
 	if (bShutdown)
 		return;
 
+	// tiles around recent queries get their cover generated first
+	if (TileDispatcher.IsValid())
+		TileDispatcher->RecordQuery(QueryBox);
+	WakeCoverTiles(QueryBox);
+
 	FRWScopeLock CoverDataLock(CoverDataLockObject, FRWScopeLockType::SLT_ReadOnly);
-	CoverOctree->FindCoverPoints(OutCoverPoints, QueryBox);
+	FindCoverPointsCachedUnsafe(OutCoverPoints, QueryBox);
 }
 
 void UCoverSystem::FindCoverPoints(TArray<FCoverPointOctreeElement>& OutCoverPoints, const FSphere& QuerySphere) const
@@ -172,19 +289,276 @@ void UCoverSystem::FindCoverPoints(TArray<FCoverPointOctreeElement>& OutCoverPoi
 	if (bShutdown)
 		return;
 
-	FRWScopeLock CoverDataLock(CoverDataLockObject, FRWScopeLockType::SLT_ReadOnly);
-	CoverOctree->FindCoverPoints(OutCoverPoints, QuerySphere);
+	const FBox queryBox = FBoxSphereBounds(QuerySphere).GetBox();
+	if (TileDispatcher.IsValid())
+		TileDispatcher->RecordQuery(queryBox);
+	WakeCoverTiles(queryBox);
+
+	TArray<FCoverPointOctreeElement> coverPoints;
+	{
+		FRWScopeLock CoverDataLock(CoverDataLockObject, FRWScopeLockType::SLT_ReadOnly);
+		FindCoverPointsCachedUnsafe(coverPoints, queryBox);
+	}
+
+	// same as TCoverOctree::FindCoverPoints(): ballpark with the box, then check against the sphere
+	for (const FCoverPointOctreeElement& coverPoint : coverPoints)
+		if (QuerySphere.Intersects(coverPoint.Bounds.GetSphere()))
+			OutCoverPoints.Add(coverPoint);
+}
+
+void UCoverSystem::WakeCoverTiles(const FBox& Area) const
+{
+	// don't bother with the dispatcher's lock unless there's something to wake up
+	if (!bLazyTileGeneration || !TileDispatcher.IsValid() || !TileDispatcher->HasDormantTiles() || !TileDispatcher->WakeTiles(Area))
+		return;
+
+	// woken tiles can only be queued on the game thread
+	if (IsInGameThread())
+		TileDispatcher->QueueWokenTiles(bCompleteLazyQueries);
+	else
+		AsyncTask(ENamedThreads::GameThread, [world = TWeakObjectPtr<UWorld>(GetWorld())]() {
+			if (!bShutdown && world.IsValid())
+				GetInstance(world.Get())->TileDispatcher->QueueWokenTiles();
+		});
 }
 
-void UCoverSystem::AddCoverPoints(const TArray<FDTOCoverData>& CoverPointDTOs)
+void UCoverSystem::PrefetchCoverAround(FVector Location, float Radius)
 {
 	if (bShutdown)
 		return;
 
+	WakeCoverTiles(FBox::BuildAABB(Location, FVector(Radius)));
+}
+
+void UCoverSystem::InvalidateExposureAround(const TArray<FVector>& CoverPointLocations)
+{
+	if (CoverPointLocations.Num() == 0)
+		return;
+
+	// one box around everything would take out every evaluation in between when cover changes in far apart places at once,
+	// so the changed cover points are grouped into small clusters that are invalidated separately
+	TArray<FBox> changedAreas;
+	for (const FVector& coverPointLocation : CoverPointLocations)
+	{
+		FBox* clusterArea = changedAreas.FindByPredicate([this, &coverPointLocation](const FBox& ChangedArea) {
+			return (ChangedArea + coverPointLocation).GetSize().GetMax() <= ExposureInvalidationMargin;
+		});
+		if (clusterArea)
+			*clusterArea += coverPointLocation;
+		else
+			changedAreas.Add(FBox(coverPointLocation, coverPointLocation));
+	}
+
+	for (FBox& changedArea : changedAreas)
+		changedArea = changedArea.ExpandBy(ExposureInvalidationMargin);
+	ExposureCache.Invalidate(changedAreas);
+}
+
+void UCoverSystem::RecordCoverChanges(const TArray<FVector>& CoverPointLocations, ECoverChangeType ChangeType) const
+{
+	if (CoverPointLocations.Num() == 0 || !ChangeNotifier.IsValid() || !ChangeNotifier->HasSubscriptions())
+		return;
+
+	TArray<FCoverChange> changes;
+	changes.Reserve(CoverPointLocations.Num());
+	for (const FVector& coverPointLocation : CoverPointLocations)
+		changes.Add(FCoverChange(coverPointLocation, ChangeType));
+	ChangeNotifier->RecordChanges(changes);
+}
+
+void UCoverSystem::AssignNavPolys(TArray<FDTOCoverData>& CoverPointDTOs) const
+{
+	const UNavigationSystemV1* navsys = UNavigationSystemV1::GetCurrent(GetWorld());
+	if (!IsValid(navsys))
+		return;
+	const ANavigationData* navData = navsys->MainNavData;
+	if (!IsValid(navData))
+		return;
+
+	const FVector navProjectionExtent = FVector(CoverPointMinDistance * 0.5f, CoverPointMinDistance * 0.5f, CoverPointGroundOffset * 3.0f);
+	FNavLocation navLocation;
+	for (FDTOCoverData& coverPointDTO : CoverPointDTOs)
+		if (coverPointDTO.NavPolyRef == INVALID_NAVNODEREF && navData->ProjectPoint(coverPointDTO.Location, navLocation, navProjectionExtent))
+			coverPointDTO.NavPolyRef = navLocation.NodeRef;
+}
+
+void UCoverSystem::UpdateCoverClusters()
+{
+	TArray<TWeakObjectPtr<const AActor>> dirtyCoverObjects;
+	CoverClusters.PopDirtyCoverObjects(dirtyCoverObjects);
+
+	TArray<FVector> coverPointLocations;
+	TArray<FCoverPointOctreeElement> coverPoints;
+	for (const TWeakObjectPtr<const AActor>& coverObject : dirtyCoverObjects)
+	{
+		// copy the current cover points of the object so that they can be clustered without holding the lock
+		coverPointLocations.Reset();
+		coverPoints.Reset();
+		{
+			FRWScopeLock CoverDataLock(CoverDataLockObject, FRWScopeLockType::SLT_ReadOnly);
+			CoverObjectToID.MultiFind(coverObject, coverPointLocations);
+
+			FOctreeElementId2 elementID;
+			for (const FVector& coverPointLocation : coverPointLocations)
+				if (GetElementID(elementID, coverPointLocation))
+					coverPoints.Add(CoverOctree->GetElementById(elementID));
+		}
+
+		CoverClusters.Rebuild(coverObject, coverPoints);
+	}
+}
+
+bool UCoverSystem::FindCoverCluster(FCoverCluster& OutCluster, const FVector& CoverLocation)
+{
+	if (bShutdown)
+		return false;
+
+	if (CoverClusters.HasDirtyCoverObjects())
+		UpdateCoverClusters();
+
+	return CoverClusters.FindCluster(OutCluster, CoverLocation);
+}
+
+ENavmeshReachability UCoverSystem::GetReachability(NavNodeRef FromPolyRef, NavNodeRef ToPolyRef) const
+{
+	return NavmeshIslands.GetReachability(FromPolyRef, ToPolyRef);
+}
+
+void UCoverSystem::RankCoverPointsByPathCost(TArray<FCoverPointOctreeElement>& CoverPoints, TArray<float>& OutPathCosts, const FVector& StartLocation, NavNodeRef StartPolyRef, float MaxPathCost, bool bSort) const
+{
+	OutPathCosts.Reset();
+	if (bShutdown)
+	{
+		OutPathCosts.Init(UnknownPathCost, CoverPoints.Num());
+		return;
+	}
+
+	// without a navmesh every cover point ends up with an unknown path cost
+	const UNavigationSystemV1* navsys = UNavigationSystemV1::GetCurrent(GetWorld());
+	const ARecastNavMesh* recastNavmesh = IsValid(navsys) ? Cast<const ARecastNavMesh>(navsys->MainNavData) : nullptr;
+	const dtNavMesh* detourMesh = IsValid(recastNavmesh) ? recastNavmesh->GetRecastMesh() : nullptr;
+
+	// one flood for all the cover points
+	TMap<NavNodeRef, FNavmeshFloodNode> floodNodes;
+	const bool bFloodComplete = FNavmeshDistanceFlood::Flood(floodNodes, recastNavmesh, StartPolyRef, StartLocation, MaxPathCost);
+
+	// cover points that are known to be too far or unreachable are dropped
+	struct FRankedCoverPoint
+	{
+		int32 CoverPointIdx;
+		float PathCost;
+		float Rank;
+	};
+	TArray<FRankedCoverPoint> rankedCoverPoints;
+	rankedCoverPoints.Reserve(CoverPoints.Num());
+	for (int32 iCoverPoint = 0; iCoverPoint < CoverPoints.Num(); iCoverPoint++)
+	{
+		const FDTOCoverData& coverPoint = *CoverPoints[iCoverPoint].Data;
+		if (const FNavmeshFloodNode* floodNode = floodNodes.Find(coverPoint.NavPolyRef))
+		{
+			const float pathCost = floodNode->Cost + FVector::Dist(floodNode->EntryLocation, coverPoint.Location);
+			if (pathCost <= MaxPathCost)
+			{
+				rankedCoverPoints.Add({ iCoverPoint, pathCost, pathCost });
+				continue;
+			}
+		}
+		else if (!bFloodComplete || !detourMesh || !detourMesh->isValidPolyRef(coverPoint.NavPolyRef))
+		{
+			// the straight-line distance is a lower bound of the path cost, good enough for ranking
+			rankedCoverPoints.Add({ iCoverPoint, UnknownPathCost, static_cast<float>(FVector::Dist(StartLocation, coverPoint.Location)) });
+			continue;
+		}
+
+		INC_DWORD_STAT(STAT_FindCoverPathCostRejectCount);
+	}
+
+	if (bSort)
+		rankedCoverPoints.Sort([](const FRankedCoverPoint& A, const FRankedCoverPoint& B) {
+			return A.Rank < B.Rank;
+		});
+
+	TArray<FCoverPointOctreeElement> sortedCoverPoints;
+	sortedCoverPoints.Reserve(rankedCoverPoints.Num());
+	OutPathCosts.Reserve(rankedCoverPoints.Num());
+	for (const FRankedCoverPoint& rankedCoverPoint : rankedCoverPoints)
+	{
+		sortedCoverPoints.Add(CoverPoints[rankedCoverPoint.CoverPointIdx]);
+		OutPathCosts.Add(rankedCoverPoint.PathCost);
+	}
+
+	CoverPoints = MoveTemp(sortedCoverPoints);
+}
+
+void UCoverSystem::AddCoverPoints(const TArray<FDTOCoverData>& CoverPointDTOs, const TMap<const AActor*, FTransform>& ScanTransforms)
+{
+	if (bShutdown)
+		return;
+
+	// place the cover points of movable cover objects where their objects are now, in case they have moved or been re-registered since they were scanned
+	TArray<FDTOCoverData> taggedCoverPointDTOs = CoverPointDTOs;
+	TMap<const AActor*, FTransform> rebaseTransforms;
+	if (ScanTransforms.Num() > 0)
+	{
+		FRWScopeLock CoverDataLock(CoverDataLockObject, FRWScopeLockType::SLT_ReadOnly);
+		for (FDTOCoverData& coverPointDTO : taggedCoverPointDTOs)
+		{
+			const FTransform* scanTransform = ScanTransforms.Find(coverPointDTO.CoverObject);
+			const FMovableCoverObject* movableCoverObject = MovableCoverObjects.Find(coverPointDTO.CoverObject);
+			if (!scanTransform || !movableCoverObject)
+				continue;
+
+			coverPointDTO.Location = movableCoverObject->Transform.TransformPosition(scanTransform->InverseTransformPosition(coverPointDTO.Location));
+			rebaseTransforms.Add(coverPointDTO.CoverObject, movableCoverObject->Transform);
+		}
+	}
+
+	// tag the cover points with their navmesh polys before taking the lock
+	AssignNavPolys(taggedCoverPointDTOs);
+
+	// a new cover object may block the line of sight of cover points that have already been evaluated
+	TArray<FVector> addedCoverPointLocations;
+	addedCoverPointLocations.Reserve(taggedCoverPointDTOs.Num());
+	for (const FDTOCoverData& coverPointDTO : taggedCoverPointDTOs)
+		addedCoverPointLocations.Add(coverPointDTO.Location);
+	InvalidateExposureAround(addedCoverPointLocations);
+
 	FRWScopeLock CoverDataLock(CoverDataLockObject, FRWScopeLockType::SLT_Write);
+	CoverDataVersion++;
 
-	for (FDTOCoverData coverPointDTO : CoverPointDTOs)
-		CoverOctree->AddCoverPoint(coverPointDTO, CoverPointMinDistance * 0.9f);
+	TArray<FVector> keptCoverPointLocations;
+	TArray<FVector> rebasedCoverPointLocations;
+	for (FDTOCoverData& coverPointDTO : taggedCoverPointDTOs)
+	{
+		// the object may have moved again while the navmesh polys were being assigned
+		FMovableCoverObject* movableCoverObject = MovableCoverObjects.Find(coverPointDTO.CoverObject);
+		const FTransform* rebaseTransform = rebaseTransforms.Find(coverPointDTO.CoverObject);
+		if (movableCoverObject && rebaseTransform && !movableCoverObject->Transform.Equals(*rebaseTransform))
+		{
+			coverPointDTO.Location = movableCoverObject->Transform.TransformPosition(rebaseTransform->InverseTransformPosition(coverPointDTO.Location));
+			coverPointDTO.NavPolyRef = INVALID_NAVNODEREF;
+			rebasedCoverPointLocations.Add(coverPointDTO.Location);
+		}
+
+		if (!CoverOctree->AddCoverPoint(coverPointDTO, CoverPointMinDistance * 0.9f))
+			continue;
+
+		keptCoverPointLocations.Add(coverPointDTO.Location);
+		CoverObjectToID.Add(coverPointDTO.CoverObject, coverPointDTO.Location);
+		CoverClusters.MarkDirty(coverPointDTO.CoverObject);
+
+		// movable cover objects also keep their cover points in object-local space
+		if (movableCoverObject)
+		{
+			FDTOCoverData localCoverPointDTO = coverPointDTO;
+			localCoverPointDTO.Location = movableCoverObject->Transform.InverseTransformPosition(coverPointDTO.Location);
+			localCoverPointDTO.NavPolyRef = INVALID_NAVNODEREF;
+			movableCoverObject->LocalCoverPoints.Add(localCoverPointDTO);
+			movableCoverObject->CoverPointLocations.Add(coverPointDTO.Location);
+		}
+	}
+	InvalidateExposureAround(rebasedCoverPointLocations);
+	RecordCoverChanges(keptCoverPointLocations, ECoverChangeType::Added);
 
 	// optimize the octree
 	CoverOctree->ShrinkElements();
@@ -200,19 +574,31 @@ FBox UCoverSystem::EnlargeAABB(FBox Box)
 }
 
 void UCoverSystem::RemoveStaleCoverPoints(FBox Area)
+{
+	RemoveStaleCoverPoints(TArray<FBox>({ Area }));
+}
+
+void UCoverSystem::RemoveStaleCoverPoints(const TArray<FBox>& Areas)
 {
 	if (bShutdown)
 		return;
 
 	FRWScopeLock CoverDataLock(CoverDataLockObject, FRWScopeLockType::SLT_Write);
+	CoverDataVersion++;
 
-	// enlarge the clean-up area to x1.5 its size
-	Area = EnlargeAABB(Area);
-
-	// find all the cover points in the specified area
+	// find all the cover points in the specified areas, enlarged to x1.5 their size
 	TArray<FCoverPointOctreeElement> coverPoints;
-	CoverOctree->FindCoverPoints(coverPoints, Area);
+	TArray<FBox> exposureAreas;
+	for (const FBox& area : Areas)
+	{
+		CoverOctree->FindCoverPoints(coverPoints, EnlargeAABB(area));
+		exposureAreas.Add(EnlargeAABB(area).ExpandBy(ExposureInvalidationMargin));
+	}
+
+	// something has changed in these areas, their evaluations can't be trusted anymore
+	ExposureCache.Invalidate(exposureAreas);
 
+	TArray<FVector> removedCoverPointLocations;
 	for (FCoverPointOctreeElement coverPoint : coverPoints)
 	{
 		// check if the cover point still has an owner and still falls on the exact same location on the navmesh as it did when it was generated
@@ -231,7 +617,11 @@ void UCoverSystem::RemoveStaleCoverPoints(FBox Area)
 		// remove the cover point from the element-to-id and object-to-location maps
 		RemoveIDToElementMapping(coverPoint.Data->Location);
 		CoverObjectToID.RemoveSingle(coverPoint.Data->CoverObject, coverPoint.Data->Location);
+		CoverClusters.MarkDirty(coverPoint.Data->CoverObject);
+		ForgetMovableCoverPoint(coverPoint.Data->CoverObject.Get(), coverPoint.Data->Location);
+		removedCoverPointLocations.Add(coverPoint.Data->Location);
 	}
+	RecordCoverChanges(removedCoverPointLocations, ECoverChangeType::Removed);
 
 	// optimize the octree
 	CoverOctree->ShrinkElements();
@@ -251,9 +641,11 @@ void UCoverSystem::RemoveCoverPointsOfObject(const AActor* CoverObject)
 		return;
 
 	FRWScopeLock CoverDataLock(CoverDataLockObject, FRWScopeLockType::SLT_Write);
+	CoverDataVersion++;
 
 	TArray<FVector> coverPointLocations;
 	CoverObjectToID.MultiFind(CoverObject, coverPointLocations, false);
+	InvalidateExposureAround(coverPointLocations);
 
 	for (const FVector coverPointLocation : coverPointLocations)
 	{
@@ -269,16 +661,180 @@ void UCoverSystem::RemoveCoverPointsOfObject(const AActor* CoverObject)
 #endif
 	}
 
+	// the object-local cover points are gone, too, and so is whatever held cover they have been moved to
+	for (const FVector coverPointLocation : coverPointLocations)
+		ForgetMovedHeldCover(coverPointLocation);
+	if (FMovableCoverObject* movableCoverObject = MovableCoverObjects.Find(CoverObject))
+	{
+		movableCoverObject->LocalCoverPoints.Empty();
+		movableCoverObject->CoverPointLocations.Empty();
+	}
+
+	CoverClusters.MarkDirty(CoverObject);
+	RecordCoverChanges(coverPointLocations, ECoverChangeType::Removed);
+
 	// optimize the octree
 	CoverOctree->ShrinkElements();
 }
 
+void UCoverSystem::ForgetMovedHeldCover(const FVector& CoverPointLocation)
+{
+	FVector heldAtLocation;
+	if (HeldAtCoverLocations.RemoveAndCopyValue(CoverPointLocation, heldAtLocation))
+		MovedHeldCoverLocations.Remove(heldAtLocation);
+}
+
+void UCoverSystem::ForgetMovableCoverPoint(const AActor* CoverObject, const FVector& CoverPointLocation)
+{
+	ForgetMovedHeldCover(CoverPointLocation);
+
+	FMovableCoverObject* movableCoverObject = MovableCoverObjects.Find(CoverObject);
+	if (!movableCoverObject)
+		return;
+
+	const int32 iCoverPoint = movableCoverObject->CoverPointLocations.Find(CoverPointLocation);
+	if (iCoverPoint == INDEX_NONE)
+		return;
+
+	// the arrays are parallel, so they're shuffled the same way
+	movableCoverObject->LocalCoverPoints.RemoveAtSwap(iCoverPoint);
+	movableCoverObject->CoverPointLocations.RemoveAtSwap(iCoverPoint);
+}
+
+void UCoverSystem::RegisterMovableCoverObject(const AActor* CoverObject, const FTransform& Transform)
+{
+	if (bShutdown)
+		return;
+
+	FRWScopeLock CoverDataLock(CoverDataLockObject, FRWScopeLockType::SLT_Write);
+	MovableCoverObjects.Add(CoverObject, FMovableCoverObject(Transform));
+}
+
+void UCoverSystem::UnregisterMovableCoverObject(const AActor* CoverObject)
+{
+	if (bShutdown)
+		return;
+
+	FRWScopeLock CoverDataLock(CoverDataLockObject, FRWScopeLockType::SLT_Write);
+	MovableCoverObjects.Remove(CoverObject);
+}
+
+int32 UCoverSystem::MoveCoverPointsOfObject(const AActor* CoverObject, const FTransform& NewTransform)
+{
+	if (bShutdown)
+		return 0;
+
+	// profiling
+	SCOPE_CYCLE_COUNTER(STAT_MoveCover);
+	INC_DWORD_STAT(STAT_MoveCoverHistoricalCount);
+
+	// copy the object-local cover points so that the navmesh can be queried without holding the lock
+	TArray<FDTOCoverData> movedCoverPoints;
+	{
+		FRWScopeLock CoverDataLock(CoverDataLockObject, FRWScopeLockType::SLT_ReadOnly);
+		const FMovableCoverObject* movableCoverObject = MovableCoverObjects.Find(CoverObject);
+		if (!movableCoverObject)
+			return 0;
+
+		movedCoverPoints = movableCoverObject->LocalCoverPoints;
+	}
+
+	UNavigationSystemV1* navsys = UNavigationSystemV1::GetCurrent(GetWorld());
+	if (!IsValid(navsys))
+		return 0;
+	const ANavigationData* navData = navsys->GetDefaultNavDataInstance();
+	if (!IsValid(navData))
+		return 0;
+
+	// move the cover points and check that they still fall on the navmesh, in a single batch
+	const FVector navProjectionExtent = FVector(CoverPointMinDistance * 0.5f, CoverPointMinDistance * 0.5f, CoverPointGroundOffset * 3.0f);
+	FNavLocation navLocation;
+	TBitArray<> bOnNavmesh(false, movedCoverPoints.Num());
+	navData->BeginBatchQuery();
+	for (int32 iCoverPoint = 0; iCoverPoint < movedCoverPoints.Num(); iCoverPoint++)
+	{
+		FDTOCoverData& coverPoint = movedCoverPoints[iCoverPoint];
+		coverPoint.Location = NewTransform.TransformPosition(coverPoint.Location);
+		bOnNavmesh[iCoverPoint] = navData->ProjectPoint(coverPoint.Location, navLocation, navProjectionExtent);
+		if (bOnNavmesh[iCoverPoint])
+			coverPoint.NavPolyRef = navLocation.NodeRef;
+	}
+	navData->FinishBatchQuery();
+
+	FRWScopeLock CoverDataLock(CoverDataLockObject, FRWScopeLockType::SLT_Write);
+	CoverDataVersion++;
+
+	// the object may have been unregistered or regenerated while the navmesh was being queried
+	FMovableCoverObject* movableCoverObject = MovableCoverObjects.Find(CoverObject);
+	if (!movableCoverObject || movableCoverObject->LocalCoverPoints.Num() != movedCoverPoints.Num())
+		return 0;
+
+	// note which cover points are held so that they stay held once moved
+	TBitArray<> bTaken(false, movedCoverPoints.Num());
+	FOctreeElementId2 formerElementID;
+	for (int32 iCoverPoint = 0; iCoverPoint < movedCoverPoints.Num(); iCoverPoint++)
+		bTaken[iCoverPoint] = GetElementID(formerElementID, movableCoverObject->CoverPointLocations[iCoverPoint])
+			&& CoverOctree->GetElementById(formerElementID).Data->bTaken;
+
+	// remove the cover points from their former location
+	TArray<FVector> formerCoverPointLocations;
+	CoverObjectToID.MultiFind(CoverObject, formerCoverPointLocations, false);
+	InvalidateExposureAround(formerCoverPointLocations);
+	for (const FVector formerCoverPointLocation : formerCoverPointLocations)
+	{
+		FOctreeElementId2 elementID;
+		GetElementID(elementID, formerCoverPointLocation);
+		CoverOctree->RemoveElement(elementID);
+		RemoveIDToElementMapping(formerCoverPointLocation);
+	}
+	CoverObjectToID.Remove(CoverObject);
+
+	// add them at their new location
+	int32 nKeptCoverPoints = 0;
+	TArray<FVector> movedCoverPointLocations;
+	for (int32 iCoverPoint = 0; iCoverPoint < movedCoverPoints.Num(); iCoverPoint++)
+	{
+		FDTOCoverData& coverPoint = movedCoverPoints[iCoverPoint];
+		const FVector formerCoverPointLocation = movableCoverObject->CoverPointLocations[iCoverPoint];
+		movableCoverObject->CoverPointLocations[iCoverPoint] = coverPoint.Location;
+
+		// held cover points are forwarded from where they were held to where they are now, or forgotten if they didn't make it
+		FVector heldAtLocation = formerCoverPointLocation;
+		if (HeldAtCoverLocations.RemoveAndCopyValue(formerCoverPointLocation, heldAtLocation))
+			MovedHeldCoverLocations.Remove(heldAtLocation);
+		if (!bOnNavmesh[iCoverPoint] || !CoverOctree->AddCoverPoint(coverPoint, CoverPointMinDistance * 0.9f))
+			continue;
+
+		CoverObjectToID.Add(coverPoint.CoverObject, coverPoint.Location);
+		movedCoverPointLocations.Add(coverPoint.Location);
+		nKeptCoverPoints++;
+
+		FOctreeElementId2 movedElementID;
+		if (bTaken[iCoverPoint] && GetElementID(movedElementID, coverPoint.Location) && CoverOctree->HoldCover(movedElementID))
+		{
+			MovedHeldCoverLocations.Add(heldAtLocation, coverPoint.Location);
+			HeldAtCoverLocations.Add(coverPoint.Location, heldAtLocation);
+		}
+	}
+	movableCoverObject->Transform = NewTransform;
+	InvalidateExposureAround(movedCoverPointLocations);
+	CoverClusters.MarkDirty(CoverObject);
+	RecordCoverChanges(formerCoverPointLocations, ECoverChangeType::Removed);
+	RecordCoverChanges(movedCoverPointLocations, ECoverChangeType::Added);
+
+	// optimize the octree
+	CoverOctree->ShrinkElements();
+
+	return nKeptCoverPoints;
+}
+
 void UCoverSystem::RemoveAll()
 {
 	if (bShutdown)
 		return;
 
 	FRWScopeLock CoverDataLock(CoverDataLockObject, FRWScopeLockType::SLT_Write);
+	CoverDataVersion++;
 
 	// destroy the octree
 	if (CoverOctree.IsValid())
@@ -287,11 +843,246 @@ void UCoverSystem::RemoveAll()
 		CoverOctree = nullptr;
 	}
 
-	// remove the id-to-element mappings
+	// remove the id-to-element and object-to-location mappings
 	ElementToID.Empty();
+	CoverObjectToID.Empty();
+	for (TPair<TWeakObjectPtr<const AActor>, FMovableCoverObject>& movableCoverObject : MovableCoverObjects)
+	{
+		movableCoverObject.Value.LocalCoverPoints.Empty();
+		movableCoverObject.Value.CoverPointLocations.Empty();
+	}
+	MovedHeldCoverLocations.Empty();
+	HeldAtCoverLocations.Empty();
 
 	// make a new octree
 	CoverOctree = MakeShareable(new TCoverOctree(FVector(0, 0, 0), 64000));
+
+	ExposureCache.InvalidateAll();
+	CoverClusters.Reset();
+	OcclusionGrid.Reset();
+
+	// no tile has any cover left
+	if (TileDispatcher.IsValid())
+		TileDispatcher->ResetLazyTiles();
+}
+
+bool UCoverSystem::FindMeshCoverTemplate(TArray<FVector>& OutLocalCandidates, const FMeshCoverTemplateKey& Key) const
+{
+	if (bShutdown)
+		return false;
+
+	FRWScopeLock MeshCoverTemplateLock(MeshCoverTemplateLockObject, FRWScopeLockType::SLT_ReadOnly);
+
+	const TArray<FVector>* localCandidates = MeshCoverTemplates.Find(Key);
+	if (!localCandidates)
+		return false;
+
+	OutLocalCandidates = *localCandidates;
+	return true;
+}
+
+void UCoverSystem::AddMeshCoverTemplate(const FMeshCoverTemplateKey& Key, const TArray<FVector>& LocalCandidates)
+{
+	if (bShutdown)
+		return;
+
+	FRWScopeLock MeshCoverTemplateLock(MeshCoverTemplateLockObject, FRWScopeLockType::SLT_Write);
+
+	// another task may have beaten us to it while we were scanning the same mesh
+	if (!MeshCoverTemplates.Contains(Key))
+		MeshCoverTemplates.Add(Key, LocalCandidates);
+}
+
+void UCoverSystem::RemoveAllMeshCoverTemplates()
+{
+	if (bShutdown)
+		return;
+
+	FRWScopeLock MeshCoverTemplateLock(MeshCoverTemplateLockObject, FRWScopeLockType::SLT_Write);
+	MeshCoverTemplates.Empty();
+}
+
+int32 UCoverSystem::FindSquadCover(TArray<FSquadCoverAssignment>& OutAssignments, const TArray<FSquadCoverRequest>& Requests, const FSquadCoverQuerySettings& Settings)
+{
+	OutAssignments.Reset();
+	OutAssignments.SetNum(Requests.Num());
+	if (bShutdown)
+		return 0;
+
+	// profiling
+	SCOPE_CYCLE_COUNTER(STAT_SquadCover);
+
+	UWorld* world = GetWorld();
+	const UNavigationSystemV1* navsys = UNavigationSystemV1::GetCurrent(world);
+	const ANavigationData* navData = IsValid(navsys) ? navsys->MainNavData : nullptr;
+	if (!IsValid(navData))
+		return 0;
+
+	struct FSquadAgent
+	{
+		int32 RequestIdx;
+		const ACharacter* Character;
+		const AActor* Enemy;
+		FVector Location;
+		FVector EnemyLocation;
+		NavNodeRef PolyRef;
+		float EyeHeightStanding;
+		float EyeHeightCrouched;
+		TArray<FCoverPointOctreeElement> CoverPoints;
+		TArray<float> PathCosts;
+		int32 NextCoverPoint;
+	};
+
+	// gather the candidates of each enemy only once
+	const float minAttackRangeSquared = FMath::Square(Settings.MinAttackRange);
+	TMap<const AActor*, TArray<FCoverPointOctreeElement>> enemyCoverPoints;
+	TArray<FSquadAgent> agents;
+	agents.Reserve(Requests.Num());
+	for (int32 iRequest = 0; iRequest < Requests.Num(); iRequest++)
+	{
+		const ACharacter* character = Requests[iRequest].Agent.Get();
+		const AActor* enemy = Requests[iRequest].Enemy.Get();
+		if (!IsValid(character) || !IsValid(enemy))
+			continue;
+
+		const FVector enemyLocation = enemy->GetActorLocation();
+		TArray<FCoverPointOctreeElement>* coverPoints = enemyCoverPoints.Find(enemy);
+		if (!coverPoints)
+		{
+			TArray<FCoverPointOctreeElement> foundCoverPoints;
+			FindCoverPoints(foundCoverPoints, FBoxCenterAndExtent(enemyLocation, FVector(Settings.AttackRange * 0.5f)).GetBox());
+
+			coverPoints = &enemyCoverPoints.Add(enemy);
+			for (const FCoverPointOctreeElement& coverPoint : foundCoverPoints)
+				if (!coverPoint.Data->bTaken
+					&& FVector::DistSquared(enemyLocation, coverPoint.Data->Location) >= minAttackRangeSquared)
+					coverPoints->Add(coverPoint);
+		}
+
+		FSquadAgent& agent = agents.AddDefaulted_GetRef();
+		agent.RequestIdx = iRequest;
+		agent.Character = character;
+		agent.Enemy = enemy;
+		agent.Location = character->GetActorLocation();
+		agent.EnemyLocation = enemyLocation;
+		const float capsuleHalfHeight = character->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+		agent.EyeHeightStanding = capsuleHalfHeight + character->BaseEyeHeight;
+		agent.EyeHeightCrouched = capsuleHalfHeight + character->CrouchedEyeHeight;
+		agent.NextCoverPoint = 0;
+
+		// each agent ranks the shared candidates by its own path cost
+		FNavLocation agentNavLocation;
+		navData->ProjectPoint(agent.Location, agentNavLocation, navData->GetConfig().DefaultQueryExtent);
+		agent.PolyRef = agentNavLocation.NodeRef;
+		agent.CoverPoints = *coverPoints;
+		RankCoverPointsByPathCost(agent.CoverPoints, agent.PathCosts, agent.Location, agent.PolyRef, Settings.MaxCoverPathCost);
+	}
+
+	// ranks an agent by the cost of its next candidate, unknown path costs are estimated by the straight-line distance
+	auto getNextCost = [](const FSquadAgent& Agent) {
+		const float pathCost = Agent.PathCosts[Agent.NextCoverPoint];
+		return pathCost != UnknownPathCost ? pathCost : static_cast<float>(FVector::Dist(Agent.Location, Agent.CoverPoints[Agent.NextCoverPoint].Data->Location));
+	};
+	auto isCheaper = [](const TPair<float, int32>& A, const TPair<float, int32>& B) {
+		return A.Key < B.Key;
+	};
+
+	TArray<TPair<float, int32>> openAgents;
+	for (int32 iAgent = 0; iAgent < agents.Num(); iAgent++)
+		if (agents[iAgent].CoverPoints.Num() > 0)
+			openAgents.HeapPush(TPair<float, int32>(getNextCost(agents[iAgent]), iAgent), isCheaper);
+
+	// greedy assignment: the cheapest (agent, cover point) pair goes first, as long as the cover point is adequate and unclaimed
+	// repeated evaluations of an agent are served by the exposure cache
+	// agents whose cover has been taken by someone else by the time it's held go on with their next candidates in another round
+	TSet<FVector> claimedCoverLocations;
+	TArray<int32> assignedAgents;
+	TArray<FVector> assignedCoverLocations;
+	int32 nAssigned = 0;
+	int32 sweepCount = 0;
+	TPair<float, int32> openAgent;
+	while (openAgents.Num() > 0)
+	{
+		assignedAgents.Reset();
+		assignedCoverLocations.Reset();
+		while (openAgents.Num() > 0)
+		{
+			openAgents.HeapPop(openAgent, isCheaper, false);
+			FSquadAgent& agent = agents[openAgent.Value];
+			const FCoverPointOctreeElement& coverPoint = agent.CoverPoints[agent.NextCoverPoint];
+			const FVector coverLocation = coverPoint.Data->Location;
+
+			bool bFoundCover = false;
+			if (!claimedCoverLocations.Contains(coverLocation))
+			{
+				bool bReachable = agent.PathCosts[agent.NextCoverPoint] != UnknownPathCost;
+				if (!bReachable)
+				{
+					const ENavmeshReachability reachability = GetReachability(agent.PolyRef, coverPoint.Data->NavPolyRef);
+					bReachable = reachability == ENavmeshReachability::Reachable
+						|| (reachability == ENavmeshReachability::Unknown && navsys->TestPathSync(FPathFindingQuery(agent.Character, *navData, agent.Location, coverLocation)));
+				}
+
+				bFoundCover = bReachable
+					&& (FCoverPointEvaluator::EvaluateCoverPointAgainstThreats(Settings.EvaluationSettings, coverPoint, agent.Character, agent.EyeHeightStanding, agent.Enemy, agent.EnemyLocation, Settings.Threats, world, sweepCount)
+						|| FCoverPointEvaluator::EvaluateCoverPointAgainstThreats(Settings.EvaluationSettings, coverPoint, agent.Character, agent.EyeHeightCrouched, agent.Enemy, agent.EnemyLocation, Settings.Threats, world, sweepCount));
+			}
+
+			if (bFoundCover)
+			{
+				claimedCoverLocations.Add(coverLocation);
+				assignedAgents.Add(openAgent.Value);
+				assignedCoverLocations.Add(coverLocation);
+				continue;
+			}
+
+			// try the agent's next candidate later, in order of its cost
+			if (++agent.NextCoverPoint < agent.CoverPoints.Num())
+				openAgents.HeapPush(TPair<float, int32>(getNextCost(agent), openAgent.Value), isCheaper);
+		}
+
+		// reserve all the chosen cover points at once
+		TArray<bool> bHeld;
+		HoldCovers(bHeld, assignedCoverLocations);
+
+		for (int32 iAssigned = 0; iAssigned < assignedAgents.Num(); iAssigned++)
+		{
+			FSquadAgent& agent = agents[assignedAgents[iAssigned]];
+			if (bHeld[iAssigned])
+			{
+				FSquadCoverAssignment& assignment = OutAssignments[agent.RequestIdx];
+				assignment.bFoundCover = true;
+				assignment.CoverLocation = assignedCoverLocations[iAssigned];
+				nAssigned++;
+			}
+			else if (++agent.NextCoverPoint < agent.CoverPoints.Num()) // the cover point stays claimed, it's been taken
+				openAgents.HeapPush(TPair<float, int32>(getNextCost(agent), assignedAgents[iAssigned]), isCheaper);
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_SquadCoverAssignedCount, nAssigned);
+	INC_DWORD_STAT_BY(STAT_SquadCoverSweepCount, sweepCount);
+
+	return nAssigned;
+}
+
+void UCoverSystem::HoldCovers(TArray<bool>& bOutHeld, const TArray<FVector>& ElementLocations)
+{
+	bOutHeld.Init(false, ElementLocations.Num());
+	if (bShutdown)
+		return;
+
+	FRWScopeLock CoverDataLock(CoverDataLockObject, FRWScopeLockType::SLT_Write);
+
+	FOctreeElementId2 elemID;
+	TArray<FVector> heldCoverPointLocations;
+	for (int32 iElement = 0; iElement < ElementLocations.Num(); iElement++)
+	{
+		bOutHeld[iElement] = GetElementID(elemID, ElementLocations[iElement]) && CoverOctree->HoldCover(elemID);
+		if (bOutHeld[iElement])
+			heldCoverPointLocations.Add(ElementLocations[iElement]);
+	}
+	RecordCoverChanges(heldCoverPointLocations, ECoverChangeType::Taken);
 }
 
 bool UCoverSystem::HoldCover(FVector ElementLocation)
@@ -303,10 +1094,11 @@ bool UCoverSystem::HoldCover(FVector ElementLocation)
 
 
 	FOctreeElementId2 elemID;
-	if (!GetElementID(elemID, ElementLocation))
+	if (!GetElementID(elemID, ElementLocation) || !CoverOctree->HoldCover(elemID))
 		return false;
 
-	return CoverOctree->HoldCover(elemID);
+	RecordCoverChanges(TArray<FVector>({ ElementLocation }), ECoverChangeType::Taken);
+	return true;
 }
 
 bool UCoverSystem::ReleaseCover(FVector ElementLocation)
@@ -316,9 +1108,18 @@ bool UCoverSystem::ReleaseCover(FVector ElementLocation)
 
 	FRWScopeLock CoverDataLock(CoverDataLockObject, FRWScopeLockType::SLT_Write);
 
+	// the cover point may have been moved along with its cover object since it was held
+	FVector movedElementLocation;
+	if (MovedHeldCoverLocations.RemoveAndCopyValue(ElementLocation, movedElementLocation))
+	{
+		HeldAtCoverLocations.Remove(movedElementLocation);
+		ElementLocation = movedElementLocation;
+	}
+
 	FOctreeElementId2 elemID;
-	if (!GetElementID(elemID, ElementLocation))
+	if (!GetElementID(elemID, ElementLocation) || !CoverOctree->ReleaseCover(elemID))
 		return false;
 
-	return CoverOctree->ReleaseCover(elemID);
+	RecordCoverChanges(TArray<FVector>({ ElementLocation }), ECoverChangeType::Released);
+	return true;
 }
@@ -0,0 +1,107 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "CoverSystem/NavmeshDistanceFlood.h"
+#include "CoverSystem/CoverSystem.h"
+#include "NavMesh/RecastHelpers.h"
+#include "Detour/DetourNavMesh.h"
+
+/** An entry of the flood's open list. */
+struct FNavmeshFloodOpenNode
+{
+	NavNodeRef PolyRef;
+	float Cost;
+
+	FORCEINLINE bool operator<(const FNavmeshFloodOpenNode& Other) const
+	{
+		return Cost < Other.Cost;
+	}
+};
+
+bool FNavmeshDistanceFlood::Flood(TMap<NavNodeRef, FNavmeshFloodNode>& OutNodes, const ARecastNavMesh* Navmesh, NavNodeRef StartPolyRef, const FVector& StartLocation, float MaxCost)
+{
+	// profiling
+	SCOPE_CYCLE_COUNTER(STAT_NavmeshDistanceFlood);
+
+	const dtNavMesh* detourMesh = IsValid(Navmesh) ? Navmesh->GetRecastMesh() : nullptr;
+	if (!detourMesh || !detourMesh->isValidPolyRef(StartPolyRef))
+		return false;
+
+	// distances are the same in Recast space, so work in it and only convert the entry locations back
+	TMap<NavNodeRef, FVector> recastEntryLocations;
+	TArray<FNavmeshFloodOpenNode> openList;
+	OutNodes.Add(StartPolyRef, FNavmeshFloodNode(0.0f, StartLocation));
+	recastEntryLocations.Add(StartPolyRef, Unreal2RecastPoint(StartLocation));
+	openList.HeapPush({ StartPolyRef, 0.0f });
+
+	FNavmeshFloodOpenNode openNode;
+	while (openList.Num() > 0 && OutNodes.Num() < MaxFloodNodes)
+	{
+		openList.HeapPop(openNode, false);
+
+		// skip stale entries, the poly has been reached more cheaply since
+		if (openNode.Cost > OutNodes[openNode.PolyRef].Cost)
+			continue;
+
+		const dtMeshTile* tile = nullptr;
+		const dtPoly* poly = nullptr;
+		if (dtStatusFailed(detourMesh->getTileAndPolyByRef(openNode.PolyRef, &tile, &poly)))
+			continue;
+
+		const FVector entryLocation = recastEntryLocations[openNode.PolyRef];
+		for (unsigned int linkIdx = poly->firstLink; linkIdx != DT_NULL_LINK; linkIdx = detourMesh->getLink(tile, linkIdx).next)
+		{
+			const dtLink& link = detourMesh->getLink(tile, linkIdx);
+			if (!link.ref)
+				continue;
+
+			FVector portalLocation;
+			if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			{
+				// off-mesh connections are left at the endpoint that the link is attached to
+				if (link.edge >= poly->vertCount)
+					continue;
+
+				const dtReal* endpoint = &tile->verts[poly->verts[link.edge] * 3];
+				portalLocation = FVector(endpoint[0], endpoint[1], endpoint[2]);
+			}
+			else if (link.edge == 0xff)
+			{
+				// links into off-mesh connections don't have a shared edge, enter them at their nearest endpoint instead
+				const dtMeshTile* neighbourTile = nullptr;
+				const dtPoly* neighbourPoly = nullptr;
+				if (dtStatusFailed(detourMesh->getTileAndPolyByRef(link.ref, &neighbourTile, &neighbourPoly))
+					|| neighbourPoly->getType() != DT_POLYTYPE_OFFMESH_CONNECTION)
+					continue;
+
+				const dtReal* endpointA = &neighbourTile->verts[neighbourPoly->verts[0] * 3];
+				const dtReal* endpointB = &neighbourTile->verts[neighbourPoly->verts[1] * 3];
+				const FVector locationA(endpointA[0], endpointA[1], endpointA[2]);
+				const FVector locationB(endpointB[0], endpointB[1], endpointB[2]);
+				portalLocation = FVector::DistSquared(entryLocation, locationA) <= FVector::DistSquared(entryLocation, locationB) ? locationA : locationB;
+			}
+			else
+			{
+				// cross into the neighbour at the midpoint of the shared edge
+				const dtReal* portalStart = &tile->verts[poly->verts[link.edge] * 3];
+				const dtReal* portalEnd = &tile->verts[poly->verts[(link.edge + 1) % poly->vertCount] * 3];
+				portalLocation = (FVector(portalStart[0], portalStart[1], portalStart[2]) + FVector(portalEnd[0], portalEnd[1], portalEnd[2])) * 0.5f;
+			}
+
+			const float neighbourCost = openNode.Cost + FVector::Dist(entryLocation, portalLocation);
+			if (neighbourCost > MaxCost)
+				continue;
+
+			const FNavmeshFloodNode* neighbourNode = OutNodes.Find(link.ref);
+			if (neighbourNode && neighbourNode->Cost <= neighbourCost)
+				continue;
+
+			OutNodes.Add(link.ref, FNavmeshFloodNode(neighbourCost, Recast2UnrealPoint(portalLocation)));
+			recastEntryLocations.Add(link.ref, portalLocation);
+			openList.HeapPush({ link.ref, neighbourCost });
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_NavmeshDistanceFloodPolyCount, OutNodes.Num());
+
+	return openList.Num() == 0;
+}
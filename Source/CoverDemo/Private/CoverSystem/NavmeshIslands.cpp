@@ -0,0 +1,238 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "CoverSystem/NavmeshIslands.h"
+#include "CoverSystem/CoverSystem.h"
+#include "Detour/DetourNavMesh.h"
+
+// Union-find root lookup with path halving.
+static int32 FindIslandRoot(TArray<int32>& Parents, int32 PolyIdx)
+{
+	while (Parents[PolyIdx] != PolyIdx)
+	{
+		Parents[PolyIdx] = Parents[Parents[PolyIdx]];
+		PolyIdx = Parents[PolyIdx];
+	}
+
+	return PolyIdx;
+}
+
+// Joins the islands of A and B.
+static void JoinIslands(TArray<int32>& Parents, int32 A, int32 B)
+{
+	const int32 rootA = FindIslandRoot(Parents, A);
+	const int32 rootB = FindIslandRoot(Parents, B);
+	if (rootA != rootB)
+		Parents[rootB] = rootA;
+}
+
+// Groups the polys of a tile into islands by the links between them and collects the links that lead to other tiles.
+static TSharedPtr<const FNavmeshTileIslands> BuildTileIslands(const dtNavMesh* DetourMesh, int32 TileIdx)
+{
+	TSharedPtr<FNavmeshTileIslands> tileIslands = MakeShared<FNavmeshTileIslands>();
+	const dtMeshTile* tile = DetourMesh->getTile(TileIdx);
+	if (!tile || !tile->header || tile->header->polyCount == 0)
+		return tileIslands;
+
+	const int32 nPolys = tile->header->polyCount;
+	tileIslands->Salt = tile->salt;
+
+	// join every poly with its linked neighbours within the tile
+	TArray<int32> parents;
+	parents.SetNumUninitialized(nPolys);
+	for (int32 iPoly = 0; iPoly < nPolys; iPoly++)
+		parents[iPoly] = iPoly;
+
+	for (int32 iPoly = 0; iPoly < nPolys; iPoly++)
+		for (unsigned int linkIdx = tile->polys[iPoly].firstLink; linkIdx != DT_NULL_LINK; linkIdx = DetourMesh->getLink(tile, linkIdx).next)
+		{
+			unsigned int neighbourSalt, neighbourTile, neighbourPoly;
+			DetourMesh->decodePolyId(DetourMesh->getLink(tile, linkIdx).ref, neighbourSalt, neighbourTile, neighbourPoly);
+			if (static_cast<int32>(neighbourTile) == TileIdx && static_cast<int32>(neighbourPoly) < nPolys)
+				JoinIslands(parents, iPoly, neighbourPoly);
+		}
+
+	// number the local islands
+	TArray<int32> rootIslands;
+	tileIslands->PolyLocalIslands.SetNumUninitialized(nPolys);
+	rootIslands.Init(INDEX_NONE, nPolys);
+	for (int32 iPoly = 0; iPoly < nPolys; iPoly++)
+	{
+		int32& rootIsland = rootIslands[FindIslandRoot(parents, iPoly)];
+		if (rootIsland == INDEX_NONE)
+			rootIsland = tileIslands->LocalIslandCount++;
+
+		tileIslands->PolyLocalIslands[iPoly] = rootIsland;
+	}
+
+	// the links to other tiles are resolved once every tile has its local islands
+	for (int32 iPoly = 0; iPoly < nPolys; iPoly++)
+		for (unsigned int linkIdx = tile->polys[iPoly].firstLink; linkIdx != DT_NULL_LINK; linkIdx = DetourMesh->getLink(tile, linkIdx).next)
+		{
+			unsigned int neighbourSalt, neighbourTile, neighbourPoly;
+			DetourMesh->decodePolyId(DetourMesh->getLink(tile, linkIdx).ref, neighbourSalt, neighbourTile, neighbourPoly);
+			if (static_cast<int32>(neighbourTile) != TileIdx)
+				tileIslands->ExternalLinks.Add(FNavmeshExternalLink(tileIslands->PolyLocalIslands[iPoly], neighbourTile, neighbourPoly));
+		}
+
+	return tileIslands;
+}
+
+void FNavmeshIslands::Rebuild(const ARecastNavMesh* _Navmesh)
+{
+	// profiling
+	SCOPE_CYCLE_COUNTER(STAT_RebuildNavmeshIslands);
+
+	const dtNavMesh* detourMesh = IsValid(_Navmesh) ? _Navmesh->GetRecastMesh() : nullptr;
+	if (!detourMesh)
+	{
+		Reset();
+		return;
+	}
+
+	// only the game thread writes the islands, so they can be read here without locking
+	// a new detour mesh means that the whole navmesh has been rebuilt, nothing can be reused
+	const int32 nTiles = detourMesh->getMaxTiles();
+	const bool bRebuildAll = Navmesh.Get() != _Navmesh || DetourMesh != detourMesh || TileIslands.Num() != nTiles;
+	TArray<TSharedPtr<const FNavmeshTileIslands>> tileIslands;
+	if (bRebuildAll)
+		tileIslands.SetNum(nTiles);
+	else
+		tileIslands = TileIslands;
+
+	// find the tiles that have been added, removed or rebuilt
+	TArray<int32> changedTiles;
+	for (int32 iTile = 0; iTile < nTiles; iTile++)
+	{
+		const dtMeshTile* tile = detourMesh->getTile(iTile);
+		const bool bEmpty = !tile || !tile->header || tile->header->polyCount == 0;
+		if (bRebuildAll
+			|| tileIslands[iTile]->Salt != (bEmpty ? 0 : tile->salt)
+			|| tileIslands[iTile]->PolyLocalIslands.Num() != (bEmpty ? 0 : tile->header->polyCount))
+			changedTiles.Add(iTile);
+	}
+
+	if (changedTiles.Num() == 0)
+		return;
+
+	// tiles linked to the changed ones before or after the change have had their links to them rewired, too
+	TSet<int32> updatedTiles(changedTiles);
+	for (const int32 changedTile : changedTiles)
+	{
+		if (tileIslands[changedTile].IsValid())
+			for (const FNavmeshExternalLink& externalLink : tileIslands[changedTile]->ExternalLinks)
+				updatedTiles.Add(externalLink.NeighbourTile);
+
+		tileIslands[changedTile] = BuildTileIslands(detourMesh, changedTile);
+		for (const FNavmeshExternalLink& externalLink : tileIslands[changedTile]->ExternalLinks)
+			updatedTiles.Add(externalLink.NeighbourTile);
+	}
+	for (const int32 updatedTile : updatedTiles)
+		if (updatedTile < nTiles && !changedTiles.Contains(updatedTile))
+			tileIslands[updatedTile] = BuildTileIslands(detourMesh, updatedTile);
+
+	// flatten the local islands of all the tiles into a single index space
+	TArray<int32> tileIslandOffsets;
+	tileIslandOffsets.SetNumUninitialized(nTiles);
+	int32 nLocalIslands = 0;
+	for (int32 iTile = 0; iTile < nTiles; iTile++)
+	{
+		tileIslandOffsets[iTile] = nLocalIslands;
+		nLocalIslands += tileIslands[iTile]->LocalIslandCount;
+	}
+
+	// join the local islands across tile borders
+	TArray<int32> parents;
+	parents.SetNumUninitialized(nLocalIslands);
+	for (int32 iLocalIsland = 0; iLocalIsland < nLocalIslands; iLocalIsland++)
+		parents[iLocalIsland] = iLocalIsland;
+
+	for (int32 iTile = 0; iTile < nTiles; iTile++)
+		for (const FNavmeshExternalLink& externalLink : tileIslands[iTile]->ExternalLinks)
+		{
+			if (externalLink.NeighbourTile >= nTiles)
+				continue;
+
+			const FNavmeshTileIslands& neighbourIslands = *tileIslands[externalLink.NeighbourTile];
+			if (externalLink.NeighbourPoly >= neighbourIslands.PolyLocalIslands.Num())
+				continue;
+
+			JoinIslands(parents,
+				tileIslandOffsets[iTile] + externalLink.LocalIsland,
+				tileIslandOffsets[externalLink.NeighbourTile] + neighbourIslands.PolyLocalIslands[externalLink.NeighbourPoly]);
+		}
+
+	// number the islands
+	TArray<int32> localIslands;
+	TArray<int32> rootIslands;
+	localIslands.SetNumUninitialized(nLocalIslands);
+	rootIslands.Init(INDEX_NONE, nLocalIslands);
+	int32 nIslands = 0;
+	for (int32 iLocalIsland = 0; iLocalIsland < nLocalIslands; iLocalIsland++)
+	{
+		int32& rootIsland = rootIslands[FindIslandRoot(parents, iLocalIsland)];
+		if (rootIsland == INDEX_NONE)
+			rootIsland = nIslands++;
+
+		localIslands[iLocalIsland] = rootIsland;
+	}
+
+	FRWScopeLock IslandLock(IslandLockObject, FRWScopeLockType::SLT_Write);
+	Navmesh = _Navmesh;
+	DetourMesh = detourMesh;
+	TileIslands = MoveTemp(tileIslands);
+	TileIslandOffsets = MoveTemp(tileIslandOffsets);
+	LocalIslands = MoveTemp(localIslands);
+	IslandCount = nIslands;
+
+	SET_DWORD_STAT(STAT_NavmeshIslandCount, nIslands);
+}
+
+void FNavmeshIslands::Reset()
+{
+	FRWScopeLock IslandLock(IslandLockObject, FRWScopeLockType::SLT_Write);
+	Navmesh.Reset();
+	DetourMesh = nullptr;
+	TileIslands.Empty();
+	TileIslandOffsets.Empty();
+	LocalIslands.Empty();
+	IslandCount = 0;
+}
+
+int32 FNavmeshIslands::GetIslandUnsafe(NavNodeRef PolyRef) const
+{
+	if (PolyRef == INVALID_NAVNODEREF || !Navmesh.IsValid())
+		return INDEX_NONE;
+
+	// the detour mesh gets replaced when the whole navmesh is rebuilt
+	const dtNavMesh* detourMesh = Navmesh->GetRecastMesh();
+	if (!detourMesh || detourMesh != DetourMesh)
+		return INDEX_NONE;
+
+	unsigned int salt, tileIdx, polyIdx;
+	detourMesh->decodePolyId(PolyRef, salt, tileIdx, polyIdx);
+	if (static_cast<int32>(tileIdx) >= TileIslands.Num())
+		return INDEX_NONE;
+
+	const FNavmeshTileIslands& tileIslands = *TileIslands[tileIdx];
+	if (tileIslands.Salt != salt || static_cast<int32>(polyIdx) >= tileIslands.PolyLocalIslands.Num())
+		return INDEX_NONE;
+
+	return LocalIslands[TileIslandOffsets[tileIdx] + tileIslands.PolyLocalIslands[polyIdx]];
+}
+
+int32 FNavmeshIslands::GetIsland(NavNodeRef PolyRef) const
+{
+	FRWScopeLock IslandLock(IslandLockObject, FRWScopeLockType::SLT_ReadOnly);
+	return GetIslandUnsafe(PolyRef);
+}
+
+ENavmeshReachability FNavmeshIslands::GetReachability(NavNodeRef FromPolyRef, NavNodeRef ToPolyRef) const
+{
+	FRWScopeLock IslandLock(IslandLockObject, FRWScopeLockType::SLT_ReadOnly);
+	const int32 fromIsland = GetIslandUnsafe(FromPolyRef);
+	const int32 toIsland = GetIslandUnsafe(ToPolyRef);
+	if (fromIsland == INDEX_NONE || toIsland == INDEX_NONE)
+		return ENavmeshReachability::Unknown;
+
+	return fromIsland == toIsland ? ENavmeshReachability::Reachable : ENavmeshReachability::Unreachable;
+}
@@ -0,0 +1,387 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "CoverSystem/TileCoverGenerationDispatcher.h"
+#include "Tasks/NavmeshCoverPointGeneratorTask.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/Pawn.h"
+#include "AIController.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "Async/Async.h"
+
+FThreadSafeCounter FTileCoverGenerationDispatcher::TasksInFlight;
+FCriticalSection FTileCoverGenerationDispatcher::TaskStatsLockObject;
+double FTileCoverGenerationDispatcher::AverageTaskCost = FTileCoverGenerationDispatcher::InitialTaskCost;
+double FTileCoverGenerationDispatcher::AverageLatency = 0.0;
+double FTileCoverGenerationDispatcher::MaxLatency = 0.0;
+
+// Heap predicate that puts the most urgent tile on top.
+static bool IsMoreUrgent(const FPendingCoverTile& A, const FPendingCoverTile& B)
+{
+	return A.Priority < B.Priority;
+}
+
+FTileCoverGenerationDispatcher::FTileCoverGenerationDispatcher(UWorld* _World, float _CoverPointMinDistance, float _SmallestAgentHeight, float _CoverPointGroundOffset)
+	: MaxTasksInFlight(FMath::Max(1, GThreadPool ? GThreadPool->GetNumThreads() / 2 : 1)), // leave the rest of the pool to actor generation and the engine
+	CoverPointMinDistance(_CoverPointMinDistance),
+	SmallestAgentHeight(_SmallestAgentHeight),
+	CoverPointGroundOffset(_CoverPointGroundOffset),
+	World(_World)
+{
+	for (std::atomic<uint32>& recentQuerySequence : RecentQuerySequences)
+		recentQuerySequence.store(0, std::memory_order_relaxed);
+
+	FScopeLock TaskStatsLock(&TaskStatsLockObject);
+	AverageTaskCost = InitialTaskCost;
+	AverageLatency = 0.0;
+	MaxLatency = 0.0;
+}
+
+FTileCoverGenerationDispatcher::~FTileCoverGenerationDispatcher()
+{
+	if (World.IsValid())
+	{
+		World->GetTimerManager().ClearTimer(DispatchTimerHandle);
+		World->GetTimerManager().ClearTimer(PrefetchTimerHandle);
+	}
+
+	PendingTiles.Empty();
+	PendingTileIndices.Empty();
+	ResetLazyTiles();
+	SET_DWORD_STAT(STAT_TileGenerationQueueDepth, 0);
+}
+
+void FTileCoverGenerationDispatcher::QueueTile(uint32 TileIdx, double UpdateTime, const FBox& TileBounds, const TArray<FBox>& DirtyAreas, bool bLazy)
+{
+	// which tiles have been generated only matters in lazy mode, don't bother with the lock otherwise
+	if (bLazy)
+	{
+		FScopeLock DormantTileLock(&DormantTileLockObject);
+		if (!AwakeTiles.Contains(TileIdx))
+		{
+			// nothing to regenerate partially as the tile has never been generated, it'll be generated as a whole once woken up
+			DormantTiles.Add(TileIdx, TileBounds);
+			DormantTileCount.store(DormantTiles.Num(), std::memory_order_relaxed);
+			SET_DWORD_STAT(STAT_TileGenerationCoverPendingCount, DormantTiles.Num());
+			SchedulePrefetch();
+			return;
+		}
+	}
+
+	bool bAlreadyPending;
+	PendingTileIndices.Add(TileIdx, &bAlreadyPending);
+	if (!bAlreadyPending)
+		PendingTiles.Add(FPendingCoverTile(TileIdx, UpdateTime, TileBounds, DirtyAreas));
+	else
+	{
+		// a tile that's already regenerated as a whole stays that way, otherwise the dirty areas add up
+		FPendingCoverTile* pendingTile = PendingTiles.FindByPredicate([TileIdx](const FPendingCoverTile& PendingTile) { return PendingTile.TileIdx == TileIdx; });
+		if (pendingTile && pendingTile->DirtyAreas.Num() > 0)
+		{
+			if (DirtyAreas.Num() > 0)
+				pendingTile->DirtyAreas.Append(DirtyAreas);
+			else
+				pendingTile->DirtyAreas.Reset();
+		}
+	}
+
+	SET_DWORD_STAT(STAT_TileGenerationQueueDepth, PendingTiles.Num());
+}
+
+void FTileCoverGenerationDispatcher::RecordQuery(const FBox& QueryBox)
+{
+	const int32 iSlot = NextRecentQuery.fetch_add(1, std::memory_order_relaxed) % MaxRecentQueries;
+
+	// claim the slot by making its sequence odd, unless another thread is still writing it
+	std::atomic<uint32>& sequence = RecentQuerySequences[iSlot];
+	uint32 slotSequence = sequence.load(std::memory_order_relaxed);
+	if ((slotSequence & 1) || !sequence.compare_exchange_strong(slotSequence, slotSequence + 1, std::memory_order_acquire, std::memory_order_relaxed))
+		return;
+
+	RecentQueries[iSlot] = FRecentCoverQuery(QueryBox, FPlatformTime::Seconds());
+	sequence.store(slotSequence + 2, std::memory_order_release);
+}
+
+bool FTileCoverGenerationDispatcher::WakeTiles(const FBox& Area)
+{
+	FScopeLock DormantTileLock(&DormantTileLockObject);
+	if (DormantTiles.Num() == 0)
+		return false;
+
+	const int32 nWokenTiles = WokenTiles.Num();
+	for (auto itDormantTile = DormantTiles.CreateIterator(); itDormantTile; ++itDormantTile)
+		if (Area.Intersect(itDormantTile->Value))
+		{
+			WokenTiles.Add(TPair<uint32, FBox>(itDormantTile->Key, itDormantTile->Value));
+			AwakeTiles.Add(itDormantTile->Key);
+			itDormantTile.RemoveCurrent();
+		}
+	DormantTileCount.store(DormantTiles.Num(), std::memory_order_relaxed);
+
+	if (WokenTiles.Num() == nWokenTiles)
+		return false;
+
+	INC_DWORD_STAT_BY(STAT_TileGenerationWokenCount, WokenTiles.Num() - nWokenTiles);
+	SET_DWORD_STAT(STAT_TileGenerationCoverPendingCount, DormantTiles.Num());
+	return true;
+}
+
+void FTileCoverGenerationDispatcher::QueueWokenTiles(bool bSynchronous)
+{
+	TArray<TPair<uint32, FBox>> wokenTiles;
+	{
+		FScopeLock DormantTileLock(&DormantTileLockObject);
+		wokenTiles = MoveTemp(WokenTiles);
+		WokenTiles.Reset();
+	}
+
+	if (wokenTiles.Num() == 0)
+		return;
+
+	// latency is measured from when the tiles have been woken up, as that's when someone started waiting for them
+	const double wakeTime = FPlatformTime::Seconds();
+	for (const TPair<uint32, FBox>& wokenTile : wokenTiles)
+		if (bSynchronous)
+		{
+			FPendingCoverTile pendingTile(wokenTile.Key, wakeTime, wokenTile.Value, TArray<FBox>());
+			StartTask(pendingTile, true);
+		}
+		else
+			QueueTile(wokenTile.Key, wakeTime, wokenTile.Value, TArray<FBox>());
+
+	Dispatch();
+}
+
+void FTileCoverGenerationDispatcher::ResetLazyTiles()
+{
+	FScopeLock DormantTileLock(&DormantTileLockObject);
+	DormantTiles.Empty();
+	DormantTileCount.store(0, std::memory_order_relaxed);
+	AwakeTiles.Empty();
+	WokenTiles.Empty();
+	SET_DWORD_STAT(STAT_TileGenerationCoverPendingCount, 0);
+}
+
+void FTileCoverGenerationDispatcher::SchedulePrefetch()
+{
+	if (!World.IsValid())
+		return;
+
+	FTimerManager& timerManager = World->GetTimerManager();
+	if (!timerManager.IsTimerActive(PrefetchTimerHandle))
+		timerManager.SetTimer(PrefetchTimerHandle, FTimerDelegate::CreateRaw(this, &FTileCoverGenerationDispatcher::Prefetch), PrefetchInterval, false);
+}
+
+void FTileCoverGenerationDispatcher::Prefetch()
+{
+	if (UCoverSystem::bShutdown || !World.IsValid())
+		return;
+
+	// pawns of both AI and players, where they are, where they're extrapolated to be and where AI is pathing to
+	TArray<FVector> prefetchLocations;
+	for (FConstControllerIterator itController = World->GetControllerIterator(); itController; ++itController)
+	{
+		const AController* controller = itController->Get();
+		if (!IsValid(controller))
+			continue;
+
+		const APawn* pawn = controller->GetPawn();
+		if (!IsValid(pawn))
+			continue;
+
+		const FVector pawnLocation = pawn->GetActorLocation();
+		prefetchLocations.Add(pawnLocation);
+		prefetchLocations.Add(pawnLocation + pawn->GetVelocity() * PrefetchPredictionTime);
+
+		const AAIController* aiController = Cast<AAIController>(controller);
+		const UPathFollowingComponent* pathFollowing = aiController ? aiController->GetPathFollowingComponent() : nullptr;
+		if (pathFollowing && pathFollowing->GetStatus() == EPathFollowingStatus::Moving && pathFollowing->GetPath().IsValid())
+			prefetchLocations.Add(pathFollowing->GetPath()->GetEndLocation());
+	}
+
+	bool bWokeTiles = false;
+	for (const FVector& prefetchLocation : prefetchLocations)
+		bWokeTiles |= WakeTiles(FBox::BuildAABB(prefetchLocation, FVector(PrefetchRadius)));
+
+	if (bWokeTiles)
+		QueueWokenTiles();
+
+	FScopeLock DormantTileLock(&DormantTileLockObject);
+	if (DormantTiles.Num() > 0)
+		SchedulePrefetch();
+}
+
+void FTileCoverGenerationDispatcher::GatherInterest(TArray<FVector>& OutInterestLocations, TArray<FBox>& OutRecentQueryBoxes)
+{
+	// pawns of both AI and players
+	for (FConstControllerIterator itController = World->GetControllerIterator(); itController; ++itController)
+	{
+		const AController* controller = itController->Get();
+		if (!IsValid(controller))
+			continue;
+
+		const APawn* pawn = controller->GetPawn();
+		if (IsValid(pawn))
+			OutInterestLocations.Add(pawn->GetActorLocation());
+	}
+
+	// recent cover queries
+	// slots that are being written or have been overwritten while copying them are skipped
+	const double oldestQueryTime = FPlatformTime::Seconds() - RecentQueryLifetime;
+	for (int32 iSlot = 0; iSlot < MaxRecentQueries; iSlot++)
+	{
+		const uint32 slotSequence = RecentQuerySequences[iSlot].load(std::memory_order_acquire);
+		if (slotSequence == 0 || (slotSequence & 1))
+			continue;
+
+		const FRecentCoverQuery query = RecentQueries[iSlot];
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (RecentQuerySequences[iSlot].load(std::memory_order_relaxed) != slotSequence)
+			continue;
+
+		if (query.QueryTime >= oldestQueryTime)
+		{
+			OutInterestLocations.Add(query.QueryBox.GetCenter());
+			OutRecentQueryBoxes.Add(query.QueryBox);
+		}
+	}
+}
+
+void FTileCoverGenerationDispatcher::PrioritizePendingTiles()
+{
+	// profiling
+	SCOPE_CYCLE_COUNTER(STAT_TileGenerationPrioritize);
+
+	TArray<FVector> interestLocations;
+	TArray<FBox> recentQueryBoxes;
+	GatherInterest(interestLocations, recentQueryBoxes);
+
+	const double now = FPlatformTime::Seconds();
+	for (FPendingCoverTile& pendingTile : PendingTiles)
+	{
+		// distance to the closest point of interest, or none if there's nothing going on
+		const FVector tileCenter = pendingTile.Bounds.GetCenter();
+		float closestDistanceSquared = interestLocations.Num() > 0 ? MAX_flt : 0.0f;
+		for (const FVector& interestLocation : interestLocations)
+			closestDistanceSquared = FMath::Min(closestDistanceSquared, static_cast<float>(FVector::DistSquared(tileCenter, interestLocation)));
+
+		pendingTile.Priority = FMath::Sqrt(closestDistanceSquared) - AgingRate * static_cast<float>(now - pendingTile.UpdateTime);
+
+		// someone's waiting for cover in this tile
+		for (const FBox& queryBox : recentQueryBoxes)
+			if (queryBox.Intersect(pendingTile.Bounds))
+			{
+				pendingTile.Priority -= PendingQueryBonus;
+				break;
+			}
+	}
+
+	PendingTiles.Heapify(IsMoreUrgent);
+}
+
+void FTileCoverGenerationDispatcher::ScheduleDispatch()
+{
+	if (!World.IsValid())
+		return;
+
+	FTimerManager& timerManager = World->GetTimerManager();
+	if (!timerManager.IsTimerActive(DispatchTimerHandle))
+		timerManager.SetTimer(DispatchTimerHandle, FTimerDelegate::CreateRaw(this, &FTileCoverGenerationDispatcher::Dispatch), GetDispatchInterval(), false);
+}
+
+void FTileCoverGenerationDispatcher::Dispatch()
+{
+	if (UCoverSystem::bShutdown || !World.IsValid() || PendingTiles.Num() == 0)
+		return;
+
+	UCoverSystem* coverSystem = UCoverSystem::GetInstance(World.Get());
+
+	PrioritizePendingTiles();
+
+#if DEBUG_RENDERING
+	// DrawDebugXXX calls may crash UE4 when not called from the main thread, so run every tile synchronously in case we're planning on drawing debug shapes
+	const bool bSynchronous = coverSystem->bDebugDraw;
+#else
+	const bool bSynchronous = false;
+#endif
+
+	FPendingCoverTile pendingTile;
+	while (PendingTiles.Num() > 0 && (bSynchronous || TasksInFlight.GetValue() < MaxTasksInFlight))
+	{
+		PendingTiles.HeapPop(pendingTile, IsMoreUrgent, false);
+		PendingTileIndices.Remove(pendingTile.TileIdx);
+		StartTask(pendingTile, bSynchronous);
+	}
+
+	SET_DWORD_STAT(STAT_TileGenerationQueueDepth, PendingTiles.Num());
+	SET_DWORD_STAT(STAT_TileGenerationTasksInFlight, TasksInFlight.GetValue());
+
+	if (PendingTiles.Num() > 0)
+		ScheduleDispatch();
+}
+
+void FTileCoverGenerationDispatcher::StartTask(FPendingCoverTile& PendingTile, bool bSynchronous)
+{
+	TasksInFlight.Increment();
+
+	FAutoDeleteAsyncTask<FNavmeshCoverPointGeneratorTask>* task = new FAutoDeleteAsyncTask<FNavmeshCoverPointGeneratorTask>(
+		CoverPointMinDistance,
+		SmallestAgentHeight,
+		CoverPointGroundOffset,
+		UCoverSystem::GetInstance(World.Get())->MapBounds,
+		PendingTile.TileIdx,
+		World.Get(),
+		PendingTile.UpdateTime,
+		true,
+		MoveTemp(PendingTile.DirtyAreas)
+	);
+
+	if (bSynchronous)
+		task->StartSynchronousTask();
+	else
+		task->StartBackgroundTask();
+}
+
+float FTileCoverGenerationDispatcher::GetDispatchInterval() const
+{
+	const int32 tasksInFlight = TasksInFlight.GetValue();
+	if (tasksInFlight < MaxTasksInFlight && PendingTiles.Num() == 0)
+		return MinDispatchInterval;
+
+	double averageTaskCost;
+	{
+		FScopeLock TaskStatsLock(&TaskStatsLockObject);
+		averageTaskCost = AverageTaskCost;
+	}
+
+	// estimated time until the tasks in flight and the queued tiles are all done
+	const double backlogTime = averageTaskCost * (tasksInFlight + PendingTiles.Num()) / MaxTasksInFlight;
+	return FMath::Clamp(static_cast<float>(backlogTime), MinDispatchInterval, MaxDispatchInterval);
+}
+
+void FTileCoverGenerationDispatcher::OnTaskFinished(UWorld* World, double TaskCost, double Latency)
+{
+	TasksInFlight.Decrement();
+	SET_DWORD_STAT(STAT_TileGenerationTasksInFlight, TasksInFlight.GetValue());
+
+	// a task slot has just freed up, queued tiles can only be dispatched on the game thread
+	AsyncTask(ENamedThreads::GameThread, [world = TWeakObjectPtr<UWorld>(World)]() {
+		if (!UCoverSystem::bShutdown && world.IsValid())
+			UCoverSystem::GetInstance(world.Get())->DispatchQueuedTiles();
+	});
+
+	// tasks that bailed out early would drag the average cost down
+	if (TaskCost <= 0.0)
+		return;
+
+	FScopeLock TaskStatsLock(&TaskStatsLockObject);
+	AverageTaskCost = FMath::Lerp(AverageTaskCost, TaskCost, MovingAverageWeight);
+	SET_FLOAT_STAT(STAT_TileGenerationAverageTaskCost, AverageTaskCost * 1000.0);
+
+	if (Latency < 0.0)
+		return;
+
+	AverageLatency = AverageLatency > 0.0 ? FMath::Lerp(AverageLatency, Latency, MovingAverageWeight) : Latency;
+	MaxLatency = FMath::Max(MaxLatency, Latency);
+	SET_FLOAT_STAT(STAT_TileGenerationAverageLatency, AverageLatency * 1000.0);
+	SET_FLOAT_STAT(STAT_TileGenerationMaxLatency, MaxLatency * 1000.0);
+}
@@ -0,0 +1,39 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#include "Debug/CoverFinderVisData.h"
+
+UCoverFinderVisData::UCoverFinderVisData()
+{
+	DebugPoints.Reserve(MaxDebugPoints);
+	DebugArrows.Reserve(MaxDebugArrows);
+}
+
+void UCoverFinderVisData::AddDebugPoint(const FDebugPoint& DebugPoint)
+{
+	if (DebugPoints.Num() < MaxDebugPoints)
+		DebugPoints.Add(DebugPoint);
+	else
+	{
+		DebugPoints[NextDebugPoint] = DebugPoint;
+		NextDebugPoint = (NextDebugPoint + 1) % MaxDebugPoints;
+	}
+}
+
+void UCoverFinderVisData::AddDebugArrow(const FDebugArrow& DebugArrow)
+{
+	if (DebugArrows.Num() < MaxDebugArrows)
+		DebugArrows.Add(DebugArrow);
+	else
+	{
+		DebugArrows[NextDebugArrow] = DebugArrow;
+		NextDebugArrow = (NextDebugArrow + 1) % MaxDebugArrows;
+	}
+}
+
+void UCoverFinderVisData::Reset()
+{
+	DebugPoints.Reset();
+	DebugArrows.Reset();
+	NextDebugPoint = 0;
+	NextDebugArrow = 0;
+}
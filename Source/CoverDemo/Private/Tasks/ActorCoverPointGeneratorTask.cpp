@@ -1,6 +1,8 @@
 // Copyright (c) 2018 David Nadaski. All Rights Reserved.
 
 #include "Tasks/ActorCoverPointGeneratorTask.h"
+#include "CoverSystem/ActorCoverGenerationScheduler.h"
+#include "Async/ParallelFor.h"
 
 #if DEBUG_RENDERING
 #include "DrawDebugHelpers.h"
@@ -12,22 +14,60 @@ FActorCoverPointGeneratorTask::FActorCoverPointGeneratorTask(
 	float _BoundingBoxExpansion,
 	float _ScanGridUnit,
 	float _SmallestAgentHeight,
-	bool _bGeneratePerStaticMesh)
+	bool _bGeneratePerStaticMesh,
+	bool _bUseMeshCoverTemplates,
+	bool _bGeneratePerInstance,
+	bool _bScheduled)
 	: Owner(_Owner),
+	CoverObjects({ _Owner }),
+	CoverObjectBounds(),
+	MergedBounds(ForceInit),
+	bScheduled(_bScheduled),
 	World(_World),
 	BoundingBoxExpansion(_BoundingBoxExpansion),
 	ScanGridUnit(_ScanGridUnit),
 	SmallestAgentHeight(_SmallestAgentHeight),
-	bGeneratePerStaticMesh(_bGeneratePerStaticMesh)
+	bGeneratePerStaticMesh(_bGeneratePerStaticMesh || _bUseMeshCoverTemplates),
+	bGeneratePerInstance(_bGeneratePerInstance),
+	bUseMeshCoverTemplates(_bUseMeshCoverTemplates)
 {}
 
+FActorCoverPointGeneratorTask::FActorCoverPointGeneratorTask(
+	const TArray<AActor*>& _CoverObjects,
+	const TArray<FBox>& _CoverObjectBounds,
+	const FBox& _MergedBounds,
+	UWorld* _World,
+	float _BoundingBoxExpansion,
+	float _ScanGridUnit,
+	float _SmallestAgentHeight)
+	: Owner(_CoverObjects[0]),
+	CoverObjects(_CoverObjects),
+	CoverObjectBounds(_CoverObjectBounds),
+	MergedBounds(_MergedBounds),
+	bScheduled(true),
+	World(_World),
+	BoundingBoxExpansion(_BoundingBoxExpansion),
+	ScanGridUnit(_ScanGridUnit),
+	SmallestAgentHeight(_SmallestAgentHeight),
+	bGeneratePerStaticMesh(false),
+	bGeneratePerInstance(false),
+	bUseMeshCoverTemplates(false)
+{}
+
+FActorCoverPointGeneratorTask::~FActorCoverPointGeneratorTask()
+{
+	// let the scheduler know that it can dispatch another task, regardless of how DoWork() went
+	if (bScheduled)
+		FActorCoverGenerationScheduler::OnTaskFinished();
+}
+
 const bool FActorCoverPointGeneratorTask::FindGroundPoint(FVector& OutGroundPoint, const FVector Location) const
 {
 	// trace downwards by grid size
 	FHitResult hit;
 	FCollisionQueryParams collQueryParams;
 	collQueryParams.bFindInitialOverlaps;
-	collQueryParams.AddIgnoredActor(Owner);
+	collQueryParams.AddIgnoredActors(CoverObjects);
 	collQueryParams.TraceTag = "CoverGenerator_FindGroundPoint";
 
 	bool result = World->LineTraceSingleByChannel(hit, Location, Location - FVector(0.0f, 0.0f, ScanGridUnit), ECollisionChannel::ECC_GameTraceChannel1, collQueryParams);
@@ -60,13 +100,8 @@ void FActorCoverPointGeneratorTask::GatherFreeGridPoints(TArray<FVector>& OutGri
 	}
 }
 
-void FActorCoverPointGeneratorTask::GenerateCoverInBounds(TArray<FDTOCoverData>& OutCoverPointsOfActors, FBox& Bounds)
+void FActorCoverPointGeneratorTask::GatherCandidateGridPoints(TArray<FVector>& OutGridPoints, FBox Bounds, const UPrimitiveComponent* BlockingComponent, const int32 BlockingItem)
 {
-	// profiling
-	SCOPE_CYCLE_COUNTER(STAT_GenerateCoverInBounds);
-	INC_DWORD_STAT(STAT_GenerateCoverHistoricalCount);
-	SCOPE_SECONDS_ACCUMULATOR(STAT_GenerateCoverAverageTime);
-
 	// expand the bounding box by a predetermined amount
 	Bounds = Bounds.ExpandBy(ScanGridUnit * BoundingBoxExpansion);
 
@@ -78,7 +113,6 @@ void FActorCoverPointGeneratorTask::GenerateCoverInBounds(TArray<FDTOCoverData>&
 	const int gridCountX = FMath::FloorToInt(boundsLengthX / ScanGridUnit) + 2;
 	const int gridCountY = FMath::FloorToInt(boundsLengthY / ScanGridUnit) + 2;
 	const int gridCountZ = FMath::FloorToInt(boundsLengthZ / ScanGridUnit) + 2;
-	const FVector navProjectionExtent = FVector(ScanGridUnit * 5, ScanGridUnit * 5, ScanGridUnit * 1.5f);
 	const float navPointEqualityTolerance = ScanGridUnit * 0.5f;
 
 #if DEBUG_RENDERING
@@ -91,6 +125,11 @@ void FActorCoverPointGeneratorTask::GenerateCoverInBounds(TArray<FDTOCoverData>&
 	collQueryParams.bFindInitialOverlaps = true;
 	collQueryParams.TraceTag = "CoverGenerator_GenerateCoverPoints";
 
+	// trace the blocking component's own body rather than the world, so that neighbouring actors or instances can't hide it
+	const FBodyInstance* blockingBody = BlockingComponent ? BlockingComponent->GetBodyInstance(NAME_None, true, BlockingItem) : nullptr;
+	const bool bBlockingBodyBlocks = blockingBody && BlockingComponent->GetCollisionResponseToChannel(ECollisionChannel::ECC_GameTraceChannel1) == ECollisionResponse::ECR_Block;
+	const FCollisionShape startOverlapShape = FCollisionShape::MakeSphere(1.0f);
+
 	TArray<FVector> freeGridPoints;
 	TArray<FVector> blockedGridPoints;
 
@@ -114,8 +153,20 @@ void FActorCoverPointGeneratorTask::GenerateCoverInBounds(TArray<FDTOCoverData>&
 
 				// start location: ground position + minCoverHeight on the Z-axis
 				// end location: ground position + SmallestAgentHeight on the Z-axis
-				bool traceResult = World->LineTraceSingleByChannel(hit, groundPoint + FVector(0.0f, 0.0f, minCoverHeight), groundPoint + FVector(0.0f, 0.0f, SmallestAgentHeight), ECollisionChannel::ECC_GameTraceChannel1, collQueryParams);
-				if (!traceResult && !hit.bStartPenetrating)
+				const FVector traceStart = groundPoint + FVector(0.0f, 0.0f, minCoverHeight);
+				const FVector traceEnd = groundPoint + FVector(0.0f, 0.0f, SmallestAgentHeight);
+				bool bBlocked;
+				if (!BlockingComponent)
+				{
+					const bool traceResult = World->LineTraceSingleByChannel(hit, traceStart, traceEnd, ECollisionChannel::ECC_GameTraceChannel1, collQueryParams);
+					bBlocked = traceResult || hit.bStartPenetrating;
+				}
+				else
+					// anything other than BlockingComponent, or the instance BlockingItem of it, is treated as free space
+					bBlocked = bBlockingBodyBlocks
+						&& (blockingBody->LineTrace(hit, traceStart, traceEnd, collQueryParams.bTraceComplex)
+							|| blockingBody->OverlapTest(traceStart, FQuat::Identity, startOverlapShape));
+				if (!bBlocked)
 					// encountered a non-blocking hit
 					freeGridPoints.Add(groundPoint);
 				else
@@ -125,21 +176,45 @@ void FActorCoverPointGeneratorTask::GenerateCoverInBounds(TArray<FDTOCoverData>&
 		}
 	}
 
-	TArray<FVector> finalGridPoints;
-
-	// find the nearest free grid points to each blocked grid point and project them onto the navmesh
+	// find the nearest free grid points to each blocked grid point
 	for (const FVector blockedGridPoint : blockedGridPoints)
 		for (int x = -1; x <= 1; x++)
 			for (int y = -1; y <= 1; y++)
 				for (int z = -1; z <= 1; z++)
-					GatherFreeGridPoints(finalGridPoints, FVector(blockedGridPoint.X + ScanGridUnit * x, blockedGridPoint.Y + ScanGridUnit * y, blockedGridPoint.Z + ScanGridUnit * z), freeGridPoints, navPointEqualityTolerance);
+					GatherFreeGridPoints(OutGridPoints, FVector(blockedGridPoint.X + ScanGridUnit * x, blockedGridPoint.Y + ScanGridUnit * y, blockedGridPoint.Z + ScanGridUnit * z), freeGridPoints, navPointEqualityTolerance);
+}
+
+AActor* FActorCoverPointGeneratorTask::GetCoverObjectAt(const FVector& Location) const
+{
+	if (CoverObjectBounds.Num() < 2)
+		return Owner;
 
-	// filter out any near-duplicates, i.e. vectors that are too close to one another
+	int32 iNearestCoverObject = 0;
+	float nearestDistanceSquared = TNumericLimits<float>::Max();
+	for (int32 iCoverObject = 0; iCoverObject < CoverObjectBounds.Num(); iCoverObject++)
+	{
+		const float distanceSquared = CoverObjectBounds[iCoverObject].ComputeSquaredDistanceToPoint(Location);
+		if (distanceSquared < nearestDistanceSquared)
+		{
+			nearestDistanceSquared = distanceSquared;
+			iNearestCoverObject = iCoverObject;
+		}
+	}
+
+	return CoverObjects[iNearestCoverObject];
+}
+
+void FActorCoverPointGeneratorTask::ProjectCandidatesToNavmesh(TArray<FDTOCoverData>& OutCoverPointsOfActors, const TArray<FVector>& CandidatePoints, float MaxProjectionHeight)
+{
+	const FVector navProjectionExtent = FVector(ScanGridUnit * 5, ScanGridUnit * 5, MaxProjectionHeight >= 0.0f ? MaxProjectionHeight : ScanGridUnit * 1.5f);
+	const float navPointEqualityTolerance = ScanGridUnit * 0.5f;
+
+	// project the candidates onto the navmesh and filter out any near-duplicates, i.e. vectors that are too close to one another
 	FNavLocation navLocation;
 	bool bUnique;
-	for (FVector finalGridPoint : finalGridPoints)
+	for (const FVector candidatePoint : CandidatePoints)
 	{
-		if (UNavigationSystemV1::GetCurrent(World)->ProjectPointToNavigation(finalGridPoint, navLocation, navProjectionExtent))
+		if (UNavigationSystemV1::GetCurrent(World)->ProjectPointToNavigation(candidatePoint, navLocation, navProjectionExtent))
 		{
 			bUnique = true;
 			for (const FDTOCoverData coverPoint : OutCoverPointsOfActors)
@@ -152,9 +227,156 @@ void FActorCoverPointGeneratorTask::GenerateCoverInBounds(TArray<FDTOCoverData>&
 				}
 
 			if (bUnique)
-				OutCoverPointsOfActors.Add(FDTOCoverData(Owner, navLocation.Location, ECC_GameTraceChannel2 == Owner->GetRootComponent()->GetCollisionObjectType()));
+			{
+				AActor* coverObject = GetCoverObjectAt(navLocation.Location);
+				OutCoverPointsOfActors.Add(FDTOCoverData(coverObject, navLocation.Location, ECC_GameTraceChannel2 == coverObject->GetRootComponent()->GetCollisionObjectType()));
+			}
+		}
+	}
+}
+
+void FActorCoverPointGeneratorTask::GenerateCoverInBounds(TArray<FDTOCoverData>& OutCoverPointsOfActors, FBox& Bounds)
+{
+	// profiling
+	SCOPE_CYCLE_COUNTER(STAT_GenerateCoverInBounds);
+	INC_DWORD_STAT(STAT_GenerateCoverHistoricalCount);
+	SCOPE_SECONDS_ACCUMULATOR(STAT_GenerateCoverAverageTime);
+
+	TArray<FVector> candidatePoints;
+	GatherCandidateGridPoints(candidatePoints, Bounds);
+	ProjectCandidatesToNavmesh(OutCoverPointsOfActors, candidatePoints);
+}
+
+bool FActorCoverPointGeneratorTask::GenerateCoverFromMeshTemplate(
+	TArray<FDTOCoverData>& OutCoverPointsOfActors,
+	const UStaticMesh* StaticMesh,
+	const FTransform& MeshTransform,
+	const FBox& MeshBounds,
+	const UPrimitiveComponent* MeshComponent,
+	const int32 InstanceIndex)
+{
+	// profiling
+	SCOPE_CYCLE_COUNTER(STAT_GenerateCoverInBounds);
+
+	if (!IsValid(StaticMesh))
+		return false;
+
+	// the grid scan looks for cover along the Z-axis, so templates of tilted meshes wouldn't be valid for other instances
+	const FRotator meshRotation = MeshTransform.Rotator();
+	if (FMath::Abs(meshRotation.Pitch) > MeshCoverTemplateMaxTilt
+		|| FMath::Abs(meshRotation.Roll) > MeshCoverTemplateMaxTilt)
+		return false;
+
+	if (UCoverSystem::bShutdown)
+		return false;
+	UCoverSystem* coverSystem = UCoverSystem::GetInstance(World);
+
+	const FMeshCoverTemplateKey templateKey(StaticMesh, MeshTransform.GetScale3D());
+	TArray<FVector> candidatePoints;
+	if (coverSystem->FindMeshCoverTemplate(candidatePoints, templateKey))
+	{
+		INC_DWORD_STAT(STAT_MeshCoverTemplateHits);
+
+		// move the mesh-local candidates over to the new instance
+		for (FVector& candidatePoint : candidatePoints)
+			candidatePoint = MeshTransform.TransformPosition(candidatePoint);
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_MeshCoverTemplateMisses);
+
+		// first instance of this mesh: scan it, but only consider the mesh's own geometry so that the results are valid for every other instance, too
+		GatherCandidateGridPoints(candidatePoints, MeshBounds, MeshComponent, InstanceIndex);
+
+		TArray<FVector> localCandidatePoints;
+		localCandidatePoints.Reserve(candidatePoints.Num());
+		for (const FVector candidatePoint : candidatePoints)
+			localCandidatePoints.Add(MeshTransform.InverseTransformPosition(candidatePoint));
+
+		coverSystem->AddMeshCoverTemplate(templateKey, localCandidatePoints);
+	}
+
+	// validate the candidates of this instance with a single navmesh projection per point, onto the floor the instance stands on only
+	ProjectCandidatesToNavmesh(OutCoverPointsOfActors, candidatePoints, MeshCoverTemplateMaxProjectionHeight);
+	return true;
+}
+
+void FActorCoverPointGeneratorTask::GenerateCoverForInstance(TArray<FDTOCoverData>& OutCoverPointsOfActors, const FMeshInstanceScan& InstanceScan)
+{
+	if (bUseMeshCoverTemplates
+		&& GenerateCoverFromMeshTemplate(OutCoverPointsOfActors, InstanceScan.InstancedMesh->GetStaticMesh(), InstanceScan.Transform, InstanceScan.Bounds, InstanceScan.InstancedMesh, InstanceScan.InstanceIndex))
+		return;
+
+	FBox bounds = InstanceScan.Bounds;
+	GenerateCoverInBounds(OutCoverPointsOfActors, bounds);
+}
+
+void FActorCoverPointGeneratorTask::GenerateCoverForInstances(TArray<FDTOCoverData>& OutCoverPointsOfActors)
+{
+	// collect the world-space bounds of every instance
+	TArray<FMeshInstanceScan> instanceScans;
+	TArray<UInstancedStaticMeshComponent*> instancedMeshes;
+	Owner->GetComponents<UInstancedStaticMeshComponent>(instancedMeshes);
+	for (const UInstancedStaticMeshComponent* instancedMesh : instancedMeshes)
+	{
+		const UStaticMesh* staticMesh = instancedMesh->GetStaticMesh();
+		if (!IsValid(staticMesh))
+			continue;
+
+		const FBoxSphereBounds meshBounds = staticMesh->GetBounds();
+		const int32 nInstances = instancedMesh->GetInstanceCount();
+		for (int32 iInstance = 0; iInstance < nInstances; iInstance++)
+		{
+			FTransform instanceTransform;
+			if (!instancedMesh->GetInstanceTransform(iInstance, instanceTransform, true))
+				continue;
+
+			const FBox bounds = meshBounds.TransformBy(instanceTransform).GetBox();
+			if (ScanGridUnit > bounds.Max.X - bounds.Min.X
+				|| ScanGridUnit > bounds.Max.Y - bounds.Min.Y
+				|| ScanGridUnit > bounds.Max.Z - bounds.Min.Z)
+				continue;
+
+			instanceScans.Add({ instancedMesh, iInstance, instanceTransform, bounds });
 		}
 	}
+
+	TArray<TArray<FDTOCoverData>> coverPointsPerInstance;
+	coverPointsPerInstance.SetNum(instanceScans.Num());
+
+	// scan the first instance of each mesh up-front so that the parallel scans below can all reuse its template instead of racing to make their own
+	TBitArray<> bScanned(false, instanceScans.Num());
+	if (bUseMeshCoverTemplates)
+	{
+		TSet<FMeshCoverTemplateKey> seededTemplates;
+		for (int32 iScan = 0; iScan < instanceScans.Num(); iScan++)
+		{
+			const FMeshInstanceScan& instanceScan = instanceScans[iScan];
+			bool bAlreadySeeded;
+			seededTemplates.Add(FMeshCoverTemplateKey(instanceScan.InstancedMesh->GetStaticMesh(), instanceScan.Transform.GetScale3D()), &bAlreadySeeded);
+			if (bAlreadySeeded)
+				continue;
+
+			GenerateCoverForInstance(coverPointsPerInstance[iScan], instanceScan);
+			bScanned[iScan] = true;
+		}
+	}
+
+	// scan the rest of the instances in parallel, each into its own array; debug drawing is only safe on the game thread
+	ParallelFor(instanceScans.Num(), [&](int32 iScan)
+	{
+		if (!bScanned[iScan] && !UCoverSystem::bShutdown)
+			GenerateCoverForInstance(coverPointsPerInstance[iScan], instanceScans[iScan]);
+	},
+#if DEBUG_RENDERING
+		bDebugDraw ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None
+#else
+		EParallelForFlags::None
+#endif
+	);
+
+	for (const TArray<FDTOCoverData>& instanceCoverPoints : coverPointsPerInstance)
+		OutCoverPointsOfActors.Append(instanceCoverPoints);
 }
 
 void FActorCoverPointGeneratorTask::DoWork()
@@ -165,9 +387,38 @@ void FActorCoverPointGeneratorTask::DoWork()
 	SCOPE_SECONDS_ACCUMULATOR(STAT_GenerateCoverAverageTime);
 	INC_DWORD_STAT(STAT_TaskCount);
 
+	// merged tasks carry on with whatever objects are still around, scanning only their bounds; they're dropped if none of them are
+	if (CoverObjectBounds.Num() > 0)
+	{
+		bool bAnyRemoved = false;
+		for (int32 iCoverObject = CoverObjectBounds.Num() - 1; iCoverObject >= 0; iCoverObject--)
+			if (!IsValid(CoverObjects[iCoverObject]))
+			{
+				CoverObjects.RemoveAt(iCoverObject);
+				CoverObjectBounds.RemoveAt(iCoverObject);
+				bAnyRemoved = true;
+			}
+
+		if (CoverObjects.Num() == 0)
+			return;
+
+		Owner = CoverObjects[0];
+		if (bAnyRemoved)
+		{
+			MergedBounds.Init();
+			for (const FBox& coverObjectBounds : CoverObjectBounds)
+				MergedBounds += coverObjectBounds;
+		}
+	}
+
 	if (!IsValid(Owner))
 		return;
 
+	// movable objects may move while they're being scanned, their cover points are placed relative to where they were at this point
+	TMap<const AActor*, FTransform> scanTransforms;
+	for (const AActor* coverObject : CoverObjects)
+		scanTransforms.Add(coverObject, coverObject->GetActorTransform());
+
 #if DEBUG_RENDERING
 	if (UCoverSystem::bShutdown)
 		return;
@@ -177,19 +428,32 @@ void FActorCoverPointGeneratorTask::DoWork()
 	TArray<FDTOCoverData> coverPoints;
 	TArray<FBox> everyBoundingBox;
 
-	if (bGeneratePerStaticMesh) // collect the bounding boxes of all the static meshes of Owner
+	if (CoverObjectBounds.Num() > 1) // merged task: scan the merged bounding box of all the objects at once
+	{
+		everyBoundingBox.Add(MergedBounds);
+	}
+	else if (bGeneratePerStaticMesh || bGeneratePerInstance) // collect the bounding boxes of all the static meshes of Owner
 	{
 
 		TArray<UStaticMeshComponent*> staticMeshes;
 		Owner->GetComponents<UStaticMeshComponent>(staticMeshes);
 		for (UStaticMeshComponent* staticMesh : staticMeshes)
 		{
+			// instanced static meshes are scanned per instance instead, see below
+			if (bGeneratePerInstance && staticMesh->IsA<UInstancedStaticMeshComponent>())
+				continue;
+
 			FBox bounds = staticMesh->Bounds.GetBox();
 			if (ScanGridUnit > bounds.Max.X - bounds.Min.X
 				|| ScanGridUnit > bounds.Max.Y - bounds.Min.Y
 				|| ScanGridUnit > bounds.Max.Z - bounds.Min.Z)
 				continue;
 
+			// reuse the cover candidates of previously scanned instances of the same mesh
+			if (bUseMeshCoverTemplates
+				&& GenerateCoverFromMeshTemplate(coverPoints, staticMesh->GetStaticMesh(), staticMesh->GetComponentTransform(), bounds, staticMesh))
+				continue;
+
 			everyBoundingBox.Add(bounds);
 		}
 	}
@@ -208,9 +472,14 @@ void FActorCoverPointGeneratorTask::DoWork()
 	for (FBox boundingBox : everyBoundingBox)
 		GenerateCoverInBounds(coverPoints, boundingBox);
 
+	// generate cover around every instance of the instanced static meshes in a single parallel batch
+	if (bGeneratePerInstance)
+		GenerateCoverForInstances(coverPoints);
+
+	// insert every cover point of the actor into the octree in a single batch
 	if (UCoverSystem::bShutdown)
 		return;
-	UCoverSystem::GetInstance(World)->AddCoverPoints(coverPoints);
+	UCoverSystem::GetInstance(World)->AddCoverPoints(coverPoints, scanTransforms);
 
 	DEC_DWORD_STAT(STAT_TaskCount);
 }
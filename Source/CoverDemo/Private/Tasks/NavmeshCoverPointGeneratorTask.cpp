@@ -15,15 +15,30 @@ FNavmeshCoverPointGeneratorTask::FNavmeshCoverPointGeneratorTask(
 	float _CoverPointGroundOffset,
 	FBox _MapBounds,
 	int32 _NavmeshTileIndex,
-	UWorld* _World)
+	UWorld* _World,
+	double _TileUpdateTime,
+	bool _bScheduled,
+	TArray<FBox> _DirtyAreas)
 	: CoverPointMinDistance(_CoverPointMinDistance),
 	SmallestAgentHeight(_SmallestAgentHeight),
 	CoverPointGroundOffset(_CoverPointGroundOffset),
 	NavMeshMaxZDistanceFromGround(_CoverPointGroundOffset * 3.0f),
 	MapBounds(_MapBounds),
 	NavmeshTileIndex(_NavmeshTileIndex),
-	World(_World)
-{}
+	World(_World),
+	TileUpdateTime(_TileUpdateTime),
+	bScheduled(_bScheduled),
+	DirtyAreas(MoveTemp(_DirtyAreas))
+{
+	for (FBox& dirtyArea : DirtyAreas)
+		dirtyArea = dirtyArea.ExpandBy(DirtyAreaMargin);
+}
+
+FNavmeshCoverPointGeneratorTask::~FNavmeshCoverPointGeneratorTask()
+{
+	if (bScheduled)
+		FTileCoverGenerationDispatcher::OnTaskFinished(World, TaskCost, Latency);
+}
 
 FVector FNavmeshCoverPointGeneratorTask::GetPerpendicularVector(const FVector& Vector)
 {
@@ -102,6 +117,19 @@ const FVector FNavmeshCoverPointGeneratorTask::GetEdgeDir(const FVector& EdgeSta
 	return (EdgeEndVertex - EdgeStartVertex).GetUnsafeNormal();
 }
 
+bool FNavmeshCoverPointGeneratorTask::IsEdgeDirty(const FVector& EdgeStartVertex, const FVector& EdgeEndVertex) const
+{
+	if (DirtyAreas.Num() == 0)
+		return true;
+
+	const FBox edgeBounds(EdgeStartVertex.ComponentMin(EdgeEndVertex), EdgeStartVertex.ComponentMax(EdgeEndVertex));
+	for (const FBox& dirtyArea : DirtyAreas)
+		if (dirtyArea.Intersect(edgeBounds))
+			return true;
+
+	return false;
+}
+
 const FBox FNavmeshCoverPointGeneratorTask::GenerateCoverInBounds(TArray<FDTOCoverData>& OutCoverPointsOfActors)
 {
 	// profiling
@@ -129,6 +157,14 @@ const FBox FNavmeshCoverPointGeneratorTask::GenerateCoverInBounds(TArray<FDTOCov
 		{
 			const FVector edgeStartVertex = vertices[iVertex];
 			const FVector edgeEndVertex = vertices[iVertex + 1];
+
+			// leave the cover of the unchanged parts of the tile alone
+			if (!IsEdgeDirty(edgeStartVertex, edgeEndVertex))
+			{
+				INC_DWORD_STAT(STAT_GenerateCoverSkippedEdgeCount);
+				continue;
+			}
+
 			const FVector edge = edgeEndVertex - edgeStartVertex;
 			const FVector edgeDir = edge.GetUnsafeNormal();
 
@@ -173,6 +209,7 @@ void FNavmeshCoverPointGeneratorTask::DoWork()
 	INC_DWORD_STAT(STAT_GenerateCoverHistoricalCount);
 	SCOPE_SECONDS_ACCUMULATOR(STAT_GenerateCoverAverageTime);
 	INC_DWORD_STAT(STAT_TaskCount);
+	const double startTime = FPlatformTime::Seconds();
 
 #if DEBUG_RENDERING
 	if (UCoverSystem::bShutdown)
@@ -189,13 +226,33 @@ void FNavmeshCoverPointGeneratorTask::DoWork()
 	if (UCoverSystem::bShutdown)
 		return;
 	//TODO: consider deleting this - a few more cover points might be left over upon object removal but at the expense of fewer cover points per object. most apparent near ledges. not a big deal either way, though.
-	UCoverSystem::GetInstance(World)->RemoveStaleCoverPoints(navmeshTileArea);
+	if (DirtyAreas.Num() > 0)
+		UCoverSystem::GetInstance(World)->RemoveStaleCoverPoints(DirtyAreas);
+	else
+		UCoverSystem::GetInstance(World)->RemoveStaleCoverPoints(navmeshTileArea);
 
 	// add the generated cover points to the octree in a single batch
 	if (UCoverSystem::bShutdown)
 		return;
 	UCoverSystem::GetInstance(World)->AddCoverPoints(coverPoints);
 
+	const double finishTime = FPlatformTime::Seconds();
+	TaskCost = finishTime - startTime;
+	if (TileUpdateTime > 0.0)
+		Latency = finishTime - TileUpdateTime;
+
+	// voxelize the line of sight blockers only after the cover points have been added so that they don't have to wait for it
+	if (UCoverSystem::bShutdown)
+		return;
+	if (UCoverSystem::GetInstance(World)->bBuildOcclusionGrid)
+	{
+		TArray<FBox> occlusionAreas = DirtyAreas.Num() > 0 ? DirtyAreas : TArray<FBox>({ navmeshTileArea });
+		for (FBox& occlusionArea : occlusionAreas)
+			occlusionArea.Max.Z += OcclusionGridHeadroom;
+		UCoverSystem::GetInstance(World)->GetOcclusionGrid().Voxelize(World, occlusionAreas);
+		TaskCost = FPlatformTime::Seconds() - startTime;
+	}
+
 #if DEBUG_RENDERING
 	for (FDTOCoverData coverPoint : coverPoints)
 		if (bDebugDraw)
@@ -0,0 +1,44 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnvironmentQuery/EnvQueryGenerator.h"
+#include "EnvironmentQuery/EnvQueryContext.h"
+#include "DataProviders/AIDataProvider.h"
+#include "EnvQueryGenerator_CoverPoints.generated.h"
+
+/**
+ * Generates the cover points of UCoverSystem within an annulus around a context, e.g. between the min and max attack range around the enemy.
+ * Cover points are added as point items straight from a single octree query, along with their navmesh polys.
+ */
+UCLASS(meta = (DisplayName = "Cover Points"))
+class COVERDEMO_API UEnvQueryGenerator_CoverPoints : public UEnvQueryGenerator
+{
+	GENERATED_BODY()
+
+	// Cover points are generated around these, e.g. the enemy.
+	UPROPERTY(EditDefaultsOnly, Category = Generator)
+	TSubclassOf<UEnvQueryContext> Center;
+
+	// Cover points closer to the center than this are skipped, e.g. our min attack range.
+	UPROPERTY(EditDefaultsOnly, Category = Generator)
+	FAIDataProviderFloatValue MinDistance;
+
+	// Cover points further from the center than this are skipped, e.g. our max attack range.
+	UPROPERTY(EditDefaultsOnly, Category = Generator)
+	FAIDataProviderFloatValue MaxDistance;
+
+	// Skip the cover points that other units have taken.
+	UPROPERTY(EditDefaultsOnly, Category = Generator)
+	bool bExcludeTaken = true;
+
+public:
+	UEnvQueryGenerator_CoverPoints();
+
+	virtual void GenerateItems(FEnvQueryInstance& QueryInstance) const override;
+
+	virtual FText GetDescriptionTitle() const override;
+
+	virtual FText GetDescriptionDetails() const override;
+};
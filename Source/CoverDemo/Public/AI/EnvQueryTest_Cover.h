@@ -0,0 +1,56 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnvironmentQuery/EnvQueryTest.h"
+#include "GameFramework/Character.h"
+#include "CoverSystem/CoverSystem.h"
+#include "CoverSystem/CoverPointEvaluator.h"
+#include "EnvQueryTest_Cover.generated.h"
+
+/**
+ * Base of the EQS tests that evaluate cover points via FCoverPointEvaluator, from the eye height of the querying character.
+ * The cover points of the items that are still to be tested are looked up with a single octree query per run. Items that aren't cover points fail.
+ */
+UCLASS(Abstract)
+class COVERDEMO_API UEnvQueryTest_Cover : public UEnvQueryTest
+{
+	GENERATED_BODY()
+
+protected:
+	// Evaluate from the crouched eye height of the querier instead of the standing one.
+	UPROPERTY(EditDefaultsOnly, Category = Cover)
+	bool bCrouched = false;
+
+	// How much our weapon moves horizontally when we're leaning. 0 = unit can't lean at all.
+	UPROPERTY(EditDefaultsOnly, Category = Cover)
+	float WeaponLeanOffset = 100.0f;
+
+	// How close must the actual cover object be to a cover point. This is to avoid picking a cover point that doesn't provide meaningful cover.
+	UPROPERTY(EditDefaultsOnly, Category = Cover)
+	float CoverPointMaxObjectHitDistance = 310.0f;
+
+	// Reject exposed cover points via the occlusion grid of UCoverSystem before sweeping. Has no effect unless UCoverSystem::bBuildOcclusionGrid is set.
+	UPROPERTY(EditDefaultsOnly, Category = Cover)
+	bool bUseOcclusionGrid = true;
+
+	// Should be the same as the one defined in UCoverSystem.
+	const float CoverPointGroundOffset = 10.0f;
+
+	// Finds the character running the query, either the owner of the query or the pawn of the controller that owns it, and the eye height to evaluate from.
+	// Returns null if the query isn't run by a character.
+	const ACharacter* GetQuerierCharacter(FEnvQueryInstance& QueryInstance, float& OutEyeHeight) const;
+
+	// Looks up the cover points of the items that the item iterator of this run will visit, i.e. the ones past where the previous run of a time sliced test stopped, with a single octree query, keyed by their location.
+	void FindItemCoverPoints(TMap<FVector, FCoverPointOctreeElement>& OutCoverPoints, FEnvQueryInstance& QueryInstance) const;
+
+	// Settings of ours that FCoverPointEvaluator needs.
+	FORCEINLINE FCoverEvaluationSettings GetEvaluationSettings() const
+	{
+		return FCoverEvaluationSettings(WeaponLeanOffset, CoverPointMaxObjectHitDistance, CoverPointGroundOffset, bUseOcclusionGrid);
+	}
+
+public:
+	UEnvQueryTest_Cover();
+};
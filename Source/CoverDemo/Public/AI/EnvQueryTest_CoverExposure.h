@@ -0,0 +1,31 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI/EnvQueryTest_Cover.h"
+#include "EnvironmentQuery/EnvQueryContext.h"
+#include "EnvQueryTest_CoverExposure.generated.h"
+
+/**
+ * Checks whether cover points hide the querier from every actor of a context, e.g. all the enemies around it, without having to be able to shoot back at them.
+ * Threats behind the same piece of cover share a sweep, and outcomes are reused by the querier's later searches via the exposure cache.
+ */
+UCLASS(meta = (DisplayName = "Cover: Hidden From Threats"))
+class COVERDEMO_API UEnvQueryTest_CoverExposure : public UEnvQueryTest_Cover
+{
+	GENERATED_BODY()
+
+	// The actors to stay hidden from.
+	UPROPERTY(EditDefaultsOnly, Category = Cover)
+	TSubclassOf<UEnvQueryContext> Threats;
+
+public:
+	UEnvQueryTest_CoverExposure();
+
+	virtual void RunTest(FEnvQueryInstance& QueryInstance) const override;
+
+	virtual FText GetDescriptionTitle() const override;
+
+	virtual FText GetDescriptionDetails() const override;
+};
@@ -0,0 +1,31 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI/EnvQueryTest_Cover.h"
+#include "EnvironmentQuery/EnvQueryContext.h"
+#include "EnvQueryTest_CoverLean.generated.h"
+
+/**
+ * Checks whether cover points protect the querier from the enemy while still letting it shoot back by leaning out, same as UFindCover.
+ * Cover points of the same cluster share the coarse cluster check, and outcomes are reused by the querier's later searches via the exposure cache.
+ */
+UCLASS(meta = (DisplayName = "Cover: Lean Out"))
+class COVERDEMO_API UEnvQueryTest_CoverLean : public UEnvQueryTest_Cover
+{
+	GENERATED_BODY()
+
+	// The enemy to take cover from and shoot at. Only its first actor is used.
+	UPROPERTY(EditDefaultsOnly, Category = Cover)
+	TSubclassOf<UEnvQueryContext> Enemy;
+
+public:
+	UEnvQueryTest_CoverLean();
+
+	virtual void RunTest(FEnvQueryInstance& QueryInstance) const override;
+
+	virtual FText GetDescriptionTitle() const override;
+
+	virtual FText GetDescriptionDetails() const override;
+};
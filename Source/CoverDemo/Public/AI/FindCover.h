@@ -9,11 +9,60 @@
 #include "AIController.h"
 #include "Engine/World.h"
 #include "CoverSystem/CoverSystem.h"
+#include "CoverSystem/CoverPointEvaluator.h"
+#include "CoverSystem/CoverPointScorer.h"
 #include "Debug/CoverFinderVisData.h"
+#include "UObject/StrongObjectPtr.h"
 #include "FindCover.generated.h"
 
+/**
+ * Per-agent state of UFindCover while it's evaluating cover points over multiple frames.
+ */
+struct FFindCoverMemory
+{
+public:
+	// The gathered cover points, best ranked first.
+	TArray<FCoverPointOctreeElement> CoverPoints;
+
+	// Path cost of each cover point, UCoverSystem::UnknownPathCost if it has to be checked with pathfinding.
+	TArray<float> CoverPointPathCosts;
+
+	// Index of the next cover point to evaluate.
+	int32 NextCoverPoint = 0;
+
+	TWeakObjectPtr<const AActor> TargetEnemy;
+
+	// The other enemies our unit has to stay hidden from.
+	TArray<FCoverThreat> Threats;
+
+	// Outcomes of the cover clusters checked so far, see FCoverPointEvaluator::CheckCluster().
+	TMap<FVector, bool> ClusterOutcomes;
+
+	float CharEyeHeightStanding = 0.0f;
+
+	float CharEyeHeightCrouched = 0.0f;
+
+	// Only allocated while debugging and kept across executions. Kept alive here as the blackboard only references it weakly.
+	TStrongObjectPtr<UCoverFinderVisData> DebugData;
+
+	bool bDrawDebug = false;
+
+	bool bUnitDebug = false;
+
+	void Reset()
+	{
+		CoverPoints.Empty();
+		CoverPointPathCosts.Empty();
+		NextCoverPoint = 0;
+		TargetEnemy.Reset();
+		Threats.Empty();
+		ClusterOutcomes.Empty();
+	}
+};
+
 /**
  * Finds suitable cover by looking around a unit in a full sphere.
+ * Latent: cover points are evaluated within a per-frame time budget that's shared by every agent, so finding cover may take multiple frames.
  */
 UCLASS()
 class COVERDEMO_API UFindCover : public UBTTaskNode
@@ -21,40 +70,48 @@ class COVERDEMO_API UFindCover : public UBTTaskNode
 	GENERATED_BODY()
 
 private:
-	static FVector GetPerpendicularVector(const FVector& Vector);
+	// Frame that FrameBudgetSpent belongs to.
+	static uint64 FrameBudgetFrameNumber;
+
+	// Time spent evaluating cover points by all agents in the current frame, in seconds. Game thread only.
+	static double FrameBudgetSpent;
 
 	// Should be the same as the one defined in UCoverSystem.
 	const float CoverPointGroundOffset = 10.0f;
 
+	// Time all agents may spend evaluating cover points per frame, in microseconds. Every agent evaluates at least one cover point per frame regardless, so that none of them starve.
+	const float FrameBudgetMicroseconds = 1000.0f;
+
 	const FName Key_VisData = FName("VisData");
 
-	// Gather, filter and sort cover points.
+	// Evaluates cover points until a suitable one is found, there are none left or the frame budget runs out.
+	// Returns InProgress if it has to continue next frame.
+	EBTNodeResult::Type EvaluateCoverPoints(UBehaviorTreeComponent& OwnerComp, FFindCoverMemory& Memory) const;
+
+	// Gather and filter cover points. They get ranked by FCoverPointScorer afterwards, OutTakenCoverLocations receives the taken ones for its crowding term.
 	const void GetCoverPoints(
 		TArray<FCoverPointOctreeElement>& OutCoverPoints,
+		TArray<FVector>& OutTakenCoverLocations,
 		UWorld* World,
 		const FVector& PawnLocation,
 		const FVector& EnemyLocation,
-		UCoverFinderVisData& DebugData,
-		const bool bUnitDebug = false) const;
-
-	// Checks if there's clear line of sight to the enemy when leaning to the right.
-	const bool CheckHitByLeaning(
-		const FVector& CoverLocation,
-		const ACharacter* OurUnit,
-		const AActor* TargetEnemy,
-		UWorld* World,
-		UCoverFinderVisData& DebugData,
+		UCoverFinderVisData* DebugData,
 		const bool bUnitDebug = false) const;
 
-	const bool EvaluateCoverPoint(
-		const FCoverPointOctreeElement coverPoint,
+	// Checks if our unit can reach the cover point.
+	// Uses the navmesh islands of UCoverSystem and only falls back to pathfinding if they don't know about either poly.
+	const bool IsCoverPointReachable(
+		const FCoverPointOctreeElement& CoverPoint,
 		const ACharacter* Character,
-		const float CharEyeHeight,
-		const AActor* TargetEnemy,
-		const FVector& EnemyLocation,
-		UWorld* World,
-		UCoverFinderVisData& DebugData,
-		const bool bUnitDebug = false) const;
+		const FVector& CharacterLocation,
+		const NavNodeRef CharacterPolyRef,
+		UWorld* World) const;
+
+	// Settings of ours that FCoverPointEvaluator needs.
+	FORCEINLINE FCoverEvaluationSettings GetEvaluationSettings() const
+	{
+		return FCoverEvaluationSettings(WeaponLeanOffset, CoverPointMaxObjectHitDistance, CoverPointGroundOffset, bUseOcclusionGrid);
+	}
 
 public:
 	UPROPERTY(EditAnywhere, Category = Blackboard)
@@ -84,5 +141,47 @@ public:
 	UPROPERTY(EditAnywhere, Category = Blackboard)
 	float CoverPointMaxObjectHitDistance = 310.0f; // was 100.0f
 
+	// How far our unit may walk to get into cover, along the navmesh. Cover points further away than this are skipped.
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	float MaxCoverPathCost = 3000.0f;
+
+	// How cover points are ranked before they're evaluated.
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FCoverScoringSettings ScoringSettings;
+
+	// Only this many of the best ranked cover points are evaluated.
+	UPROPERTY(EditAnywhere, Category = Blackboard, meta = (ClampMin = "1"))
+	int32 MaxScoredCandidates = 32;
+
+	// Other enemies that our unit has to stay hidden from besides Enemy, gathered around it. None = only Enemy is considered.
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	TSubclassOf<AActor> ThreatClass;
+
+	// How far from our unit other enemies are considered threats.
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	float ThreatRadius = 3000.0f;
+
+	// At most this many other enemies are considered threats, the closest ones.
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	int32 MaxThreats = 8;
+
+	// Reject exposed cover points via the occlusion grid of UCoverSystem before sweeping. Has no effect unless UCoverSystem::bBuildOcclusionGrid is set.
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	bool bUseOcclusionGrid = true;
+
+	UFindCover();
+
 	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+	virtual EBTNodeResult::Type AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+	virtual void TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;
+
+	virtual void OnTaskFinished(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTNodeResult::Type TaskResult) override;
+
+	virtual uint16 GetInstanceMemorySize() const override;
+
+	virtual void InitializeMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryInit::Type InitType) const override;
+
+	virtual void CleanupMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryClear::Type CleanupType) const override;
 };
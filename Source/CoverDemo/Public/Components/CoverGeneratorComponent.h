@@ -31,9 +31,36 @@ private:
 	// Stores whether the navmesh has already been generated at least once.
 	bool bFirstNavmeshGeneration = true;
 
+	// Our custom navmesh, if there's one.
+	TWeakObjectPtr<AChangeNotifyingRecastNavMesh> Navmesh;
+
+	// Range of navmesh tile coordinates that OwnerBounds overlaps, inclusive. Cover is only regenerated when one of these tiles gets rebuilt.
+	FIntPoint OverlappingTilesMin;
+	FIntPoint OverlappingTilesMax;
+
+	// Transform of the owner when its cover points were last generated. Used for detecting rotation and scale changes of movable cover.
+	FTransform GenerationTransform;
+
+	// Transform of the owner when its cover points were last generated or moved. Used for detecting movement of movable cover.
+	FTransform LastCoverTransform;
+
+	// Whether cover generation has been started at least once. Movable cover isn't checked for movement before that, as there's nothing to move yet.
+	bool bCoverGenerated = false;
+
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Recalculates OwnerBounds and the range of navmesh tiles it overlaps.
+	void UpdateOverlappingTiles();
+
+	// Checks whether any of the tiles rebuilt until navigation generation last finished overlap OwnerBounds.
+	bool AreOverlappingTilesUpdated() const;
+
+	// Stops listening to navmesh updates.
+	void UnbindNavmeshDelegates();
+
 public:
 	// Should cover points be generated right at BeginPlay or not. Should be set to false for most ordnances. Need to call GenerateCoverPoints() later explicitly when this is set to false.
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
@@ -43,6 +70,39 @@ public:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
 	bool bGeneratePerStaticMesh = false;
 
+	// Whether to hand generation over to the cover system's scheduler, which coalesces the requests of adjacent actors spawned around the same time and limits the number of concurrent tasks.
+	// Generation is always immediate when debug drawing is enabled.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
+	bool bUseGenerationScheduler = false;
+
+	// Whether to generate cover points per instance of the instanced (and hierarchical instanced) static mesh components found in Owner, e.g. for foliage-style rock fields and sandbag lines. All instances are processed as a single parallel batch.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
+	bool bGeneratePerInstance = false;
+
+	// Whether to scan each UStaticMesh only once (per scale) and reuse its mesh-local cover candidates for every other instance of it. Greatly speeds up generation for props that are placed many times. Implies bGeneratePerStaticMesh.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
+	bool bUseMeshCoverTemplates = false;
+
+	// Whether the owner is movable cover, e.g. a vehicle or a pushable barrier. Its cover points are then stored relative to it and follow it around without regeneration.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
+	bool bMovableCover = false;
+
+	// Movable cover: how far the owner has to move before its cover points are moved along with it.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, meta = (EditCondition = "bMovableCover"))
+	float MovementThreshold = 25.0f;
+
+	// Movable cover: cover points are fully regenerated once the owner has been rotated by more than this amount (in degrees) since the last generation.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, meta = (EditCondition = "bMovableCover"))
+	float RotationTolerance = 5.0f;
+
+	// Movable cover: cover points are fully regenerated once the owner's scale has changed by more than this amount since the last generation.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, meta = (EditCondition = "bMovableCover"))
+	float ScaleTolerance = 0.01f;
+
+	// Movable cover: how often to check whether the owner has moved, in seconds.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, meta = (EditCondition = "bMovableCover"))
+	float MovementCheckInterval = 0.1f;
+
 	// Density of the scan grid (lower number -> more traces); Guideline: should be a bit less than the capsule radius of the smallest unit capable of getting into cover, which is normally == smallest radius used for navigation by the navmesh.
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
 	float ScanGridUnit = 75.0f;
@@ -56,9 +116,14 @@ public:
 	// Called every frame
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 
+	// Fallback for when the main navmesh isn't an AChangeNotifyingRecastNavMesh: regenerates after every navmesh build.
 	UFUNCTION()
 	void OnNavmeshGenerationFinished(ANavigationData* NavData);
 
+	// Regenerates cover points once navigation generation has finished, but only if any of the rebuilt tiles overlap the owner.
+	UFUNCTION()
+	void OnNavmeshTilesUpdatedUntilFinished(const TSet<uint32>& UpdatedTiles);
+
 	// Generates cover points around (and inside) the owner via an asynchronous CoverPointGeneratorTask, which automatically stores the results in the game mode's octree.
 	UFUNCTION(BlueprintCallable)
 	void GenerateCoverPoints();
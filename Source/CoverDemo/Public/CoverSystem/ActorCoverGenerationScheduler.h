@@ -0,0 +1,105 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+
+/**
+ * A request for generating the cover points of an actor, see UCoverGeneratorComponent.
+ */
+struct FActorCoverGenerationRequest
+{
+public:
+	TWeakObjectPtr<AActor> Owner;
+	float BoundingBoxExpansion;
+	float ScanGridUnit;
+	float SmallestAgentHeight;
+	bool bGeneratePerStaticMesh;
+	bool bUseMeshCoverTemplates;
+	bool bGeneratePerInstance;
+
+	FActorCoverGenerationRequest()
+		: Owner(), BoundingBoxExpansion(), ScanGridUnit(), SmallestAgentHeight(), bGeneratePerStaticMesh(), bUseMeshCoverTemplates(), bGeneratePerInstance()
+	{}
+
+	FActorCoverGenerationRequest(
+		AActor* _Owner,
+		float _BoundingBoxExpansion,
+		float _ScanGridUnit,
+		float _SmallestAgentHeight,
+		bool _bGeneratePerStaticMesh,
+		bool _bUseMeshCoverTemplates,
+		bool _bGeneratePerInstance)
+		: Owner(_Owner),
+		BoundingBoxExpansion(_BoundingBoxExpansion),
+		ScanGridUnit(_ScanGridUnit),
+		SmallestAgentHeight(_SmallestAgentHeight),
+		bGeneratePerStaticMesh(_bGeneratePerStaticMesh),
+		bUseMeshCoverTemplates(_bUseMeshCoverTemplates),
+		bGeneratePerInstance(_bGeneratePerInstance)
+	{}
+
+	// Only requests that scan the owner's whole bounding box can be merged with others.
+	FORCEINLINE bool CanBeMerged() const
+	{
+		return !bGeneratePerStaticMesh && !bUseMeshCoverTemplates && !bGeneratePerInstance;
+	}
+
+	// Requests can only share a scan if they'd scan with the same settings.
+	FORCEINLINE bool HasSameScanSettings(const FActorCoverGenerationRequest& Other) const
+	{
+		return BoundingBoxExpansion == Other.BoundingBoxExpansion
+			&& ScanGridUnit == Other.ScanGridUnit
+			&& SmallestAgentHeight == Other.SmallestAgentHeight;
+	}
+};
+
+/**
+ * Collects actor cover generation requests for a short window, merges the ones with overlapping or adjacent bounds and dispatches a bounded number of FActorCoverPointGeneratorTasks.
+ * Keeps wave spawns and level streaming from flooding the thread pool with overlapping scans. Owned by UCoverSystem, game thread only.
+ */
+class COVERDEMO_API FActorCoverGenerationScheduler
+{
+private:
+	// Number of scheduled tasks that are still queued or running.
+	static FThreadSafeCounter TasksInFlight;
+
+	// How long to collect requests for before dispatching them, in seconds.
+	const float CoalescingWindow = 0.1f;
+
+	// Maximum number of scheduled tasks in flight. Requests over this limit wait for the next window.
+	const int32 MaxTasksInFlight = 4;
+
+	// Bounds that are at most this far apart (in ScanGridUnits) count as adjacent.
+	const float AdjacencyTolerance = 1.0f;
+
+	// Bounds are only merged if the merged volume is at most this many times the sum of the individual volumes, so that we don't end up scanning a lot of empty space.
+	const float MaxMergedVolumeRatio = 1.5f;
+
+	TWeakObjectPtr<UWorld> World;
+
+	FTimerHandle FlushTimerHandle;
+
+	// Requests waiting to be dispatched.
+	TArray<FActorCoverGenerationRequest> PendingRequests;
+
+	// Merges the pending requests and dispatches as many tasks as allowed.
+	void Flush();
+
+	// Starts the flush timer if it isn't running already.
+	void ScheduleFlush();
+
+public:
+	FActorCoverGenerationScheduler(UWorld* _World);
+
+	~FActorCoverGenerationScheduler();
+
+	// Queues an actor for cover generation. Requests for actors that are already queued are dropped.
+	void QueueRequest(const FActorCoverGenerationRequest& Request);
+
+	// Called by scheduled tasks once they're done. Thread-safe.
+	static void OnTaskFinished();
+};
@@ -7,6 +7,8 @@
 #include "Engine/Engine.h"
 #include "Engine/World.h"
 #include "TimerManager.h"
+#include "Containers/Queue.h"
+#include <atomic>
 #include "ChangeNotifyingRecastNavMesh.generated.h"
 
 // DELEGATES //
@@ -15,9 +17,15 @@
 // ChangedTiles contains tiles that have been updated since the last timer.
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FNavmeshTilesUpdatedBufferedDelegate, const TSet<uint32>&, ChangedTiles);
 
-// Fired as tiles are updated.
+// Fired as tiles are updated, on whichever thread Recast reports them on.
 // ChangedTiles contains the same tiles as what get passed around inside Recast.
-DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FNavmeshTilesUpdatedImmediateDelegate, const TSet<uint32>&, ChangedTiles);
+DECLARE_MULTICAST_DELEGATE_OneParam(FNavmeshTilesUpdatedImmediateDelegate, const TSet<uint32>& /* ChangedTiles */);
+
+// Fired on the game thread right before the whole navmesh is rebuilt. Every tile is reported again via the other delegates as it gets rebuilt.
+DECLARE_MULTICAST_DELEGATE(FNavmeshRebuildAllDelegate);
+
+// Asked for how long to buffer tile updates for before the next buffered broadcast.
+DECLARE_DELEGATE_RetVal(float, FNavmeshTileBufferIntervalDelegate);
 
 // Fires once navigation generation is finished, i.e. there are no dirty tiles left.
 // ChangedTiles contains all the tiles that have been updated since the last time nav was finished.
@@ -32,19 +40,63 @@ class COVERDEMO_API AChangeNotifyingRecastNavMesh : public ARecastNavMesh
 	GENERATED_BODY()
 
 protected:
+	/** A tile update waiting in QueuedTiles. */
+	struct FQueuedTile
+	{
+		uint32 TileIdx;
+
+		// Time (FPlatformTime::Seconds()) at which the tile has been updated.
+		double UpdateTime;
+	};
+
+	// Tiles with an index at or above this aren't deduplicated by QueuedTileBits, they're queued every time they're updated instead.
+	static constexpr uint32 MaxDeduplicatedTiles = 1 << 16;
+
+	// Maximum number of tiles to move from QueuedTiles into the buffers per ProcessQueuedTiles() call. The rest is left for the next call.
+	const int32 TileDrainBatchSize = 512;
+
+	// Updated tiles, pushed by Recast without locking and drained on the game thread.
+	TQueue<FQueuedTile, EQueueMode::Mpsc> QueuedTiles;
+
+	// One bit per tile that's set while the tile is in QueuedTiles, so that repeated updates of the same tile only get queued once.
+	std::atomic<uint32> QueuedTileBits[MaxDeduplicatedTiles / 32];
+
+	// Game thread only.
 	TSet<uint32> UpdatedTilesIntervalBuffer;
 
+	// Time (FPlatformTime::Seconds()) at which each tile in UpdatedTilesIntervalBuffer has first been updated since the last buffered broadcast. Game thread only.
+	TMap<uint32, double> TileUpdateTimes;
+
+	// Game thread only.
 	TSet<uint32> UpdatedTilesUntilFinishedBuffer;
 
-	// Lock used for interval-buffered tile updates.
-	FCriticalSection TileUpdateLockObject;
+	// Tile coordinates of UpdatedTilesUntilFinishedBuffer as of the last time navigation generation had finished.
+	TSet<FIntPoint> LastFinishedTileCoordinates;
+
+	// Bounds of the changed geometry that has caused the tiles to be rebuilt, since the last time all updated tiles have been broadcast. Game thread only.
+	TArray<FBox> RecentDirtyAreas;
+
+	// Bounds of the recent dirty areas that rebuild the tiles they touch as a whole, i.e. changed navigation bounds. Game thread only.
+	TArray<FBox> RecentWholeTileAreas;
+
+	// Whether the whole navmesh is being rebuilt, see RebuildAll(). Game thread only.
+	bool bRebuildingAll = false;
 
+	// Tiles in UpdatedTilesIntervalBuffer that have been rebuilt as a whole, regardless of any dirty areas they overlap. Game thread only.
+	TSet<uint32> WholeRebuiltTiles;
+
+	// Used when TileBufferIntervalDelegate isn't bound.
 	const float TileBufferInterval = 0.2f;
 
 	FTimerHandle TileUpdateTimerHandle;
+
+	// Arms the timer for the next ProcessQueuedTiles() call, see TileBufferIntervalDelegate.
+	void ScheduleProcessQueuedTiles();
+
+	// Moves at most MaxTiles tiles from QueuedTiles into the buffers, noting the ones that have been rebuilt as a whole. Game thread only.
+	void DrainQueuedTiles(int32 MaxTiles);
 	
 public:	
-	UPROPERTY()
 	FNavmeshTilesUpdatedImmediateDelegate NavmeshTilesUpdatedImmediateDelegate;
 
 	UPROPERTY()
@@ -53,6 +105,11 @@ public:
 	UPROPERTY()
 	FNavmeshTilesUpdatedUntilFinishedDelegate NavmeshTilesUpdatedUntilFinishedDelegate;
 
+	FNavmeshRebuildAllDelegate NavmeshRebuildAllDelegate;
+
+	// Lets the consumer of the buffered tile updates adapt the buffering interval to its backlog. Falls back to TileBufferInterval when unbound.
+	FNavmeshTileBufferIntervalDelegate TileBufferIntervalDelegate;
+
 	AChangeNotifyingRecastNavMesh();
 
 	AChangeNotifyingRecastNavMesh(const FObjectInitializer& ObjectInitializer);
@@ -61,15 +118,37 @@ public:
 
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
+	// Records the dirty areas before rebuilding them, see GetDirtyAreasInTile().
+	virtual void RebuildDirtyAreas(const TArray<FNavigationDirtyArea>& DirtyAreas) override;
+
+	// Fires NavmeshRebuildAllDelegate before rebuilding the whole navmesh.
+	virtual void RebuildAll() override;
+
 	// Called after a set of tiles had been updated. Due to how Recast's implementation works, it may repeatedly contain the same tiles between successive invocations.
-	// This is worked around by buffering tile updates (see delegates).
+	// This is worked around by queueing each tile only once until it's drained and by buffering tile updates (see delegates). Lock-free, may be called from any thread.
 	virtual void OnNavMeshTilesUpdated(const TArray<FNavTileRef>& ChangedTiles) override;
 
-	// Broadcasts buffered tile updates every TileBufferInterval seconds via NavmeshTilesUpdatedDelegate. Thread-safe.
+	// Broadcasts buffered tile updates via NavmeshTilesUpdatedBufferedDelegate, then schedules itself again. Game thread only.
 	UFUNCTION()
 	void ProcessQueuedTiles();
 
+	// Returns the time at which the supplied tile has first been updated since the last buffered broadcast, or the current time if it's unknown.
+	// Meant to be called by listeners of NavmeshTilesUpdatedBufferedDelegate during the broadcast.
+	double GetTileUpdateTime(uint32 TileIdx) const;
+
+	// Finds the dirty areas that have caused the supplied tile to be rebuilt, i.e. the parts of the tile that might have changed.
+	// Returns false if the tile has been rebuilt for another reason, e.g. a full navmesh rebuild, in which case the whole tile should be considered changed.
+	// Meant to be called by listeners of NavmeshTilesUpdatedBufferedDelegate during the broadcast.
+	bool GetDirtyAreasInTile(TArray<FBox>& OutDirtyAreas, uint32 TileIdx) const;
+
 	// Delegate handler.
 	UFUNCTION()
 	void OnNavmeshGenerationFinishedHandler(ANavigationData* NavData);
+
+	// Tile coordinates of all the tiles that had been updated until navigation generation last finished.
+	// Valid during and after NavmeshTilesUpdatedUntilFinishedDelegate broadcasts. Game thread only.
+	FORCEINLINE const TSet<FIntPoint>& GetLastFinishedTileCoordinates() const
+	{
+		return LastFinishedTileCoordinates;
+	}
 };
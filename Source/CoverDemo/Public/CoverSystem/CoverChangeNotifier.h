@@ -0,0 +1,126 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+#include "Misc/ScopeRWLock.h"
+#include "HAL/ThreadSafeBool.h"
+
+// What happened to a cover point.
+enum class ECoverChangeType : uint8
+{
+	Added,
+	Removed,
+	Taken,
+	Released
+};
+
+/**
+ * A change to a cover point, as reported to the subscribers of FCoverChangeNotifier.
+ */
+struct FCoverChange
+{
+public:
+	FVector Location;
+
+	ECoverChangeType Type;
+
+	FCoverChange()
+		: Location(), Type()
+	{}
+
+	FCoverChange(const FVector& _Location, ECoverChangeType _Type)
+		: Location(_Location), Type(_Type)
+	{}
+};
+
+// Called on the game thread with the changes to the cover points within a subscribed region since the last call, at most once per frame.
+DECLARE_DELEGATE_OneParam(FCoverChangesDelegate, const TArray<FCoverChange>& /* Changes */);
+
+/**
+ * A region that a subscriber is notified about, either a box or a sphere.
+ */
+struct FCoverSubscription
+{
+public:
+	FBox Box;
+
+	FSphere Sphere;
+
+	bool bSphere;
+
+	FCoverChangesDelegate Delegate;
+
+	// Changes since the last flush.
+	TArray<FCoverChange> PendingChanges;
+
+	FCoverSubscription()
+		: Box(ForceInit), Sphere(ForceInit), bSphere(), Delegate(), PendingChanges()
+	{}
+
+	FCoverSubscription(const FBox& _Box, const FCoverChangesDelegate& _Delegate)
+		: Box(_Box), Sphere(ForceInit), bSphere(false), Delegate(_Delegate), PendingChanges()
+	{}
+
+	FCoverSubscription(const FSphere& _Sphere, const FCoverChangesDelegate& _Delegate)
+		: Box(_Sphere.Center - FVector(_Sphere.W), _Sphere.Center + FVector(_Sphere.W)), Sphere(_Sphere), bSphere(true), Delegate(_Delegate), PendingChanges()
+	{}
+
+	FORCEINLINE bool Contains(const FVector& Location) const
+	{
+		return bSphere
+			? FVector::DistSquared(Sphere.Center, Location) <= FMath::Square(Sphere.W)
+			: Box.IsInsideOrOn(Location);
+	}
+};
+
+/**
+ * Lets agents subscribe to the changes of the cover points within a region instead of polling for them, e.g. to re-evaluate their cover only when cover around them is added, removed, taken or released.
+ * Changes are recorded by UCoverSystem from any thread and delivered on the game thread in a single batch per subscription on the next tick. Owned by UCoverSystem, thread-safe.
+ */
+class COVERDEMO_API FCoverChangeNotifier : public TSharedFromThis<FCoverChangeNotifier, ESPMode::ThreadSafe>
+{
+private:
+	mutable FRWLock SubscriptionLockObject;
+
+	TWeakObjectPtr<UWorld> World;
+
+	TMap<int32, FCoverSubscription> Subscriptions;
+
+	int32 NextSubscriptionID = 0;
+
+	// Whether a flush has been scheduled since changes were last delivered.
+	FThreadSafeBool bFlushScheduled;
+
+	FTimerHandle FlushTimerHandle;
+
+	// Sets the flush timer for the next tick. Game thread only.
+	void ScheduleFlush();
+
+	// Delivers the pending changes to their subscribers. Game thread only.
+	void Flush();
+
+public:
+	FCoverChangeNotifier(UWorld* _World);
+
+	~FCoverChangeNotifier();
+
+	// Subscribes to the changes of the cover points within a box or a sphere.
+	// Returns the id of the subscription, for updating its region or unsubscribing.
+	int32 Subscribe(const FBox& Box, const FCoverChangesDelegate& Delegate);
+	int32 Subscribe(const FSphere& Sphere, const FCoverChangesDelegate& Delegate);
+
+	// Moves the region of a subscription, e.g. along with the agent that's subscribed. Pending changes are delivered regardless.
+	void UpdateSubscription(int32 SubscriptionID, const FBox& Box);
+	void UpdateSubscription(int32 SubscriptionID, const FSphere& Sphere);
+
+	void Unsubscribe(int32 SubscriptionID);
+
+	// Cheap check for skipping the gathering of changes when nobody is listening.
+	bool HasSubscriptions() const;
+
+	// Queues the changes for the subscriptions whose regions contain them and schedules their delivery. Can be called from any thread.
+	void RecordChanges(const TArray<FCoverChange>& Changes);
+};
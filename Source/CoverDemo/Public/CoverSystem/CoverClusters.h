@@ -0,0 +1,93 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Misc/ScopeRWLock.h"
+#include "CoverSystem/CoverPointOctreeElement.h"
+
+/**
+ * Contiguous cover points of the same cover object that face the same way, e.g. the ones along one side of a wall.
+ * They almost always pass or fail together against an enemy, so they can be tested once as a whole before evaluating them one by one.
+ */
+struct FCoverCluster
+{
+public:
+	TWeakObjectPtr<const AActor> CoverObject;
+
+	// Bounds of the cover points.
+	FBox Bounds;
+
+	// The cover point closest to the centroid of the cluster, the one the cluster is tested from.
+	FVector RepresentativeLocation;
+
+	// Horizontal direction towards the cover object, i.e. where the cluster provides cover from. Zero if it couldn't be determined.
+	FVector Facing;
+
+	int32 CoverPointCount;
+
+	bool bForceField;
+
+	FCoverCluster()
+		: CoverObject(), Bounds(ForceInit), RepresentativeLocation(), Facing(), CoverPointCount(), bForceField()
+	{}
+};
+
+/**
+ * Clusters of cover points, by cover object and contiguity. Owned by UCoverSystem, which marks the cover objects whose cover points change as dirty and reclusters them lazily.
+ * Thread-safe, except for Rebuild() which has to be called on the game thread as it queries the collision of cover objects.
+ */
+class COVERDEMO_API FCoverClusters
+{
+private:
+	mutable FRWLock ClusterLockObject;
+
+	// Cover points closer than this to one another are contiguous. Somewhat more than the distance between neighbouring generated cover points.
+	const float LinkDistance = 100.0f;
+
+	// Contiguous cover points are only clustered together if their facings are within about 45 degrees, so that the corners of a wall split it up.
+	const float MinLinkFacingDot = 0.7f;
+
+	TSparseArray<FCoverCluster> Clusters;
+
+	TMap<FVector, int32> CoverPointToCluster;
+
+	TMultiMap<TWeakObjectPtr<const AActor>, int32> CoverObjectToClusters;
+
+	// The clustered cover points of each cover object, for unmapping them when the object is reclustered.
+	TMultiMap<TWeakObjectPtr<const AActor>, FVector> CoverObjectToCoverPoints;
+
+	// Cover objects whose cover points have changed since they were last clustered.
+	TSet<TWeakObjectPtr<const AActor>> DirtyCoverObjects;
+
+	// Removes the clusters of a cover object. Assumes that ClusterLockObject is held for writing.
+	void RemoveClustersOfObjectUnsafe(const TWeakObjectPtr<const AActor>& CoverObject);
+
+	// Horizontal direction from the cover point towards the closest point on the cover object's collision, or towards its bounds if it has none.
+	static FVector CalculateFacing(const AActor* CoverObject, const FVector& CoverLocation);
+
+public:
+	// Marks a cover object to be reclustered.
+	void MarkDirty(const TWeakObjectPtr<const AActor>& CoverObject);
+
+	bool HasDirtyCoverObjects() const;
+
+	// Returns the dirty cover objects and forgets about them.
+	void PopDirtyCoverObjects(TArray<TWeakObjectPtr<const AActor>>& OutCoverObjects);
+
+	// Reclusters the supplied cover points of a cover object, replacing its former clusters. Game thread only.
+	void Rebuild(const TWeakObjectPtr<const AActor>& CoverObject, const TArray<FCoverPointOctreeElement>& CoverPoints);
+
+	// Finds the cluster of a cover point. Returns false if the cover point isn't clustered, e.g. because its cover object is still dirty.
+	bool FindCluster(FCoverCluster& OutCluster, const FVector& CoverLocation) const;
+
+	// Forgets about every cluster.
+	void Reset();
+
+	FORCEINLINE int32 GetClusterCount() const
+	{
+		FRWScopeLock ClusterLock(ClusterLockObject, FRWScopeLockType::SLT_ReadOnly);
+		return Clusters.Num();
+	}
+};
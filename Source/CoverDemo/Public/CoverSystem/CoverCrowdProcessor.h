@@ -0,0 +1,90 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CoverSystem/CoverPointOctreeElement.h"
+#include "CoverSystem/CoverExposureCache.h"
+
+class UCoverSystem;
+class ACharacter;
+class ANavigationData;
+struct FSquadCoverRequest;
+struct FSquadCoverQuerySettings;
+struct FSquadCoverAssignment;
+
+/**
+ * Finds cover for crowds of thousands of agents in one batch, see UCoverSystem::FindCrowdCover().
+ * Agents are snapshotted into flat per-agent arrays on the game thread, evaluated in parallel chunks on worker threads, each proposing its few closest adequate cover points,
+ * then the proposals are merged on the game thread in a fixed order so that the same requests always yield the same reservations, no matter how the chunks were scheduled.
+ * The workers only read the exposure cache, their own evaluations are added to it after the merge, in chunk order, so that no worker sees the outcomes of another.
+ * Owned by UCoverSystem and reused between batches so that its buffers don't get reallocated. Game thread only.
+ */
+class COVERDEMO_API FCoverCrowdProcessor
+{
+private:
+	// Number of agents evaluated by a worker in one go.
+	static constexpr int32 ChunkSize = 32;
+
+	// Number of adequate cover points each agent proposes, to fall back on when its closest ones are claimed by others.
+	static constexpr int32 ProposalsPerAgent = 3;
+
+	// Most cover points an agent evaluates, closest first, so that agents surrounded by bad cover don't hold up the batch.
+	static constexpr int32 MaxEvaluationsPerAgent = 16;
+
+	struct FCrowdProposal
+	{
+		// Straight-line distance from the agent to the cover point, negative for unused proposal slots.
+		float Cost;
+
+		FVector CoverLocation;
+	};
+
+	// the per-agent arrays below are parallel to each other
+
+	TArray<int32> RequestIndices;
+
+	TArray<const ACharacter*> Characters;
+
+	TArray<const AActor*> Enemies;
+
+	TArray<FVector> Locations;
+
+	TArray<FVector> EnemyLocations;
+
+	TArray<float> StandingEyeHeights;
+
+	TArray<float> CrouchedEyeHeights;
+
+	// Index of the agent's candidates in CandidateSets.
+	TArray<int32> CandidateSetIndices;
+
+	// ProposalsPerAgent slots per agent, filled by the workers.
+	TArray<FCrowdProposal> Proposals;
+
+	// Cover points around each enemy, shared by every agent targeting it.
+	TArray<TArray<FCoverPointOctreeElement>> CandidateSets;
+
+	// Sweeps of each chunk, summed up after the workers are done so that they don't contend over a counter.
+	TArray<int32> ChunkSweepCounts;
+
+	// Evaluations of each chunk, added to the exposure cache after the merge.
+	TArray<TArray<FCoverExposureDeferredEntry>> ChunkExposureEntries;
+
+	// Snapshots the agents and gathers the candidates of each enemy once. Game thread only.
+	void Gather(UCoverSystem* CoverSystem, const TArray<FSquadCoverRequest>& Requests, const FSquadCoverQuerySettings& Settings);
+
+	// Evaluates the agents of a chunk. Runs on worker threads while the game thread waits for them, so the world can't change underneath.
+	void EvaluateChunk(int32 ChunkIdx, UCoverSystem* CoverSystem, const ANavigationData* NavData, const FSquadCoverQuerySettings& Settings);
+
+	// Resolves the proposals into reservations: the cheapest ones win, ties are broken by the order of the requests. Game thread only.
+	int32 Merge(UCoverSystem* CoverSystem, TArray<FSquadCoverAssignment>& OutAssignments);
+
+public:
+	// Assigns and holds cover for the supplied agents. OutAssignments is parallel to Requests.
+	// Returns the number of agents that have been assigned cover.
+	int32 Process(UCoverSystem* CoverSystem, TArray<FSquadCoverAssignment>& OutAssignments, const TArray<FSquadCoverRequest>& Requests, const FSquadCoverQuerySettings& Settings);
+
+	// Frees the buffers.
+	void Reset();
+};
@@ -0,0 +1,157 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Misc/ScopeRWLock.h"
+#include "HAL/ThreadSafeCounter64.h"
+
+/**
+ * Identifies the outcome of an agent evaluating a cover point against an enemy.
+ * The agent is part of the key as its sweeps ignore only itself: other agents may stand in the way of the same sweep, or be standing in the way of it themselves.
+ */
+struct FCoverExposureKey
+{
+public:
+	// Enemy locations are quantized to cells of this size, i.e. the enemy has to move about this far for the outcome to be re-evaluated.
+	static constexpr float EnemyLocationQuantization = 50.0f;
+
+	// Eye heights are quantized to classes of this size, which sets standing and crouching apart.
+	static constexpr float EyeHeightQuantization = 20.0f;
+
+	FVector CoverLocation;
+
+	TWeakObjectPtr<const AActor> Agent;
+
+	TWeakObjectPtr<const AActor> Enemy;
+
+	FIntVector QuantizedEnemyLocation;
+
+	int32 EyeHeightClass;
+
+	// Hash of the evaluator's settings that affect the outcome, e.g. lean offset, so that differently set up finders don't share outcomes.
+	uint32 EvaluatorHash;
+
+	FCoverExposureKey()
+		: CoverLocation(), Agent(), Enemy(), QuantizedEnemyLocation(), EyeHeightClass(), EvaluatorHash()
+	{}
+
+	FCoverExposureKey(const FVector& _CoverLocation, const AActor* _Agent, const AActor* _Enemy, const FVector& _EnemyLocation, float _EyeHeight, uint32 _EvaluatorHash)
+		: CoverLocation(_CoverLocation),
+		Agent(_Agent),
+		Enemy(_Enemy),
+		QuantizedEnemyLocation(
+			FMath::FloorToInt(_EnemyLocation.X / EnemyLocationQuantization),
+			FMath::FloorToInt(_EnemyLocation.Y / EnemyLocationQuantization),
+			FMath::FloorToInt(_EnemyLocation.Z / EnemyLocationQuantization)),
+		EyeHeightClass(FMath::RoundToInt(_EyeHeight / EyeHeightQuantization)),
+		EvaluatorHash(_EvaluatorHash)
+	{}
+
+	FORCEINLINE bool operator==(const FCoverExposureKey& Other) const
+	{
+		return CoverLocation == Other.CoverLocation
+			&& Agent == Other.Agent
+			&& Enemy == Other.Enemy
+			&& QuantizedEnemyLocation == Other.QuantizedEnemyLocation
+			&& EyeHeightClass == Other.EyeHeightClass
+			&& EvaluatorHash == Other.EvaluatorHash;
+	}
+
+	FORCEINLINE friend uint32 GetTypeHash(const FCoverExposureKey& Key)
+	{
+		uint32 hash = HashCombine(GetTypeHash(Key.CoverLocation), HashCombine(GetTypeHash(Key.Agent), GetTypeHash(Key.Enemy)));
+		hash = HashCombine(hash, GetTypeHash(Key.QuantizedEnemyLocation));
+		return HashCombine(hash, HashCombine(GetTypeHash(Key.EyeHeightClass), Key.EvaluatorHash));
+	}
+};
+
+/**
+ * A cached cover point evaluation.
+ */
+struct FCoverExposureEntry
+{
+public:
+	// Whether the cover point was found to be adequate.
+	bool bGoodCover;
+
+	// Number of sweeps the evaluation took, i.e. the number of sweeps each hit saves.
+	int32 SweepCount;
+
+	// World time of the evaluation.
+	double EvaluationTime;
+
+	FCoverExposureEntry()
+		: bGoodCover(), SweepCount(), EvaluationTime()
+	{}
+
+	FCoverExposureEntry(bool _bGoodCover, int32 _SweepCount, double _EvaluationTime)
+		: bGoodCover(_bGoodCover), SweepCount(_SweepCount), EvaluationTime(_EvaluationTime)
+	{}
+};
+
+/**
+ * An evaluation that's to be added to FCoverExposureCache later, so that evaluations running in parallel don't see each other's outcomes.
+ */
+struct FCoverExposureDeferredEntry
+{
+public:
+	FCoverExposureKey Key;
+
+	bool bGoodCover;
+
+	int32 SweepCount;
+
+	FCoverExposureDeferredEntry()
+		: Key(), bGoodCover(), SweepCount()
+	{}
+
+	FCoverExposureDeferredEntry(const FCoverExposureKey& _Key, bool _bGoodCover, int32 _SweepCount)
+		: Key(_Key), bGoodCover(_bGoodCover), SweepCount(_SweepCount)
+	{}
+};
+
+/**
+ * Caches the outcome of cover point evaluations per agent and enemy, so that repeated searches of an agent, e.g. by services and EQS tests, don't sweep again.
+ * Entries expire after a short while of world time, so that paused or slowed down worlds keep them for as long in game terms and are invalidated whenever the navmesh or the cover points around them change. Owned by UCoverSystem, thread-safe.
+ */
+class COVERDEMO_API FCoverExposureCache
+{
+private:
+	mutable FRWLock ExposureCacheLockObject;
+
+	// How long an evaluation stays valid for, in seconds of world time. Covers changes in the world that we aren't notified about, e.g. other units moving around.
+	const double EntryLifetime = 0.5;
+
+	// Expired entries are purged once there are this many entries.
+	const int32 PurgeThreshold = 8192;
+
+	TMap<FCoverExposureKey, FCoverExposureEntry> Entries;
+
+	FThreadSafeCounter64 Hits;
+
+	FThreadSafeCounter64 Misses;
+
+	// Removes the expired entries. Assumes that ExposureCacheLockObject is held for writing.
+	void PurgeExpiredEntries(double Now);
+
+	void UpdateStats() const;
+
+public:
+	// Finds a cached evaluation that hasn't expired yet by Now, the current world time, see UWorld::GetTimeSeconds().
+	// Returns false if the cover point has to be evaluated.
+	bool Find(bool& bOutGoodCover, const FCoverExposureKey& Key, double Now);
+
+	// Caches an evaluation made at Now, the current world time.
+	void Add(const FCoverExposureKey& Key, bool bGoodCover, int32 SweepCount, double Now);
+
+	// Caches a batch of evaluations made at Now, in order.
+	void Add(const TArray<FCoverExposureDeferredEntry>& DeferredEntries, double Now);
+
+	// Drops the evaluations of the cover points within the supplied areas.
+	void Invalidate(const TArray<FBox>& Areas);
+
+	// Drops every evaluation.
+	void InvalidateAll();
+};
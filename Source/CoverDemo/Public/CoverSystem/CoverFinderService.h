@@ -9,9 +9,43 @@
 #include "AIController.h"
 #include "Engine/World.h"
 #include "CoverSystem/CoverSystem.h"
+#include "CoverSystem/CoverPointEvaluator.h"
+#include "CoverSystem/CoverPointScorer.h"
 #include "Debug/CoverFinderVisData.h"
+#include "UObject/StrongObjectPtr.h"
 #include "CoverFinderService.generated.h"
 
+/**
+ * Per-agent state of UCoverFinderService between ticks.
+ */
+struct FCoverFinderServiceMemory
+{
+public:
+	// The enemy the held cover has been found against.
+	TWeakObjectPtr<const AActor> TargetEnemy;
+
+	// Until when the held cover is only revalidated instead of looking for a better one.
+	double NextFullSearchTime = 0.0;
+
+	// Only allocated while debugging. Kept alive here as the blackboard only references it weakly.
+	TStrongObjectPtr<UCoverFinderVisData> DebugData;
+
+	// Our subscription to the changes of cover points around the enemy, INDEX_NONE if we haven't subscribed.
+	int32 CoverSubscriptionID = INDEX_NONE;
+
+	TWeakObjectPtr<UWorld> World;
+
+	// Set by the subscription when cover points around the enemy are added or removed, so that the next tick looks for a better cover point right away.
+	// Shared with the subscription's callback so that it never outlives us.
+	TSharedRef<bool> bCoverChanged = MakeShared<bool>(false);
+
+	~FCoverFinderServiceMemory()
+	{
+		if (CoverSubscriptionID != INDEX_NONE && World.IsValid() && !UCoverSystem::bShutdown)
+			UCoverSystem::GetInstance(World.Get())->GetChangeNotifier().Unsubscribe(CoverSubscriptionID);
+	}
+};
+
 /**
  * Finds suitable cover by looking around a unit in a full sphere.
  */
@@ -21,41 +55,50 @@ class COVERDEMO_API UCoverFinderService : public UBTService
 	GENERATED_BODY()
 	
 private:
-	static FVector GetPerpendicularVector(const FVector& Vector);
-
 	// Should be the same as the one defined in UCoverSystem.
 	const float CoverPointGroundOffset = 10.0f;
 
 	const FName Key_VisData = FName("VisData");
 
-	// Gather, filter and sort cover points.
+	// Gather and filter cover points. They get ranked by FCoverPointScorer afterwards, OutTakenCoverLocations receives the taken ones for its crowding term.
 	const void GetCoverPoints(
 		TArray<FCoverPointOctreeElement>& OutCoverPoints,
+		TArray<FVector>& OutTakenCoverLocations,
 		UWorld* World,
 		const FVector& PawnLocation,
 		const FVector& EnemyLocation,
-		UCoverFinderVisData& DebugData,
-		const bool bUnitDebug = false) const;
-
-	// Checks if there's clear line of sight to the enemy when leaning to the right.
-	const bool CheckHitByLeaning(
-		const FVector& CoverLocation,
-		const ACharacter* OurUnit,
-		const AActor* TargetEnemy,
-		UWorld* World,
-		UCoverFinderVisData& DebugData,
+		UCoverFinderVisData* DebugData,
 		const bool bUnitDebug = false) const;
 
-	const bool EvaluateCoverPoint(
-		const FCoverPointOctreeElement coverPoint,
+	// Checks whether the cover point our unit is holding is still adequate, with as few sweeps as possible.
+	// Returns false if it's no longer there, out of range or doesn't protect our unit anymore.
+	const bool RevalidateHeldCover(
+		const FVector& HeldCoverLocation,
 		const ACharacter* Character,
-		const float CharEyeHeight,
+		const float CharEyeHeightStanding,
+		const float CharEyeHeightCrouched,
 		const AActor* TargetEnemy,
 		const FVector& EnemyLocation,
+		const TArray<FCoverThreat>& Threats,
 		UWorld* World,
-		UCoverFinderVisData& DebugData,
+		UCoverFinderVisData* DebugData,
 		const bool bUnitDebug = false) const;
 
+	// Checks if our unit can reach the cover point.
+	// Uses the navmesh islands of UCoverSystem and only falls back to pathfinding if they don't know about either poly.
+	const bool IsCoverPointReachable(
+		const FCoverPointOctreeElement& CoverPoint,
+		const ACharacter* Character,
+		const FVector& CharacterLocation,
+		const NavNodeRef CharacterPolyRef,
+		UWorld* World) const;
+
+	// Settings of ours that FCoverPointEvaluator needs.
+	FORCEINLINE FCoverEvaluationSettings GetEvaluationSettings() const
+	{
+		return FCoverEvaluationSettings(WeaponLeanOffset, CoverPointMaxObjectHitDistance, CoverPointGroundOffset, bUseOcclusionGrid);
+	}
+
 public:
 	UPROPERTY(EditAnywhere, Category = Blackboard)
 	FBlackboardKeySelector DrawDebug;
@@ -84,5 +127,48 @@ public:
 	UPROPERTY(EditAnywhere, Category = Blackboard)
 	float CoverPointMaxObjectHitDistance = 310.0f; // was 100.0f
 
+	// How far our unit may walk to get into cover, along the navmesh. Cover points further away than this are skipped.
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	float MaxCoverPathCost = 3000.0f;
+
+	// How cover points are ranked before they're evaluated.
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FCoverScoringSettings ScoringSettings;
+
+	// Only this many of the best ranked cover points are evaluated.
+	UPROPERTY(EditAnywhere, Category = Blackboard, meta = (ClampMin = "1"))
+	int32 MaxScoredCandidates = 32;
+
+	// Other enemies that our unit has to stay hidden from besides Enemy, gathered around it. None = only Enemy is considered.
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	TSubclassOf<AActor> ThreatClass;
+
+	// How far from our unit other enemies are considered threats.
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	float ThreatRadius = 3000.0f;
+
+	// At most this many other enemies are considered threats, the closest ones.
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	int32 MaxThreats = 8;
+
+	// Reject exposed cover points via the occlusion grid of UCoverSystem before sweeping. Has no effect unless UCoverSystem::bBuildOcclusionGrid is set.
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	bool bUseOcclusionGrid = true;
+
+	// How often to look for a better cover point while the held one is still adequate, in seconds. In between, only the held cover point is revalidated.
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	float FullSearchInterval = 2.0f;
+
+	// Subscribe to the changes of cover points around the enemy and look for a better cover point as soon as any are added or removed, instead of only every FullSearchInterval.
+	// Lets FullSearchInterval and the interval of the service be much longer.
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	bool bSubscribeToCoverChanges = true;
+
 	virtual void TickNode(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;
+
+	virtual uint16 GetInstanceMemorySize() const override;
+
+	virtual void InitializeMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryInit::Type InitType) const override;
+
+	virtual void CleanupMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryClear::Type CleanupType) const override;
 };
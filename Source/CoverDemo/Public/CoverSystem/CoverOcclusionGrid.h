@@ -0,0 +1,121 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/World.h"
+#include "Misc/ScopeRWLock.h"
+
+// Result of a line of sight check against FCoverOcclusionGrid.
+enum class EOcclusionGridResult : uint8
+{
+	// No solid voxel along the line, i.e. a sight sweep along it hits no static geometry.
+	Clear,
+
+	// The line crosses a solid voxel, which may or may not block it in reality as voxels are solid if any static geometry comes close to them.
+	// A sight sweep along the line doesn't hit static geometry before the line enters the first solid voxel.
+	Blocked,
+
+	// The line crosses voxels that haven't been voxelized yet.
+	Unknown
+};
+
+/**
+ * A cubic block of ChunkSize^3 voxels, one bit each.
+ */
+struct FOcclusionChunk
+{
+public:
+	// Chunks are 1 << ChunkShift voxels wide.
+	static constexpr int32 ChunkShift = 3;
+	static constexpr int32 ChunkSize = 1 << ChunkShift;
+	static constexpr int32 WordCount = ChunkSize * ChunkSize * ChunkSize / 64;
+
+	// Voxels that static geometry comes close to, see FCoverOcclusionGrid.
+	uint64 Solid[WordCount];
+
+	// Voxels that have been voxelized.
+	uint64 Known[WordCount];
+
+	FOcclusionChunk()
+	{
+		FMemory::Memzero(Solid);
+		FMemory::Memzero(Known);
+	}
+
+	// Index of the bit of a voxel, in grid space.
+	FORCEINLINE static int32 GetVoxelIdx(const FIntVector& Voxel)
+	{
+		const int32 localMask = ChunkSize - 1;
+		return (Voxel.X & localMask) + ChunkSize * ((Voxel.Y & localMask) + ChunkSize * (Voxel.Z & localMask));
+	}
+
+	FORCEINLINE bool IsKnown(int32 VoxelIdx) const
+	{
+		return (Known[VoxelIdx >> 6] >> (VoxelIdx & 63)) & 1;
+	}
+
+	FORCEINLINE bool IsSolid(int32 VoxelIdx) const
+	{
+		return (Solid[VoxelIdx >> 6] >> (VoxelIdx & 63)) & 1;
+	}
+
+	FORCEINLINE void SetVoxel(int32 VoxelIdx, bool bSolid)
+	{
+		const uint64 voxelBit = uint64(1) << (VoxelIdx & 63);
+		Known[VoxelIdx >> 6] |= voxelBit;
+		if (bSolid)
+			Solid[VoxelIdx >> 6] |= voxelBit;
+		else
+			Solid[VoxelIdx >> 6] &= ~voxelBit;
+	}
+};
+
+/**
+ * Coarse voxelization of the static geometry that blocks line of sight, for rejecting cover points without physics sweeps.
+ * Only static and stationary components are voxelized, as anything that can move, e.g. pawns and movable cover, would be out of date by the time the grid is queried.
+ * Voxels are solid if static geometry comes within FCoverPointEvaluator::SightSweepRadius of them, so the grid overestimates occlusion even for the sphere sweeps of the evaluator:
+ * a Clear line is clear of static geometry for a sight sweep too, and a Blocked one isn't blocked by static geometry any closer than where it enters the first solid voxel.
+ * Dynamic objects aren't known to the grid at all, they have to be checked for separately.
+ * Built per navmesh tile by FNavmeshCoverPointGeneratorTask if UCoverSystem::bBuildOcclusionGrid is set, and rebuilt along with the tile. Owned by UCoverSystem, thread-safe.
+ */
+class COVERDEMO_API FCoverOcclusionGrid
+{
+private:
+	mutable FRWLock OcclusionGridLockObject;
+
+	// Edge length of a voxel.
+	const float VoxelSize = 50.0f;
+
+	// Columns of voxels that don't overlap anything are skipped with a single overlap test. This is how many voxels tall a column is at most.
+	const int32 MaxColumnHeight = 32;
+
+	TMap<FIntVector, FOcclusionChunk> Chunks;
+
+	FORCEINLINE FIntVector GetVoxel(const FVector& Location) const
+	{
+		return FIntVector(
+			FMath::FloorToInt(Location.X / VoxelSize),
+			FMath::FloorToInt(Location.Y / VoxelSize),
+			FMath::FloorToInt(Location.Z / VoxelSize));
+	}
+
+	FORCEINLINE static FIntVector GetChunk(const FIntVector& Voxel)
+	{
+		return FIntVector(Voxel.X >> FOcclusionChunk::ChunkShift, Voxel.Y >> FOcclusionChunk::ChunkShift, Voxel.Z >> FOcclusionChunk::ChunkShift);
+	}
+
+	// Overlap tests the voxels within the supplied voxel bounds against static geometry, dilated by the sight sweep radius. Bits of OutSolid are in X, Y, Z order.
+	void VoxelizeArea(TBitArray<>& OutSolid, UWorld* World, const FIntVector& MinVoxel, const FIntVector& MaxVoxel) const;
+
+public:
+	// Voxelizes the supplied areas, replacing whatever has been voxelized there before. Can be called from any thread that may query the physics scene.
+	void Voxelize(UWorld* World, const TArray<FBox>& Areas);
+
+	// Walks the voxels between Start and End.
+	// OutBlockDistance receives the distance from Start at which the line enters the first solid voxel, if it's Blocked.
+	EOcclusionGridResult TraceLineOfSight(const FVector& Start, const FVector& End, float& OutBlockDistance) const;
+
+	// Forgets about every voxel.
+	void Reset();
+};
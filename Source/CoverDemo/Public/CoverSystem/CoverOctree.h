@@ -30,7 +30,8 @@ public:
 	bool AnyCoverPointsWithinBounds(const FBoxCenterAndExtent& QueryBox) const;
 
 	// Finds cover points that intersect the supplied box.
-	void FindCoverPoints(TArray<FCoverPointOctreeElement>& OutCoverPoints, const FBox& QueryBox) const;
+	// Returns the number of octree nodes visited.
+	int32 FindCoverPoints(TArray<FCoverPointOctreeElement>& OutCoverPoints, const FBox& QueryBox) const;
 
 	// Finds cover points that intersect the supplied sphere.
 	void FindCoverPoints(TArray<FCoverPointOctreeElement>& OutCoverPoints, const FSphere& QuerySphere) const;
@@ -0,0 +1,201 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/World.h"
+#include "CoverSystem/CoverPointOctreeElement.h"
+#include "CoverSystem/CoverExposureCache.h"
+#include "Debug/CoverFinderVisData.h"
+
+class ACharacter;
+
+/**
+ * Settings of a cover finder that affect whether a cover point is adequate.
+ */
+struct FCoverEvaluationSettings
+{
+public:
+	// How much our weapon moves horizontally when we're leaning. 0 = unit can't lean at all.
+	float WeaponLeanOffset;
+
+	// How close must the actual cover object be to a cover point.
+	float CoverPointMaxObjectHitDistance;
+
+	// Should be the same as the one defined in UCoverSystem.
+	float CoverPointGroundOffset;
+
+	// Whether to reject cover points that are evidently exposed via UCoverSystem's occlusion grid before sweeping, if it has been built.
+	bool bUseOcclusionGrid;
+
+	FCoverEvaluationSettings()
+		: WeaponLeanOffset(), CoverPointMaxObjectHitDistance(), CoverPointGroundOffset(), bUseOcclusionGrid()
+	{}
+
+	FCoverEvaluationSettings(float _WeaponLeanOffset, float _CoverPointMaxObjectHitDistance, float _CoverPointGroundOffset, bool _bUseOcclusionGrid = false)
+		: WeaponLeanOffset(_WeaponLeanOffset), CoverPointMaxObjectHitDistance(_CoverPointMaxObjectHitDistance), CoverPointGroundOffset(_CoverPointGroundOffset), bUseOcclusionGrid(_bUseOcclusionGrid)
+	{}
+
+	// Finders with the same hash share cached evaluations.
+	FORCEINLINE uint32 GetHash() const
+	{
+		return HashCombine(HashCombine(HashCombine(GetTypeHash(WeaponLeanOffset), GetTypeHash(CoverPointMaxObjectHitDistance)), GetTypeHash(CoverPointGroundOffset)), GetTypeHash(bUseOcclusionGrid));
+	}
+};
+
+/**
+ * An enemy that our unit has to stay hidden from, besides the one it's fighting.
+ */
+struct FCoverThreat
+{
+public:
+	TWeakObjectPtr<const AActor> Actor;
+
+	FVector Location;
+
+	FCoverThreat()
+		: Actor(), Location()
+	{}
+
+	FCoverThreat(const AActor* _Actor, const FVector& _Location)
+		: Actor(_Actor), Location(_Location)
+	{}
+};
+
+/**
+ * Checks whether cover points protect a unit from an enemy while still letting it shoot back.
+ * Shared by UFindCover, UCoverFinderService, the EQS cover tests and the squad and crowd cover queries of UCoverSystem.
+ * The evaluations only sweep the physics scene and use the thread-safe parts of UCoverSystem, so they may run on worker threads as long as the game thread waits for them,
+ * i.e. nothing moves underneath. Evaluations running in parallel should defer their writes to the exposure cache, see DeferredExposureEntries, so that they don't see each other's outcomes.
+ * CheckCluster() is game thread only.
+ */
+class COVERDEMO_API FCoverPointEvaluator
+{
+private:
+	static FVector GetPerpendicularVector(const FVector& Vector);
+
+	// Checks if there's clear line of sight to the enemy when leaning to the left or to the right.
+	static bool CheckHitByLeaning(
+		const FCoverEvaluationSettings& Settings,
+		const FVector& CoverLocation,
+		const ACharacter* OurUnit,
+		const AActor* TargetEnemy,
+		UWorld* World,
+		int32& SweepCount,
+		UCoverFinderVisData* DebugData,
+		const bool bUnitDebug);
+
+	// Clusters with fewer cover points than this aren't worth a sweep of their own, their cover points are evaluated right away.
+	static constexpr int32 MinPrunedClusterSize = 3;
+
+	// Clusters fail if the enemy is further behind them than this, i.e. if the cover object isn't between them and the enemy. Slightly negative as the facings of the cover points within a cluster vary.
+	static constexpr float MinClusterFacingDot = -0.1f;
+
+	// Sets cached protection-only evaluations apart from full ones.
+	static constexpr uint32 ProtectionHashSalt = 0x9e3779b9;
+
+	// Checks if there's something between the eye location and the threat, i.e. whether our unit is hidden from it.
+	// OutBlockDistance receives how far from the eye location the line of sight is blocked.
+	static bool IsHiddenFrom(
+		const FVector& EyeLocation,
+		const AActor* Threat,
+		const FVector& ThreatLocation,
+		const ACharacter* Character,
+		UWorld* World,
+		int32& SweepCount,
+		float& OutBlockDistance);
+
+public:
+	// Radius of the sphere that lines of sight are swept with. FCoverOcclusionGrid dilates its voxels by this much.
+	static constexpr float SightSweepRadius = 5.0f;
+
+	// Checks if the cover point protects our unit from the enemy while still letting it shoot back, from the supplied eye height.
+	// SweepCount is incremented by the number of sweeps done. DebugData may only be null if bUnitDebug is false.
+	static bool EvaluateCoverPoint(
+		const FCoverEvaluationSettings& Settings,
+		const FCoverPointOctreeElement& CoverPoint,
+		const ACharacter* Character,
+		const float CharEyeHeight,
+		const AActor* TargetEnemy,
+		const FVector& EnemyLocation,
+		UWorld* World,
+		int32& SweepCount,
+		UCoverFinderVisData* DebugData = nullptr,
+		const bool bUnitDebug = false);
+
+	// Same as EvaluateCoverPoint(), but reuses the outcome of recent evaluations of the same cover point against the same enemy by the same unit.
+	// Always evaluates when debugging the unit so that the debug shapes get drawn.
+	// If DeferredExposureEntries is supplied, the exposure cache is only read and new outcomes are appended to it instead, to be added to the cache later.
+	static bool EvaluateCoverPointCached(
+		const FCoverEvaluationSettings& Settings,
+		const FCoverPointOctreeElement& CoverPoint,
+		const ACharacter* Character,
+		const float CharEyeHeight,
+		const AActor* TargetEnemy,
+		const FVector& EnemyLocation,
+		UWorld* World,
+		int32& SweepCount,
+		UCoverFinderVisData* DebugData = nullptr,
+		const bool bUnitDebug = false,
+		TArray<FCoverExposureDeferredEntry>* DeferredExposureEntries = nullptr);
+
+	// Same as EvaluateCoverPointCached(), but our unit also has to be hidden from every other threat. It doesn't need to be able to shoot back at them though.
+	// Threats are checked closest first, as those are the most dangerous ones and the likeliest to see our unit, and the check stops at the first one that does.
+	// Threats behind the same piece of cover share a sweep, so the number of sweeps grows slower than the number of threats. A further threat shares the sweep towards a closer one if
+	// the line of sight towards it passes within the sweep radius of where the closer one's was blocked, i.e. the same spot of the cover object blocks both.
+	static bool EvaluateCoverPointAgainstThreats(
+		const FCoverEvaluationSettings& Settings,
+		const FCoverPointOctreeElement& CoverPoint,
+		const ACharacter* Character,
+		const float CharEyeHeight,
+		const AActor* TargetEnemy,
+		const FVector& EnemyLocation,
+		const TArray<FCoverThreat>& Threats,
+		UWorld* World,
+		int32& SweepCount,
+		UCoverFinderVisData* DebugData = nullptr,
+		const bool bUnitDebug = false,
+		TArray<FCoverExposureDeferredEntry>* DeferredExposureEntries = nullptr);
+
+	// The threat half of EvaluateCoverPointAgainstThreats(): checks whether our unit is hidden from every threat but IgnoredThreat, without having to be able to shoot back at any of them.
+	// DeferredExposureEntries works the same as in EvaluateCoverPointCached().
+	static bool IsHiddenFromThreats(
+		const FCoverEvaluationSettings& Settings,
+		const FCoverPointOctreeElement& CoverPoint,
+		const ACharacter* Character,
+		const float CharEyeHeight,
+		const AActor* IgnoredThreat,
+		const TArray<FCoverThreat>& Threats,
+		UWorld* World,
+		int32& SweepCount,
+		UCoverFinderVisData* DebugData = nullptr,
+		const bool bUnitDebug = false,
+		TArray<FCoverExposureDeferredEntry>* DeferredExposureEntries = nullptr);
+
+	// Coarse check of the cluster the cover point belongs to, before evaluating the cover point itself. Clusters are checked once per search and the outcome is kept in ClusterOutcomes, keyed by the representative location of the cluster.
+	// The cluster fails if its cover object doesn't face the enemy, or if the enemy can be seen from its representative cover point at CharEyeHeight, which should be the lowest one our unit can take.
+	// Returns false if none of the cover points in the cluster are likely to be adequate. Game thread only, as the clusters are brought up to date on demand.
+	static bool CheckCluster(
+		const FCoverEvaluationSettings& Settings,
+		const FCoverPointOctreeElement& CoverPoint,
+		const ACharacter* Character,
+		const float CharEyeHeight,
+		const AActor* TargetEnemy,
+		const FVector& EnemyLocation,
+		UWorld* World,
+		TMap<FVector, bool>& ClusterOutcomes,
+		int32& SweepCount);
+
+	// Gathers the actors of ThreatClass within Radius of Center, closest first, except for TargetEnemy. Does nothing if ThreatClass isn't set.
+	static void GatherThreats(
+		TArray<FCoverThreat>& OutThreats,
+		UWorld* World,
+		TSubclassOf<AActor> ThreatClass,
+		const FVector& Center,
+		float Radius,
+		const AActor* TargetEnemy,
+		int32 MaxThreats);
+
+	// Updates the locations of the threats and drops the ones that are gone.
+	static void UpdateThreats(TArray<FCoverThreat>& Threats);
+};
@@ -19,14 +19,17 @@ public:
 	// Object that generated this cover point
 	const TWeakObjectPtr<AActor> CoverObject;
 
+	// Navmesh poly the cover point is on, see UCoverSystem::GetReachability()
+	const NavNodeRef NavPolyRef;
+
 	// Whether the cover point is taken by a unit
 	bool bTaken = false;
 
 	FCoverPointOctreeData()
-		: Location(), bForceField(false), CoverObject(), bTaken(false)
+		: Location(), bForceField(false), CoverObject(), NavPolyRef(INVALID_NAVNODEREF), bTaken(false)
 	{}
 
 	FCoverPointOctreeData(FDTOCoverData CoverData)
-		: Location(CoverData.Location), bForceField(CoverData.bForceField), CoverObject(CoverData.CoverObject), bTaken(false)
+		: Location(CoverData.Location), bForceField(CoverData.bForceField), CoverObject(CoverData.CoverObject), NavPolyRef(CoverData.NavPolyRef), bTaken(false)
 	{}
 };
@@ -0,0 +1,97 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CoverSystem/CoverPointOctreeElement.h"
+#include "CoverPointScorer.generated.h"
+
+/**
+ * How cover points are ranked before they're evaluated, see FCoverPointScorer.
+ * Every term is normalized to roughly [0, 1] so that the weights are comparable. A weight of 0 turns its term off.
+ */
+USTRUCT(BlueprintType)
+struct FCoverScoringSettings
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+	// Weight of the cost of walking to the cover point, relative to the max path cost.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CoverScoring)
+	float PathCostWeight = 1.0f;
+
+	// Weight of how far the cover point is from PreferredEnemyDistance.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CoverScoring)
+	float EnemyDistanceWeight = 0.25f;
+
+	// Weight of moving towards the enemy to get into cover. Cover points behind our unit score best.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CoverScoring)
+	float EnemyAngleWeight = 0.25f;
+
+	// Weight of the cover point being lower than the enemy.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CoverScoring)
+	float HeightWeight = 0.1f;
+
+	// Weight of each taken cover point within CrowdingRadius, so that units spread out instead of bunching up.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CoverScoring)
+	float CrowdingWeight = 0.5f;
+
+	// Distance from the enemy that we'd like to fight from.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CoverScoring)
+	float PreferredEnemyDistance = 600.0f;
+
+	// Height difference to the enemy at which the height term maxes out.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CoverScoring)
+	float HeightScale = 200.0f;
+
+	// Taken cover points closer than this count towards crowding.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CoverScoring)
+	float CrowdingRadius = 200.0f;
+};
+
+/**
+ * Ranks cover candidates by a weighted utility of distance to our unit, distance and angle to the enemy, height and crowding.
+ * The candidates are packed into aligned SoA buffers and scored four at a time with vector instructions, then only the best ones are kept.
+ * This replaces sorting every candidate by its path cost: scoring is linear and only the kept ones get sorted. Game thread only, as the buffers are shared.
+ */
+class COVERDEMO_API FCoverPointScorer
+{
+private:
+	// Number of candidates scored at once.
+	static constexpr int32 LaneCount = 4;
+
+	typedef TArray<float, TAlignedHeapAllocator<16>> FAlignedFloatArray;
+
+	// Packed candidate attributes, padded to a multiple of LaneCount. Kept across calls to avoid reallocating them.
+	static FAlignedFloatArray LocationsX;
+	static FAlignedFloatArray LocationsY;
+	static FAlignedFloatArray LocationsZ;
+	static FAlignedFloatArray TravelCosts;
+	static FAlignedFloatArray Utilities;
+
+	// Packs the candidates into the SoA buffers. Unknown path costs are replaced by the straight-line distance, which is a lower bound of them.
+	static void PackCandidates(const TArray<FCoverPointOctreeElement>& CoverPoints, const TArray<float>& PathCosts, const FVector& CharacterLocation);
+
+	// Fills Utilities from the packed candidates, lower is better.
+	static void ScoreCandidates(
+		int32 NumPackedCandidates,
+		const TArray<FVector>& TakenCoverLocations,
+		const FVector& CharacterLocation,
+		const FVector& EnemyLocation,
+		float MaxPathCost,
+		const FCoverScoringSettings& Settings);
+
+public:
+	// Scores the cover points and keeps the best MaxCandidates of them, sorted best first. PathCosts is parallel to CoverPoints and is kept so.
+	// Unknown path costs (UCoverSystem::UnknownPathCost) are scored by the straight-line distance.
+	// TakenCoverLocations are the cover points that are already held by other units, for crowding.
+	static void SelectBest(
+		TArray<FCoverPointOctreeElement>& CoverPoints,
+		TArray<float>& PathCosts,
+		const TArray<FVector>& TakenCoverLocations,
+		const FVector& CharacterLocation,
+		const FVector& EnemyLocation,
+		float MaxPathCost,
+		const FCoverScoringSettings& Settings,
+		int32 MaxCandidates);
+};
@@ -0,0 +1,101 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/ScopeRWLock.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "CoverSystem/CoverPointOctreeElement.h"
+#include <atomic>
+
+/**
+ * Identifies an octree query by its box, quantized outwards so that nearly identical boxes, e.g. the attack ranges of agents around the same enemy, share a key.
+ */
+struct FCoverQueryKey
+{
+public:
+	// Query boxes are snapped outwards to a grid of this size.
+	static constexpr float BoxQuantization = 50.0f;
+
+	FIntVector QuantizedMin;
+
+	FIntVector QuantizedMax;
+
+	FCoverQueryKey()
+		: QuantizedMin(), QuantizedMax()
+	{}
+
+	FCoverQueryKey(const FBox& QueryBox)
+		: QuantizedMin(
+			FMath::FloorToInt(QueryBox.Min.X / BoxQuantization),
+			FMath::FloorToInt(QueryBox.Min.Y / BoxQuantization),
+			FMath::FloorToInt(QueryBox.Min.Z / BoxQuantization)),
+		QuantizedMax(
+			FMath::CeilToInt(QueryBox.Max.X / BoxQuantization),
+			FMath::CeilToInt(QueryBox.Max.Y / BoxQuantization),
+			FMath::CeilToInt(QueryBox.Max.Z / BoxQuantization))
+	{}
+
+	// The box the octree is actually queried with, which contains every box with the same key.
+	FORCEINLINE FBox GetBox() const
+	{
+		return FBox(FVector(QuantizedMin) * BoxQuantization, FVector(QuantizedMax) * BoxQuantization);
+	}
+
+	FORCEINLINE bool operator==(const FCoverQueryKey& Other) const
+	{
+		return QuantizedMin == Other.QuantizedMin && QuantizedMax == Other.QuantizedMax;
+	}
+
+	FORCEINLINE friend uint32 GetTypeHash(const FCoverQueryKey& Key)
+	{
+		return HashCombine(GetTypeHash(Key.QuantizedMin), GetTypeHash(Key.QuantizedMax));
+	}
+};
+
+/**
+ * Caches the results of octree queries for the rest of the frame, so that agents scanning around the same enemy in the same frame only walk the octree once.
+ * Entries are only valid for the frame and the version of the cover data they were queried in, UCoverSystem bumps the version on every change to the octree.
+ * Taken flags need no invalidation as cached cover points share their data with the octree. Owned by UCoverSystem, thread-safe.
+ * Lookups that can't hit and additions that can't be stored are turned away before the lock is taken, so a stale or full cache costs no locking.
+ */
+class COVERDEMO_API FCoverQueryCache
+{
+private:
+	mutable FRWLock QueryCacheLockObject;
+
+	// Queries beyond this many per frame aren't cached.
+	const int32 MaxEntries = 64;
+
+	// The frame and the cover data version that the entries belong to. Only written under the lock but read outside of it, too.
+	std::atomic<uint64> FrameNumber { 0 };
+	std::atomic<uint64> CoverDataVersion { 0 };
+
+	TMap<FCoverQueryKey, TArray<FCoverPointOctreeElement>> Entries;
+
+	// Number of Entries, readable without the lock.
+	std::atomic<int32> EntryCount { 0 };
+
+	// Whether the entries belong to the current frame and Version of the cover data, checked without the lock. Only a hint, it's checked again under the lock.
+	FORCEINLINE bool IsCurrent(uint64 Version) const
+	{
+		return FrameNumber.load(std::memory_order_relaxed) == GFrameCounter && CoverDataVersion.load(std::memory_order_relaxed) == Version;
+	}
+
+	// Lookups of the current frame.
+	FThreadSafeCounter Hits;
+	FThreadSafeCounter Misses;
+
+	void UpdateStats() const;
+
+public:
+	// Copies the cover points that intersect QueryBox out of a cached query, if there's one for the current frame and Version of the cover data.
+	// Returns false if the octree has to be queried with the box of the key and the result added via Add().
+	bool Find(TArray<FCoverPointOctreeElement>& OutCoverPoints, const FCoverQueryKey& Key, const FBox& QueryBox, uint64 Version);
+
+	// Caches the cover points within the box of the key, dropping the entries of past frames and versions.
+	void Add(const FCoverQueryKey& Key, uint64 Version, const TArray<FCoverPointOctreeElement>& CoverPoints);
+
+	// Appends the cover points that intersect QueryBox, the same way TCoverOctree::FindCoverPoints() tests them.
+	static void FilterByBox(TArray<FCoverPointOctreeElement>& OutCoverPoints, const TArray<FCoverPointOctreeElement>& CoverPoints, const FBox& QueryBox);
+};
@@ -13,6 +13,19 @@
 #include "Engine/World.h"
 #include "Misc/ScopeRWLock.h"
 #include "CoverSystem/DTOCoverData.h"
+#include "CoverSystem/MeshCoverTemplateKey.h"
+#include "CoverSystem/ActorCoverGenerationScheduler.h"
+#include "CoverSystem/TileCoverGenerationDispatcher.h"
+#include "CoverSystem/NavmeshIslands.h"
+#include "CoverSystem/NavmeshDistanceFlood.h"
+#include "CoverSystem/CoverExposureCache.h"
+#include "CoverSystem/CoverClusters.h"
+#include "CoverSystem/CoverPointEvaluator.h"
+#include "CoverSystem/CoverOcclusionGrid.h"
+#include "CoverSystem/CoverQueryCache.h"
+#include "CoverSystem/CoverChangeNotifier.h"
+#include "CoverSystem/CoverCrowdProcessor.h"
+#include "GameFramework/Character.h"
 #include "CoverSystem.generated.h"
 
 // PROFILER INTEGRATION //
@@ -24,10 +37,171 @@ DECLARE_CYCLE_STAT_EXTERN(TEXT("Generate Cover / GenerateCoverInBounds"), STAT_G
 DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Generate Cover - Historical Count"), STAT_GenerateCoverHistoricalCount, STATGROUP_CoverSystem);
 DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Generate Cover - Total Time Spent"), STAT_GenerateCoverAverageTime, STATGROUP_CoverSystem);
 DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Generate Cover - Active Tasks"), STAT_TaskCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Generate Cover - Edges Outside Dirty Areas"), STAT_GenerateCoverSkippedEdgeCount, STATGROUP_CoverSystem);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tile Generation / Prioritize"), STAT_TileGenerationPrioritize, STATGROUP_CoverSystem, COVERDEMO_API);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tile Generation - Queue Depth"), STAT_TileGenerationQueueDepth, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tile Generation - Tasks In Flight"), STAT_TileGenerationTasksInFlight, STATGROUP_CoverSystem);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Tile Generation - Average Task Cost (ms)"), STAT_TileGenerationAverageTaskCost, STATGROUP_CoverSystem);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Tile Generation - Average Latency (ms)"), STAT_TileGenerationAverageLatency, STATGROUP_CoverSystem);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Tile Generation - Max Latency (ms)"), STAT_TileGenerationMaxLatency, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tile Generation - Cover Pending Tiles"), STAT_TileGenerationCoverPendingCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tile Generation - Tiles Woken Up"), STAT_TileGenerationWokenCount, STATGROUP_CoverSystem);
 
 DECLARE_CYCLE_STAT_EXTERN(TEXT("Find Cover"), STAT_FindCover, STATGROUP_CoverSystem, COVERDEMO_API);
 DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Find Cover - Historical Count"), STAT_FindCoverHistoricalCount, STATGROUP_CoverSystem);
 DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Find Cover - Total Time Spent"), STAT_FindCoverTotalTimeSpent, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Find Cover - Latent Ticks"), STAT_FindCoverLatentTickCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Find Cover - Rejected By Islands"), STAT_FindCoverIslandRejectCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Find Cover - Pathfinding Fallbacks"), STAT_FindCoverPathfindingCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Find Cover - Rejected By Path Cost"), STAT_FindCoverPathCostRejectCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Find Cover - Held Cover Revalidations"), STAT_FindCoverRevalidationCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Find Cover - Sweeps"), STAT_FindCoverSweepCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Find Cover - Rejected By Other Threats"), STAT_FindCoverThreatRejectCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Find Cover - Shared Threat Sweeps"), STAT_FindCoverSharedThreatSweepCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Find Cover - Rejected By Cluster"), STAT_FindCoverClusterRejectCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Find Cover - Rejected By Occlusion Grid"), STAT_FindCoverOcclusionGridRejectCount, STATGROUP_CoverSystem);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Cover Scoring"), STAT_CoverScoring, STATGROUP_CoverSystem, COVERDEMO_API);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Cover Scoring - Candidates Scored"), STAT_CoverScoringCandidateCount, STATGROUP_CoverSystem);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Squad Cover"), STAT_SquadCover, STATGROUP_CoverSystem, COVERDEMO_API);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Squad Cover - Agents Assigned"), STAT_SquadCoverAssignedCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Squad Cover - Sweeps"), STAT_SquadCoverSweepCount, STATGROUP_CoverSystem);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Crowd Cover"), STAT_CrowdCover, STATGROUP_CoverSystem, COVERDEMO_API);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Crowd Cover - Agents"), STAT_CrowdCoverAgentCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Crowd Cover - Agents Assigned"), STAT_CrowdCoverAssignedCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Crowd Cover - Sweeps"), STAT_CrowdCoverSweepCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Crowd Cover - Proposals Lost To Other Agents"), STAT_CrowdCoverConflictCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Crowd Cover - Last Batch Size"), STAT_CrowdCoverLastBatchSize, STATGROUP_CoverSystem);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Crowd Cover - Last Batch Time (ms)"), STAT_CrowdCoverLastBatchTime, STATGROUP_CoverSystem);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Crowd Cover - Agents Per ms"), STAT_CrowdCoverThroughput, STATGROUP_CoverSystem);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Exposure Cache - Hits"), STAT_ExposureCacheHits, STATGROUP_CoverSystem);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Exposure Cache - Hit Rate (%)"), STAT_ExposureCacheHitRate, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Exposure Cache - Sweeps Avoided"), STAT_ExposureCacheSweepsAvoided, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Exposure Cache - Entries"), STAT_ExposureCacheEntryCount, STATGROUP_CoverSystem);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Query Cache - Hits Per Frame"), STAT_CoverQueryCacheHits, STATGROUP_CoverSystem);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Query Cache - Hit Rate This Frame (%)"), STAT_CoverQueryCacheHitRate, STATGROUP_CoverSystem);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Query Cache - Octree Nodes Visited Per Frame"), STAT_CoverQueryNodeCount, STATGROUP_CoverSystem);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Cover Changes - Subscriptions"), STAT_CoverSubscriptionCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Cover Changes - Notifications"), STAT_CoverChangeNotificationCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Cover Changes - Changes Delivered"), STAT_CoverChangeDeliveredCount, STATGROUP_CoverSystem);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Cover Clusters / Rebuild"), STAT_RebuildCoverClusters, STATGROUP_CoverSystem, COVERDEMO_API);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Cover Clusters - Count"), STAT_CoverClusterCount, STATGROUP_CoverSystem);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Occlusion Grid / Voxelize"), STAT_VoxelizeOcclusionGrid, STATGROUP_CoverSystem, COVERDEMO_API);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Occlusion Grid - Chunks"), STAT_OcclusionGridChunkCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Occlusion Grid - Traces"), STAT_OcclusionGridTraceCount, STATGROUP_CoverSystem);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Navmesh Islands / Rebuild"), STAT_RebuildNavmeshIslands, STATGROUP_CoverSystem, COVERDEMO_API);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Navmesh Islands - Count"), STAT_NavmeshIslandCount, STATGROUP_CoverSystem);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Navmesh Distance Flood"), STAT_NavmeshDistanceFlood, STATGROUP_CoverSystem, COVERDEMO_API);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Navmesh Distance Flood - Polys Reached"), STAT_NavmeshDistanceFloodPolyCount, STATGROUP_CoverSystem);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Move Cover"), STAT_MoveCover, STATGROUP_CoverSystem, COVERDEMO_API);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Move Cover - Historical Count"), STAT_MoveCoverHistoricalCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Move Cover - Full Regenerations"), STAT_MoveCoverRegenerationCount, STATGROUP_CoverSystem);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Actor Generation - Requests"), STAT_ActorGenerationRequestCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Actor Generation - Duplicate Requests Dropped"), STAT_ActorGenerationDuplicateCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Actor Generation - Requests Merged"), STAT_ActorGenerationMergedCount, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Actor Generation - Queue Depth"), STAT_ActorGenerationQueueDepth, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Actor Generation - Tasks In Flight"), STAT_ActorGenerationTasksInFlight, STATGROUP_CoverSystem);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Mesh Cover Templates - Hits"), STAT_MeshCoverTemplateHits, STATGROUP_CoverSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Mesh Cover Templates - Misses"), STAT_MeshCoverTemplateMisses, STATGROUP_CoverSystem);
+
+/**
+ * Cover points of a movable cover object, stored relative to the object so that they can follow it around without being regenerated.
+ */
+struct FMovableCoverObject
+{
+public:
+	// Transform of the object as of its registration or the last time its cover points were moved, whichever is later. The cover points in the octree are placed relative to this.
+	FTransform Transform;
+
+	// Cover points of the object, in object-local space.
+	TArray<FDTOCoverData> LocalCoverPoints;
+
+	// World location of each of LocalCoverPoints as of the last time they were placed, parallel to it. Cover points that didn't make it into the octree have one, too.
+	TArray<FVector> CoverPointLocations;
+
+	FMovableCoverObject()
+		: Transform(), LocalCoverPoints(), CoverPointLocations()
+	{}
+
+	FMovableCoverObject(const FTransform& _Transform)
+		: Transform(_Transform), LocalCoverPoints(), CoverPointLocations()
+	{}
+};
+
+/**
+ * An agent of a squad that's looking for cover, see UCoverSystem::FindSquadCover().
+ */
+struct FSquadCoverRequest
+{
+public:
+	TWeakObjectPtr<const ACharacter> Agent;
+
+	TWeakObjectPtr<const AActor> Enemy;
+
+	FSquadCoverRequest()
+		: Agent(), Enemy()
+	{}
+
+	FSquadCoverRequest(const ACharacter* _Agent, const AActor* _Enemy)
+		: Agent(_Agent), Enemy(_Enemy)
+	{}
+};
+
+/**
+ * Settings shared by every agent of a squad cover query. Same as the ones of UFindCover.
+ */
+struct FSquadCoverQuerySettings
+{
+public:
+	float AttackRange;
+
+	float MinAttackRange;
+
+	float MaxCoverPathCost;
+
+	FCoverEvaluationSettings EvaluationSettings;
+
+	// Enemies that every agent has to stay hidden from besides its own, see FCoverPointEvaluator::EvaluateCoverPointAgainstThreats().
+	TArray<FCoverThreat> Threats;
+
+	FSquadCoverQuerySettings()
+		: AttackRange(1000.0f), MinAttackRange(100.0f), MaxCoverPathCost(3000.0f), EvaluationSettings(100.0f, 310.0f, 10.0f, true), Threats()
+	{}
+
+	FSquadCoverQuerySettings(float _AttackRange, float _MinAttackRange, float _MaxCoverPathCost, const FCoverEvaluationSettings& _EvaluationSettings)
+		: AttackRange(_AttackRange), MinAttackRange(_MinAttackRange), MaxCoverPathCost(_MaxCoverPathCost), EvaluationSettings(_EvaluationSettings), Threats()
+	{}
+};
+
+/**
+ * The cover assigned to an agent by UCoverSystem::FindSquadCover().
+ */
+struct FSquadCoverAssignment
+{
+public:
+	// False if no adequate cover was left for the agent.
+	bool bFoundCover;
+
+	// The cover point the agent should move to, already held on its behalf.
+	FVector CoverLocation;
+
+	FSquadCoverAssignment()
+		: bFoundCover(), CoverLocation()
+	{}
+};
 
 /**
  * Singleton. The cover system contains the cover points octree and is also responsible for hooking into navmesh events to trigger the real-time dynamic (re)generation of cover.
@@ -66,6 +240,16 @@ private:
 	// NOT THREAD-SAFE! Use the corresponding thread-safe functions instead.
 	TSharedPtr<TCoverOctree, ESPMode::ThreadSafe> CoverOctree;
 
+	// Bumped whenever cover points are added to, removed from or moved within CoverOctree, so that cached query results of older versions are discarded.
+	// NOT THREAD-SAFE! Only change it while holding CoverDataLockObject for writing.
+	uint64 CoverDataVersion = 0;
+
+	// Results of this frame's octree queries.
+	mutable FCoverQueryCache QueryCache;
+
+	// Finds cover points that intersect the supplied box, via QueryCache. Assumes that CoverDataLockObject is held for reading.
+	void FindCoverPointsCachedUnsafe(TArray<FCoverPointOctreeElement>& OutCoverPoints, const FBox& QueryBox) const;
+
 	// Maps cover point locations to their ids
 	// NOT THREAD-SAFE! Use the corresponding thread-safe functions instead.
 	TMap<const FVector, FOctreeElementId2> ElementToID;
@@ -73,8 +257,81 @@ private:
 	// Maps cover objects to their cover point locations
 	TMultiMap<TWeakObjectPtr<const AActor>, FVector> CoverObjectToID;
 
+	// Movable cover objects and their object-local cover points.
+	// NOT THREAD-SAFE! Use the corresponding thread-safe functions instead.
+	TMap<TWeakObjectPtr<const AActor>, FMovableCoverObject> MovableCoverObjects;
+
+	// Where the held cover points of movable cover objects have been moved to, keyed by the location they were held at, so that their holders can still release them.
+	// NOT THREAD-SAFE! Use the corresponding thread-safe functions instead.
+	TMap<FVector, FVector> MovedHeldCoverLocations;
+
+	// The reverse of MovedHeldCoverLocations: the location each moved held cover point was held at, keyed by where it is now.
+	// NOT THREAD-SAFE! Use the corresponding thread-safe functions instead.
+	TMap<FVector, FVector> HeldAtCoverLocations;
+
+	// Forgets about the forwarding of the held cover point that's now at CoverPointLocation, if it has been moved. Assumes that CoverDataLockObject is held for writing.
+	void ForgetMovedHeldCover(const FVector& CoverPointLocation);
+
+	// Drops a cover point of a movable cover object from its object-local cover points, so that it doesn't come back on its next move. Assumes that CoverDataLockObject is held for writing.
+	void ForgetMovableCoverPoint(const AActor* CoverObject, const FVector& CoverPointLocation);
+
 	// Our custom navmesh
-	AChangeNotifyingRecastNavMesh* Navmesh;
+	TWeakObjectPtr<AChangeNotifyingRecastNavMesh> Navmesh;
+
+	// Throttles the cover generation of updated navmesh tiles. Game thread only.
+	TUniquePtr<FTileCoverGenerationDispatcher> TileDispatcher;
+
+	// Connected components of the navmesh, for rejecting unreachable cover points without pathfinding.
+	FNavmeshIslands NavmeshIslands;
+
+	// Recent outcomes of cover point evaluations, per agent and enemy.
+	FCoverExposureCache ExposureCache;
+
+	// Cover point evaluations are invalidated this far around changed cover points, as the cover object they're evaluated against may be this far away from them.
+	const float ExposureInvalidationMargin = 310.0f;
+
+	// Drops the cached evaluations around the supplied cover point locations, cluster by cluster.
+	void InvalidateExposureAround(const TArray<FVector>& CoverPointLocations);
+
+	// Clusters of contiguous cover points of the same cover object, for pruning whole groups of them at once.
+	FCoverClusters CoverClusters;
+
+	// Reclusters the cover objects whose cover points have changed. Game thread only.
+	void UpdateCoverClusters();
+
+	// Voxelized line of sight blockers, for rejecting cover points without sweeps. Only built if bBuildOcclusionGrid is set.
+	FCoverOcclusionGrid OcclusionGrid;
+
+	// Notifies subscribers about changes to the cover points within their regions.
+	TSharedPtr<FCoverChangeNotifier, ESPMode::ThreadSafe> ChangeNotifier;
+
+	// Runs crowd cover queries, see FindCrowdCover().
+	FCoverCrowdProcessor CrowdProcessor;
+
+	// Our subscription to full rebuilds of the navmesh.
+	FDelegateHandle NavMeshRebuildAllHandle;
+
+	// Forgets which tiles have had their cover generated, as every tile is about to be rebuilt and reported again.
+	void OnNavMeshRebuildAll();
+
+	// Wakes up the cover pending tiles that overlap Area, see bLazyTileGeneration. Thread-safe.
+	void WakeCoverTiles(const FBox& Area) const;
+
+	// Hands the changes of the supplied cover points over to ChangeNotifier, if anyone is subscribed. Thread-safe.
+	void RecordCoverChanges(const TArray<FVector>& CoverPointLocations, ECoverChangeType ChangeType) const;
+
+	// Fills in the navmesh polys of cover points that don't have one yet. Thread-safe.
+	void AssignNavPolys(TArray<FDTOCoverData>& CoverPointDTOs) const;
+
+	// Coalesces the cover generation requests of actors. Game thread only.
+	TUniquePtr<FActorCoverGenerationScheduler> GenerationScheduler;
+
+	// Thread lock for MeshCoverTemplates
+	mutable FRWLock MeshCoverTemplateLockObject;
+
+	// Cover candidates of static meshes in mesh-local space, shared by every instance of the same mesh and scale.
+	// NOT THREAD-SAFE! Use the corresponding thread-safe functions instead.
+	TMap<FMeshCoverTemplateKey, TArray<FVector>> MeshCoverTemplates;
 
 	// Must be explicitly called by the object that is instantiating the UCoverSystem.
 	UFUNCTION()
@@ -96,10 +353,28 @@ public:
 	// Processing should stop when this is true.
 	static bool bShutdown;
 
+	// Path cost of cover points that the navmesh flood doesn't know about. See RankCoverPointsByPathCost().
+	static constexpr float UnknownPathCost = -1.0f;
+
 	// Enables debug drawing.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	bool bDebugDraw = false;
 
+	// Voxelizes the geometry around navmesh tiles as their cover points are generated, so that cover point evaluation can reject exposed cover points without sweeps. See FCoverOcclusionGrid.
+	// Costs a few overlap tests per voxel column during generation and 128 bytes per chunk of 8x8x8 voxels.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bBuildOcclusionGrid = false;
+
+	// Only marks navmesh tiles as cover pending when they're built, instead of generating their cover right away.
+	// Their cover is generated once a FindCoverPoints() query first touches them, a pawn heads their way or PrefetchCoverAround() is called on them. Tiles generated once are regenerated as usual.
+	// Queries get the cover points generated so far while the rest are being generated, subscribers of GetChangeNotifier() hear about them once they're added.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bLazyTileGeneration = false;
+
+	// Makes queries from the game thread generate the cover pending tiles they touch on the spot, so that they get every cover point instead of the ones generated so far.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bCompleteLazyQueries = false;
+
 	// AABB used to filter out cover points on the edges of the map.
 	FBox MapBounds;
 
@@ -112,12 +387,21 @@ public:
 
 	virtual ~UCoverSystem();
 
+	// Stops listening to the navmesh, which may be destroyed before we are.
+	virtual void BeginDestroy() override;
+
 	// Callback for navmesh tile updates.
 	UFUNCTION()
 	void OnNavMeshTilesUpdated(const TSet<uint32>& UpdatedTiles);
 
+	// Queues an actor for cover generation via the coalescing scheduler. Game thread only.
+	void QueueActorCoverGeneration(const FActorCoverGenerationRequest& Request);
+
+	// Dispatches the queued navmesh tiles for cover generation as task slots free up. Game thread only.
+	void DispatchQueuedTiles();
+
 	// Thread-safe wrapper for TCoverOctree::FindCoverPoints()
-	// Finds cover points that intersect the supplied box. 
+	// Finds cover points that intersect the supplied box. Repeated queries with about the same box are served from the results of the first one for the rest of the frame.
 	void FindCoverPoints(TArray<FCoverPointOctreeElement>& OutCoverPoints, const FBox& QueryBox) const;
 
 	// Thread-safe wrapper for TCoverOctree::FindCoverPoints()
@@ -125,24 +409,109 @@ public:
 	void FindCoverPoints(TArray<FCoverPointOctreeElement>& OutCoverPoints, const FSphere& QuerySphere) const;
 
 	// Adds a set of cover points to the octree in a single, thread-safe batch.
-	void AddCoverPoints(const TArray<FDTOCoverData>& CoverPointDTOs);
+	// ScanTransforms are the transforms of the cover objects at the time they were scanned. Cover points of movable cover objects are made relative to these
+	// and placed where their objects are now, so that generation that was already underway when an object moved or got re-registered doesn't leave them behind.
+	void AddCoverPoints(const TArray<FDTOCoverData>& CoverPointDTOs, const TMap<const AActor*, FTransform>& ScanTransforms = TMap<const AActor*, FTransform>());
 
 	// Removes cover points within the specified area that don't fall on the navmesh or don't have an owner anymore.
 	// Useful for trimming areas around deleted objects and dynamically placed ones.
 	void RemoveStaleCoverPoints(FBox Area);
 
+	// Same as the above, for multiple areas in a single batch.
+	void RemoveStaleCoverPoints(const TArray<FBox>& Areas);
+
 	// Blueprint-friendly version of the above.
 	// Multiples Extent by 2.
 	UFUNCTION(BlueprintCallable)
 	void RemoveStaleCoverPoints(FVector Origin, FVector Extent);
 
+	// Starts generating the cover pending tiles within Radius of Location, e.g. ahead of AI moving there. Only does something if bLazyTileGeneration is set.
+	UFUNCTION(BlueprintCallable)
+	void PrefetchCoverAround(FVector Location, float Radius);
+
 	UFUNCTION(BlueprintCallable)
 	void RemoveCoverPointsOfObject(const AActor* CoverObject);
 
+	// Starts storing the cover points of CoverObject relative to it, so that they can later be moved along with it via MoveCoverPointsOfObject(). Thread-safe.
+	// Should be called right before (re)generating the object's cover points; Transform is the object's transform at that time.
+	void RegisterMovableCoverObject(const AActor* CoverObject, const FTransform& Transform);
+
+	// Stops tracking CoverObject as a movable cover object. Thread-safe.
+	void UnregisterMovableCoverObject(const AActor* CoverObject);
+
+	// Rigidly transforms the cover points of a movable cover object to NewTransform, instead of regenerating them. Thread-safe.
+	// Only the navmesh projection of the moved cover points is revalidated, in a single batch. Points that no longer fall on the navmesh are dropped.
+	// Held cover points stay held and can still be released via the location they were held at.
+	// Returns the number of cover points that have been kept.
+	int32 MoveCoverPointsOfObject(const AActor* CoverObject, const FTransform& NewTransform);
+
+	// Checks whether a cover point on ToPolyRef can be reached from FromPolyRef, based on the islands of the navmesh. Thread-safe.
+	// Returns Unknown if either poly isn't known yet, in which case pathfinding is needed to tell.
+	ENavmeshReachability GetReachability(NavNodeRef FromPolyRef, NavNodeRef ToPolyRef) const;
+
+	// Calculates the cost of walking from StartLocation to each of the supplied cover points with a single flood of the navmesh, instead of pathfinding to each of them. Game thread only.
+	// Cover points that can't be reached within MaxPathCost are removed, the rest are sorted by their path cost unless bSort is false, e.g. because FCoverPointScorer ranks them afterwards. OutPathCosts is parallel to CoverPoints.
+	// Cover points on polys the flood can't tell about, e.g. because their tiles have been rebuilt since they were generated, are kept with UnknownPathCost and ranked by their straight-line distance.
+	void RankCoverPointsByPathCost(TArray<FCoverPointOctreeElement>& CoverPoints, TArray<float>& OutPathCosts, const FVector& StartLocation, NavNodeRef StartPolyRef, float MaxPathCost, bool bSort = true) const;
+
+	// Finds the cluster of a cover point, reclustering the cover objects that have changed first. Game thread only.
+	// Returns false if the cover point isn't part of any cluster.
+	bool FindCoverCluster(FCoverCluster& OutCluster, const FVector& CoverLocation);
+
+	// Subscriptions to the changes of cover points within a region, see FCoverChangeNotifier. Thread-safe.
+	// Every change is reported except for those of RemoveAll().
+	FORCEINLINE FCoverChangeNotifier& GetChangeNotifier()
+	{
+		return *ChangeNotifier;
+	}
+
+	// The voxelized line of sight blockers. Empty unless bBuildOcclusionGrid is set. Thread-safe.
+	FORCEINLINE FCoverOcclusionGrid& GetOcclusionGrid()
+	{
+		return OcclusionGrid;
+	}
+
+	// The cache of recent cover point evaluations. Thread-safe.
+	FORCEINLINE FCoverExposureCache& GetExposureCache()
+	{
+		return ExposureCache;
+	}
+
+	// Finds cover for a whole squad in one pass: candidates are gathered once per enemy, each cover point is evaluated at most once per enemy and eye height,
+	// and the cheapest adequate (agent, cover point) pairs are assigned greedily by path cost so that agents don't race each other for the same points.
+	// All the chosen cover points are held in a single batch, agents whose cover has been taken in the meantime fall back to their next candidates. OutAssignments is parallel to Requests. Game thread only.
+	// Returns the number of agents that have been assigned cover.
+	int32 FindSquadCover(TArray<FSquadCoverAssignment>& OutAssignments, const TArray<FSquadCoverRequest>& Requests, const FSquadCoverQuerySettings& Settings);
+
+	// Same as FindSquadCover(), but scales to crowds of thousands of agents: agents are evaluated in parallel chunks and each proposes its few closest adequate cover points,
+	// which are then resolved into reservations in a deterministic order. Candidates are ranked by straight-line distance, capped at MaxCoverPathCost, instead of by path cost.
+	// Agents whose proposals were all claimed by others are left without cover, they can try again in the next batch. OutAssignments is parallel to Requests. Game thread only.
+	// Returns the number of agents that have been assigned cover.
+	FORCEINLINE int32 FindCrowdCover(TArray<FSquadCoverAssignment>& OutAssignments, const TArray<FSquadCoverRequest>& Requests, const FSquadCoverQuerySettings& Settings)
+	{
+		return CrowdProcessor.Process(this, OutAssignments, Requests, Settings);
+	}
+
+	// Marks all the supplied cover points as taken, under a single lock.
+	// bOutHeld is parallel to ElementLocations and is false for the ones that were already taken or no longer exist.
+	void HoldCovers(TArray<bool>& bOutHeld, const TArray<FVector>& ElementLocations);
+
 	// Resets the octree, erasing all its data.
 	UFUNCTION(BlueprintCallable)
 	void RemoveAll();
 
+	// Finds the cached mesh-local cover candidates of a static mesh. Thread-safe.
+	// Returns false if no template has been made for the supplied mesh and scale yet.
+	bool FindMeshCoverTemplate(TArray<FVector>& OutLocalCandidates, const FMeshCoverTemplateKey& Key) const;
+
+	// Caches the mesh-local cover candidates of a static mesh. Thread-safe.
+	// Keeps the existing template if another task has already added one for the same key.
+	void AddMeshCoverTemplate(const FMeshCoverTemplateKey& Key, const TArray<FVector>& LocalCandidates);
+
+	// Erases all the cached mesh cover templates, e.g. after the collision of a mesh has been changed.
+	UFUNCTION(BlueprintCallable)
+	void RemoveAllMeshCoverTemplates();
+
 	// Wrapper for Add() on ElementToID.
 	// Not thread-safe and shouldn't be called explicitly. Public because of FCoverPointOctreeSemantics::SetElementId().
 	// Automatically wrapped in a thread-safe context as it is a side-effect of AddCoverPoint(), which is always thread-safe.
@@ -155,6 +524,7 @@ public:
 
 	// Releases a cover that was taken.
 	// Returns true if the cover was taken before, false if it wasn't or an error has occurred, e.g. the cover no longer exists.
+	// Cover points of movable cover objects are released wherever they have been moved to since they were held.
 	UFUNCTION(BlueprintCallable)
 	bool ReleaseCover(FVector ElementLocation);
 };
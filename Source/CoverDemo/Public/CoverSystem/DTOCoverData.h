@@ -3,6 +3,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "AI/Navigation/NavigationTypes.h"
 
 /**
  * DTO for FCoverPointOctreeData
@@ -14,11 +15,14 @@ public:
 	FVector Location;
 	bool bForceField;
 
+	// Navmesh poly the cover point is on. Filled in by UCoverSystem::AddCoverPoints() if left invalid.
+	NavNodeRef NavPolyRef;
+
 	FDTOCoverData()
-		: CoverObject(), Location(), bForceField()
+		: CoverObject(), Location(), bForceField(), NavPolyRef(INVALID_NAVNODEREF)
 	{}
 
 	FDTOCoverData(AActor* _CoverObject, FVector _Location, bool _bForceField)
-		: CoverObject(_CoverObject), Location(_Location), bForceField(_bForceField)
+		: CoverObject(_CoverObject), Location(_Location), bForceField(_bForceField), NavPolyRef(INVALID_NAVNODEREF)
 	{}
 };
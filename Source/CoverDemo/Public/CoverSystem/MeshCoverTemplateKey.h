@@ -0,0 +1,42 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/StaticMesh.h"
+
+/**
+ * Identifies a mesh-local cover template: cover candidates of a static mesh only depend on the mesh itself and its scale, so instances sharing both can share the same template.
+ */
+struct FMeshCoverTemplateKey
+{
+public:
+	// Scale is quantized to 1 / ScaleQuantization so that nearly identical scales share the same template.
+	static constexpr float ScaleQuantization = 100.0f;
+
+	TWeakObjectPtr<const UStaticMesh> Mesh;
+
+	FIntVector QuantizedScale;
+
+	FMeshCoverTemplateKey()
+		: Mesh(), QuantizedScale()
+	{}
+
+	FMeshCoverTemplateKey(const UStaticMesh* _Mesh, const FVector& _Scale)
+		: Mesh(_Mesh),
+		QuantizedScale(
+			FMath::RoundToInt(_Scale.X * ScaleQuantization),
+			FMath::RoundToInt(_Scale.Y * ScaleQuantization),
+			FMath::RoundToInt(_Scale.Z * ScaleQuantization))
+	{}
+
+	FORCEINLINE bool operator==(const FMeshCoverTemplateKey& Other) const
+	{
+		return Mesh == Other.Mesh && QuantizedScale == Other.QuantizedScale;
+	}
+
+	FORCEINLINE friend uint32 GetTypeHash(const FMeshCoverTemplateKey& Key)
+	{
+		return HashCombine(GetTypeHash(Key.Mesh), GetTypeHash(Key.QuantizedScale));
+	}
+};
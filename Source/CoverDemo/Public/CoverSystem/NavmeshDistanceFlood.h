@@ -0,0 +1,46 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavMesh/RecastNavMesh.h"
+
+/**
+ * A poly reached by FNavmeshDistanceFlood.
+ */
+struct FNavmeshFloodNode
+{
+public:
+	// Cost of walking from the start location to EntryLocation.
+	float Cost;
+
+	// Where the poly has been entered at, i.e. the midpoint of the portal the cheapest path crosses into the poly. In Unreal space.
+	FVector EntryLocation;
+
+	FNavmeshFloodNode()
+		: Cost(), EntryLocation()
+	{}
+
+	FNavmeshFloodNode(float _Cost, const FVector& _EntryLocation)
+		: Cost(_Cost), EntryLocation(_EntryLocation)
+	{}
+};
+
+/**
+ * Single-source, bounded Dijkstra flood over the poly graph of a navmesh.
+ * Replaces one A* per destination with a single pass when path costs to many destinations around the same start location are needed, e.g. to cover points.
+ * Path costs are the lengths of paths through portal midpoints, which slightly overestimate the length of string-pulled paths. Area costs and query filters are ignored.
+ * Game thread only, as it reads the navmesh without locking.
+ */
+class COVERDEMO_API FNavmeshDistanceFlood
+{
+private:
+	// The flood stops after reaching this many polys, regardless of the cost limit.
+	static constexpr int32 MaxFloodNodes = 4096;
+
+public:
+	// Floods the navmesh from StartLocation, which is on StartPolyRef, until MaxCost is reached.
+	// OutNodes receives every poly that can be reached within MaxCost.
+	// Returns false if the flood couldn't be completed, i.e. StartPolyRef isn't valid or MaxFloodNodes has been reached, in which case polys missing from OutNodes may still be reachable within MaxCost.
+	static bool Flood(TMap<NavNodeRef, FNavmeshFloodNode>& OutNodes, const ARecastNavMesh* Navmesh, NavNodeRef StartPolyRef, const FVector& StartLocation, float MaxCost);
+};
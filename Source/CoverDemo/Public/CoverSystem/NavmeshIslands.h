@@ -0,0 +1,118 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "Misc/ScopeRWLock.h"
+
+class dtNavMesh;
+
+// Result of a reachability check between two navmesh polys.
+enum class ENavmeshReachability : uint8
+{
+	// Both polys are on the same island.
+	Reachable,
+
+	// The polys are on different islands, there's no path between them.
+	Unreachable,
+
+	// At least one of the polys isn't known, e.g. its tile has been rebuilt since the islands were last calculated. Pathfinding is needed to tell.
+	Unknown
+};
+
+/**
+ * A link from a poly of one navmesh tile to a poly of another, see FNavmeshTileIslands.
+ */
+struct FNavmeshExternalLink
+{
+public:
+	// Local island of the poly the link starts from.
+	int32 LocalIsland;
+
+	int32 NeighbourTile;
+
+	int32 NeighbourPoly;
+
+	FNavmeshExternalLink()
+		: LocalIsland(), NeighbourTile(), NeighbourPoly()
+	{}
+
+	FNavmeshExternalLink(int32 _LocalIsland, int32 _NeighbourTile, int32 _NeighbourPoly)
+		: LocalIsland(_LocalIsland), NeighbourTile(_NeighbourTile), NeighbourPoly(_NeighbourPoly)
+	{}
+};
+
+/**
+ * The islands of a single navmesh tile as far as its own polys are concerned, along with the links that join them with the islands of other tiles.
+ */
+struct FNavmeshTileIslands
+{
+public:
+	// Salt of the tile, for detecting tiles that have been rebuilt since. Zero for empty tiles.
+	uint32 Salt;
+
+	// Local island of each poly of the tile.
+	TArray<int32> PolyLocalIslands;
+
+	int32 LocalIslandCount;
+
+	TArray<FNavmeshExternalLink> ExternalLinks;
+
+	FNavmeshTileIslands()
+		: Salt(), PolyLocalIslands(), LocalIslandCount(), ExternalLinks()
+	{}
+};
+
+/**
+ * Connected components (islands) of the navmesh's poly graph, for rejecting unreachable locations without pathfinding.
+ * Links are treated as two-way and query filters are ignored, so polys on the same island are only reachable from one another as far as the navmesh itself is concerned.
+ * Owned by UCoverSystem, which updates it whenever navmesh tiles are updated. Thread-safe.
+ *
+ * Polys are first grouped into islands per tile, which are only recalculated for the tiles that have changed. The islands of the tiles are then joined across tile borders,
+ * which only has to walk the per-tile islands and the links between tiles instead of every poly of the navmesh.
+ */
+class COVERDEMO_API FNavmeshIslands
+{
+private:
+	mutable FRWLock IslandLockObject;
+
+	// The navmesh the islands have been calculated for.
+	TWeakObjectPtr<const ARecastNavMesh> Navmesh;
+
+	// Detour mesh of Navmesh at the time of the last rebuild. Only compared against, never dereferenced.
+	const dtNavMesh* DetourMesh = nullptr;
+
+	// Islands of each tile. Shared with the previous update for the tiles that haven't changed since.
+	TArray<TSharedPtr<const FNavmeshTileIslands>> TileIslands;
+
+	// Index of the first local island of each tile in LocalIslands.
+	TArray<int32> TileIslandOffsets;
+
+	// Island of each local island of every tile.
+	TArray<int32> LocalIslands;
+
+	int32 IslandCount = 0;
+
+	// Returns the island of the supplied poly or INDEX_NONE if it's not known. Assumes that IslandLockObject is held.
+	int32 GetIslandUnsafe(NavNodeRef PolyRef) const;
+
+public:
+	// Recalculates the islands of the supplied navmesh, only walking the polys of the tiles that have changed since the last call. Should be called on the game thread, after tiles have been updated.
+	void Rebuild(const ARecastNavMesh* _Navmesh);
+
+	// Forgets about all the islands.
+	void Reset();
+
+	// Returns the island of the supplied poly or INDEX_NONE if it's not known.
+	int32 GetIsland(NavNodeRef PolyRef) const;
+
+	// Checks whether there can be a path between the supplied polys.
+	ENavmeshReachability GetReachability(NavNodeRef FromPolyRef, NavNodeRef ToPolyRef) const;
+
+	FORCEINLINE int32 GetIslandCount() const
+	{
+		FRWScopeLock IslandLock(IslandLockObject, FRWScopeLockType::SLT_ReadOnly);
+		return IslandCount;
+	}
+};
@@ -0,0 +1,217 @@
+// Copyright (c) 2018 David Nadaski. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+
+#include <atomic>
+
+/**
+ * A navmesh tile waiting for cover generation.
+ */
+struct FPendingCoverTile
+{
+public:
+	uint32 TileIdx;
+
+	// Time at which the tile has first been updated.
+	double UpdateTime;
+
+	FBox Bounds;
+
+	// The parts of the tile that have changed. Empty if the whole tile needs to be regenerated.
+	TArray<FBox> DirtyAreas;
+
+	// Lower is more urgent. Recalculated on every dispatch.
+	float Priority;
+
+	FPendingCoverTile()
+		: TileIdx(), UpdateTime(), Bounds(ForceInit), DirtyAreas(), Priority()
+	{}
+
+	FPendingCoverTile(uint32 _TileIdx, double _UpdateTime, const FBox& _Bounds, const TArray<FBox>& _DirtyAreas)
+		: TileIdx(_TileIdx), UpdateTime(_UpdateTime), Bounds(_Bounds), DirtyAreas(_DirtyAreas), Priority()
+	{}
+};
+
+/**
+ * A recent cover query, see FTileCoverGenerationDispatcher::RecordQuery().
+ */
+struct FRecentCoverQuery
+{
+public:
+	FBox QueryBox;
+
+	double QueryTime;
+
+	FRecentCoverQuery()
+		: QueryBox(ForceInit), QueryTime()
+	{}
+
+	FRecentCoverQuery(const FBox& _QueryBox, double _QueryTime)
+		: QueryBox(_QueryBox), QueryTime(_QueryTime)
+	{}
+};
+
+/**
+ * Queues updated navmesh tiles and dispatches a bounded number of FNavmeshCoverPointGeneratorTasks for them.
+ * Tiles that get updated again while waiting are only generated once. The buffering interval of the navmesh and the dispatch rate adapt to the number of tasks in flight and their measured cost,
+ * so that heavy destruction doesn't back up the thread pool. Owned by UCoverSystem, game thread only unless stated otherwise.
+ *
+ * Tiles are dispatched in order of their distance to pawns and recent cover queries, so that tiles near the action don't wait behind tiles nobody is near.
+ * Waiting tiles age so that far away tiles get their turn eventually, and tiles that overlap a recent cover query jump the queue.
+ *
+ * In lazy mode, see UCoverSystem::bLazyTileGeneration, tiles that have never had their cover generated are only marked as cover pending when they're built.
+ * They're woken up and queued once a cover query touches them or a pawn heads their way, so that the parts of the map that never see combat cost nothing.
+ */
+class COVERDEMO_API FTileCoverGenerationDispatcher
+{
+private:
+	// Number of dispatched tasks that are still queued or running.
+	static FThreadSafeCounter TasksInFlight;
+
+	// Lock for AverageTaskCost, AverageLatency and MaxLatency.
+	static FCriticalSection TaskStatsLockObject;
+
+	// Moving average of how long a task takes to run, in seconds.
+	static double AverageTaskCost;
+
+	// Moving average of the time between a tile being updated and its cover points becoming available, in seconds.
+	static double AverageLatency;
+
+	// Highest latency measured so far, in seconds.
+	static double MaxLatency;
+
+	// Weight of the latest measurement in the moving averages.
+	static constexpr double MovingAverageWeight = 0.1;
+
+	// Initial guess for AverageTaskCost, in seconds.
+	static constexpr double InitialTaskCost = 0.01;
+
+	// Maximum number of tasks in flight. Tiles over this limit wait until a task finishes.
+	const int32 MaxTasksInFlight;
+
+	// Bounds of the interval between dispatches and of the navmesh's tile buffering interval, in seconds.
+	const float MinDispatchInterval = 0.1f;
+	const float MaxDispatchInterval = 1.0f;
+
+	const float CoverPointMinDistance;
+
+	const float SmallestAgentHeight;
+
+	const float CoverPointGroundOffset;
+
+	// Every second of waiting makes a tile count as this much closer to the action, in cm.
+	const float AgingRate = 2000.0f;
+
+	// Priority bonus of tiles that overlap a recent cover query, in cm. Large enough to put them ahead of any other tile.
+	const float PendingQueryBonus = 1000000.0f;
+
+	// Cover queries older than this don't affect priorities anymore, in seconds.
+	const float RecentQueryLifetime = 2.0f;
+
+	// Maximum number of recent cover queries to remember.
+	static constexpr int32 MaxRecentQueries = 32;
+
+	TWeakObjectPtr<UWorld> World;
+
+	FTimerHandle DispatchTimerHandle;
+
+	// Tiles waiting to be dispatched.
+	TArray<FPendingCoverTile> PendingTiles;
+
+	// Indices of the tiles in PendingTiles.
+	TSet<uint32> PendingTileIndices;
+
+	// Ring buffer of the latest cover queries. Written from any thread without locking, see RecentQuerySequences.
+	FRecentCoverQuery RecentQueries[MaxRecentQueries];
+
+	// Per-slot sequence numbers of RecentQueries: odd while the slot is being written, zero if it never has been. Readers skip slots that change under them.
+	std::atomic<uint32> RecentQuerySequences[MaxRecentQueries];
+
+	// Next slot to overwrite in RecentQueries, wraps around.
+	std::atomic<uint32> NextRecentQuery { 0 };
+
+	// How often pawns are checked for heading towards cover pending tiles, in seconds.
+	const float PrefetchInterval = 0.5f;
+
+	// How far ahead pawns are extrapolated along their velocity, in seconds.
+	const float PrefetchPredictionTime = 2.0f;
+
+	// Cover pending tiles this close to a pawn, to where it's extrapolated to be or to the end of its path get woken up, in cm.
+	const float PrefetchRadius = 2000.0f;
+
+	FTimerHandle PrefetchTimerHandle;
+
+	// Lock for DormantTiles, AwakeTiles and WokenTiles, as cover queries wake tiles up from any thread.
+	mutable FCriticalSection DormantTileLockObject;
+
+	// Bounds of the tiles that are cover pending: built, but not generated until they're needed. Keyed by tile index.
+	TMap<uint32, FBox> DormantTiles;
+
+	// Number of DormantTiles, readable without taking DormantTileLockObject.
+	std::atomic<int32> DormantTileCount { 0 };
+
+	// Tiles that have had their cover generated or are about to since lazy generation has been on, see WakeTiles(). Their updates are always queued right away.
+	TSet<uint32> AwakeTiles;
+
+	// Tiles woken up since the last QueueWokenTiles(), along with their bounds.
+	TArray<TPair<uint32, FBox>> WokenTiles;
+
+	// Starts the dispatch timer if it isn't running already.
+	void ScheduleDispatch();
+
+	// Gathers the locations of pawns and the centers and boxes of recent cover queries.
+	void GatherInterest(TArray<FVector>& OutInterestLocations, TArray<FBox>& OutRecentQueryBoxes);
+
+	// Recalculates the priorities of the pending tiles and orders them into a heap.
+	void PrioritizePendingTiles();
+
+	// Starts a generator task for the tile, either on the thread pool or right away on the calling thread.
+	void StartTask(FPendingCoverTile& PendingTile, bool bSynchronous);
+
+	// Starts the prefetch timer if it isn't running already.
+	void SchedulePrefetch();
+
+	// Wakes up the cover pending tiles that pawns are close to or heading towards. Reschedules itself while there are cover pending tiles left.
+	void Prefetch();
+
+public:
+	FTileCoverGenerationDispatcher(UWorld* _World, float _CoverPointMinDistance, float _SmallestAgentHeight, float _CoverPointGroundOffset);
+
+	~FTileCoverGenerationDispatcher();
+
+	// Queues a tile for cover generation. UpdateTime is when the tile's navmesh has been updated.
+	// DirtyAreas are the parts of the tile that have changed, empty if the whole tile should be regenerated.
+	// Tiles that are already queued keep their original update time and get their dirty areas merged.
+	// If bLazy is set, tiles that have never had their cover generated are marked as cover pending instead, see WakeTiles().
+	void QueueTile(uint32 TileIdx, double UpdateTime, const FBox& TileBounds, const TArray<FBox>& DirtyAreas, bool bLazy = false);
+
+	// Wakes up the cover pending tiles that overlap Area. They're generated as a whole once QueueWokenTiles() is called. Thread-safe.
+	// Returns true if any tiles have been woken up.
+	bool WakeTiles(const FBox& Area);
+
+	// Whether there are any cover pending tiles to wake up. Thread-safe and lock-free, so that queries can skip WakeTiles() altogether.
+	FORCEINLINE bool HasDormantTiles() const { return DormantTileCount.load(std::memory_order_relaxed) > 0; }
+
+	// Queues the woken up tiles for generation and dispatches them. If bSynchronous is set, they're generated right away on the calling thread instead.
+	void QueueWokenTiles(bool bSynchronous = false);
+
+	// Forgets about the cover pending tiles and which tiles have been generated.
+	void ResetLazyTiles();
+
+	// Dispatches the most urgent queued tiles, as many as there are free task slots. Reschedules itself while there are tiles left.
+	void Dispatch();
+
+	// Remembers a cover query so that the tiles around it get generated first. Thread-safe and lock-free, drops the query if another thread is writing the same slot.
+	void RecordQuery(const FBox& QueryBox);
+
+	// How long to wait before the next dispatch: short while there are free task slots, roughly the estimated time to work off the backlog otherwise.
+	float GetDispatchInterval() const;
+
+	// Called by dispatched tasks once they're done. TaskCost is zero and Latency is negative if the task didn't make it to adding cover points. Thread-safe.
+	// Dispatches the next queued tiles on the game thread right away instead of waiting for the dispatch timer.
+	static void OnTaskFinished(UWorld* World, double TaskCost, double Latency);
+};
@@ -9,16 +9,37 @@
 
 /**
  * Visualization data for debugging the cover finder.
+ * One per agent, only allocated once a debug flag is set and reused by every evaluation afterwards. The buffers are preallocated rings: once full, the oldest entries are overwritten.
  */
 UCLASS()
 class COVERDEMO_API UCoverFinderVisData : public UObject
 {
 	GENERATED_BODY()
 
+private:
+	static constexpr int32 MaxDebugPoints = 512;
+
+	static constexpr int32 MaxDebugArrows = 512;
+
+	// Slots to overwrite next once the buffers are full.
+	int32 NextDebugPoint = 0;
+	int32 NextDebugArrow = 0;
+
 public:
+	// In no particular order.
 	UPROPERTY()
 	TArray<FDebugPoint> DebugPoints;
 
+	// In no particular order.
 	UPROPERTY()
 	TArray<FDebugArrow> DebugArrows;
+
+	UCoverFinderVisData();
+
+	void AddDebugPoint(const FDebugPoint& DebugPoint);
+
+	void AddDebugArrow(const FDebugArrow& DebugArrow);
+
+	// Empties the buffers for the next evaluation, keeping their memory.
+	void Reset();
 };
@@ -7,6 +7,7 @@
 #include "GameFramework/Actor.h"
 #include "Engine/World.h"
 #include "Components/StaticMeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
 #include "NavigationSystem.h"
 #include "CoverSystem/CoverSystem.h"
 #include "CoverSystem/DTOCoverData.h"
@@ -22,6 +23,18 @@ protected:
 	// The object to scan for cover points.
 	AActor* Owner;
 
+	// Every object whose cover points are generated by this task. Only contains more than just Owner if the task has been merged by FActorCoverGenerationScheduler.
+	TArray<AActor*> CoverObjects;
+
+	// Bounding boxes of CoverObjects, used for deciding which object a cover point belongs to. Only set for merged tasks.
+	TArray<FBox> CoverObjectBounds;
+
+	// Bounding box of all the merged CoverObjects. Only set for merged tasks.
+	FBox MergedBounds;
+
+	// Whether the task has been dispatched by FActorCoverGenerationScheduler, which has to be notified once it's done.
+	bool bScheduled;
+
 	// The active world.
 	UWorld* World;
 
@@ -37,19 +50,69 @@ protected:
 	// Whether to generate cover points per UStaticMeshComponent found in Owner or around all the colliding components inside the owner's bounding box. Set to true if owner's bounding box would likely intersect with other actors in-game.
 	bool bGeneratePerStaticMesh;
 
+	// Whether to generate cover points per instance of the UInstancedStaticMeshComponents (and HISMs) found in Owner. All the instances are processed in parallel, within this one task.
+	bool bGeneratePerInstance;
+
+	// Whether to reuse the mesh-local cover candidates of static meshes that have already been scanned. Implies bGeneratePerStaticMesh.
+	bool bUseMeshCoverTemplates;
+
+	// Templates are only reused for meshes that are rotated by no more than this amount (in degrees) around the X and Y axes, since the grid scan relies on the up vector.
+	const float MeshCoverTemplateMaxTilt = 1.0f;
+
+	// Template candidates are moved over from another instance instead of being traced onto the ground here, so they're only projected onto navmesh this close to them vertically,
+	// about an agent's step height. Anything further away is another floor, e.g. of a multi-level building.
+	const float MeshCoverTemplateMaxProjectionHeight = 50.0f;
+
 #if DEBUG_RENDERING
 	bool bDebugDraw = false;
 #endif
 
+	// A single instance of an instanced static mesh to scan for cover.
+	struct FMeshInstanceScan
+	{
+		const UInstancedStaticMeshComponent* InstancedMesh;
+		int32 InstanceIndex;
+		FTransform Transform;
+		FBox Bounds;
+	};
+
 	// Gets the nearest ground point to Location that's in one grid unit's range or less. Returns false if ground point was too far, i.e. more than a grid unit away. Does not use the navmesh.
 	const bool FindGroundPoint(FVector& OutGroundPoint, const FVector Location) const;
 
 	// Gathers all the free grid points around an blocked grid point and adds them to OutGridPoints. Checks in 8 directions.
 	void GatherFreeGridPoints(TArray<FVector>& OutGridPoints, const FVector BlockedGridPoint, const TArray<FVector>& FreeGridPoints, const float NavPointEqualityTolerance);
 
+	// Scans the specified bounding box with a 3D grid and gathers the free grid points that are next to blocked ones.
+	// If BlockingComponent is supplied then it's traced on its own instead of the world, so only its geometry counts as blocking and the results are independent of its surroundings.
+	// BlockingItem further narrows this down to the body of a single instance of an instanced component.
+	void GatherCandidateGridPoints(TArray<FVector>& OutGridPoints, FBox Bounds, const UPrimitiveComponent* BlockingComponent = nullptr, const int32 BlockingItem = INDEX_NONE);
+
+	// Finds the cover object that the cover point at Location belongs to, i.e. Owner or, for merged tasks, the object with the nearest bounding box.
+	AActor* GetCoverObjectAt(const FVector& Location) const;
+
+	// Projects each candidate point onto the navmesh and adds the unique ones to OutCoverPointsOfActors.
+	// MaxProjectionHeight is how far the navmesh may be above or below a candidate, ScanGridUnit * 1.5 if negative.
+	void ProjectCandidatesToNavmesh(TArray<FDTOCoverData>& OutCoverPointsOfActors, const TArray<FVector>& CandidatePoints, float MaxProjectionHeight = -1.0f);
+
 	// Generates cover points inside the specified bounding box. This method does the work.
 	void GenerateCoverInBounds(TArray<FDTOCoverData>& OutCoverPointsOfActors, FBox& Bounds);
 
+	// Generates cover points around a static mesh (or one instance of it) via its mesh-local cover template, making the template first if it doesn't exist yet.
+	// Returns false if the mesh can't use templates, e.g. because it's tilted.
+	bool GenerateCoverFromMeshTemplate(
+		TArray<FDTOCoverData>& OutCoverPointsOfActors,
+		const UStaticMesh* StaticMesh,
+		const FTransform& MeshTransform,
+		const FBox& MeshBounds,
+		const UPrimitiveComponent* MeshComponent,
+		const int32 InstanceIndex = INDEX_NONE);
+
+	// Generates cover points around a single instance of an instanced static mesh.
+	void GenerateCoverForInstance(TArray<FDTOCoverData>& OutCoverPointsOfActors, const FMeshInstanceScan& InstanceScan);
+
+	// Generates cover points around every instance of every instanced static mesh of Owner, in parallel.
+	void GenerateCoverForInstances(TArray<FDTOCoverData>& OutCoverPointsOfActors);
+
 	// Find & store cover points in the game state. Calls GenerateCoverInBounds() either once when bGeneratePerStaticMesh == false or multiple times when bGeneratePerStaticMesh == true
 	void DoWork();
 
@@ -65,6 +128,22 @@ public:
 		float _BoundingBoxExpansion,
 		float _ScanGridUnit,
 		float _SmallestAgentHeight,
-		bool _bGeneratePerStaticMesh
+		bool _bGeneratePerStaticMesh,
+		bool _bUseMeshCoverTemplates = false,
+		bool _bGeneratePerInstance = false,
+		bool _bScheduled = false
 	);
+
+	// Makes a task that generates the cover points of multiple, adjacent objects via a single scan of their merged bounding box. Used by FActorCoverGenerationScheduler.
+	FActorCoverPointGeneratorTask(
+		const TArray<AActor*>& _CoverObjects,
+		const TArray<FBox>& _CoverObjectBounds,
+		const FBox& _MergedBounds,
+		UWorld* _World,
+		float _BoundingBoxExpansion,
+		float _ScanGridUnit,
+		float _SmallestAgentHeight
+	);
+
+	~FActorCoverPointGeneratorTask();
 };
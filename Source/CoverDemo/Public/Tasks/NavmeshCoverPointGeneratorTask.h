@@ -33,9 +33,15 @@ private:
 	// Offset that gets added to the cliff edge trace. Useful for detecting not perfectly straight cliffs e.g. that of landscapes.
 	const float StraightCliffErrorTolerance = 100.0f;
 
+	// Dirty areas are expanded by this much so that edges that are just outside of them, but whose scans could reach into them, are processed, too.
+	const float DirtyAreaMargin = 100.0f;
+
 	// Length of the raycast for checking if there's a navmesh hole to one of the sides of a navmesh edge.
 	const float NavmeshHoleCheckReach = 5.0f;
 
+	// How far above the navmesh the occlusion grid is voxelized, enough to cover the sight lines of standing agents.
+	const float OcclusionGridHeadroom = 300.0f;
+
 	// Height of the smallest actor that will ever fit under an overhanging cover. Should normally be the CROUCHED height of the smallest actor in the game. Not counting bunnies. Bunnies are useless.
 	const float SmallestAgentHeight;
 
@@ -55,6 +61,21 @@ private:
 	// The active world.
 	UWorld* World;
 
+	// Time at which the navmesh tile has been updated, for measuring the latency of cover generation.
+	const double TileUpdateTime;
+
+	// Whether this task has been dispatched by FTileCoverGenerationDispatcher.
+	const bool bScheduled;
+
+	// The parts of the tile to regenerate, expanded by DirtyAreaMargin. The whole tile is regenerated if empty.
+	TArray<FBox> DirtyAreas;
+
+	// How long DoWork() took, in seconds.
+	double TaskCost = 0.0;
+
+	// Time between the tile update and its cover points having been added, in seconds. Negative if the cover points haven't been added.
+	double Latency = -1.0;
+
 #if DEBUG_RENDERING
 	bool bDebugDraw = false;
 #endif
@@ -68,7 +89,10 @@ private:
 
 	void ProcessEdgeStep(TArray<FDTOCoverData>& OutCoverPointsOfActors, const FVector& EdgeStepVertex, const FVector& EdgeDir);
 
-	// Generates cover points inside the specified bounding box via navmesh edge-walking.
+	// Checks whether the edge should be processed, i.e. whether it intersects any of the dirty areas, if there are any.
+	bool IsEdgeDirty(const FVector& EdgeStartVertex, const FVector& EdgeEndVertex) const;
+
+	// Generates cover points inside the specified bounding box via navmesh edge-walking. Only processes the edges within DirtyAreas, if there are any.
 	// Returns the AABB of the navmesh tile that corresponds to NavmeshTileIndex.
 	const FBox GenerateCoverInBounds(TArray<FDTOCoverData>& OutCoverPointsOfActors);
 
@@ -88,6 +112,11 @@ public:
 		float _CoverPointGroundOffset,
 		FBox _MapBounds,
 		int32 _NavmeshTileIndex,
-		UWorld* _World
+		UWorld* _World,
+		double _TileUpdateTime = 0.0,
+		bool _bScheduled = false,
+		TArray<FBox> _DirtyAreas = TArray<FBox>()
 	);
+
+	~FNavmeshCoverPointGeneratorTask();
 };